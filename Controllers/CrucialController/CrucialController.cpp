@@ -80,7 +80,8 @@ void CrucialController::SendEffectMode(unsigned char mode, unsigned char speed)
 
 void CrucialController::SendDirectColors(RGBColor* color_buf)
 {
-    unsigned char color_blk[8];
+    i2c_smbus_batch batch;
+    unsigned char   color_blk[8];
 
     for(unsigned int led = 0; led < 8; led++)
     {
@@ -88,7 +89,7 @@ void CrucialController::SendDirectColors(RGBColor* color_buf)
     }
 
     //Red Channels
-    CrucialRegisterWriteBlock(0x8300, color_blk, 8);
+    CrucialRegisterWriteBlock(batch, 0x8300, color_blk, 8);
 
     for(unsigned int led = 0; led < 8; led++)
     {
@@ -96,7 +97,7 @@ void CrucialController::SendDirectColors(RGBColor* color_buf)
     }
     
     //Green Channels
-    CrucialRegisterWriteBlock(0x8340, color_blk, 8);
+    CrucialRegisterWriteBlock(batch, 0x8340, color_blk, 8);
 
     for(unsigned int led = 0; led < 8; led++)
     {
@@ -104,7 +105,10 @@ void CrucialController::SendDirectColors(RGBColor* color_buf)
     }
     
     //Blue Channels
-    CrucialRegisterWriteBlock(0x8380, color_blk, 8);
+    CrucialRegisterWriteBlock(batch, 0x8380, color_blk, 8);
+
+    //Send all channels as one queued bus job
+    bus->i2c_smbus_xfer_queue(batch).wait();
 }
 
 unsigned char CrucialController::CrucialRegisterRead(crucial_register reg)
@@ -136,6 +140,15 @@ void CrucialController::CrucialRegisterWriteBlock(crucial_register reg, unsigned
     bus->i2c_smbus_write_block_data(dev, 0x03, sz, data);
 }
 
+void CrucialController::CrucialRegisterWriteBlock(i2c_smbus_batch & batch, crucial_register reg, unsigned char * data, unsigned char sz)
+{
+    //Queue Crucial register write
+    batch.write_word_data(dev, 0x00, ((reg << 8) & 0xFF00) | ((reg >> 8) & 0x00FF));
+
+    //Queue Crucial block data write
+    batch.write_block_data(dev, 0x03, sz, data);
+}
+
 void CrucialController::SendEffectColor
     (
     unsigned int    led_idx,
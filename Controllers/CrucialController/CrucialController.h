@@ -55,6 +55,7 @@ public:
     unsigned char CrucialRegisterRead(crucial_register reg);
     void          CrucialRegisterWrite(crucial_register reg, unsigned char val);
     void          CrucialRegisterWriteBlock(crucial_register reg, unsigned char * data, unsigned char sz);
+    void          CrucialRegisterWriteBlock(i2c_smbus_batch & batch, crucial_register reg, unsigned char * data, unsigned char sz);
 
 private:
     char                    device_version[16];
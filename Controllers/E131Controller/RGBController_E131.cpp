@@ -9,10 +9,18 @@
 
 #include "RGBController_E131.h"
 #include <e131.h>
-#include <math.h>
+#include <map>
 
 using namespace std::chrono_literals;
 
+/*-----------------------------------------*\
+| Unchanged universes are sent a few times  |
+| and then refreshed at a reduced rate so   |
+| receivers do not time out                 |
+\*-----------------------------------------*/
+#define E131_UNCHANGED_REPEATS  3
+#define E131_REFRESH_DELAY      800ms
+
 /**------------------------------------------------------------------*\
     @name E1.31 Devices
     @category LEDStrip
@@ -71,8 +79,14 @@ RGBController_E131::RGBController_E131(std::vector<E131Device> device_list)
 
     for(unsigned int device_idx = 0; device_idx < devices.size(); device_idx++)
     {
-        float universe_size = devices[device_idx].universe_size;
-        unsigned int total_universes = ceil( ( ( devices[device_idx].num_leds * 3 ) + devices[device_idx].start_channel ) / universe_size );
+        unsigned int universe_size = devices[device_idx].universe_size;
+
+        if(universe_size == 0)
+        {
+            continue;
+        }
+
+        unsigned int total_universes = ( ( devices[device_idx].num_leds * 3 ) + devices[device_idx].start_channel + universe_size - 1 ) / universe_size;
 
         for(unsigned int univ_idx = 0; univ_idx < total_universes; univ_idx++)
         {
@@ -157,8 +171,14 @@ RGBController_E131::RGBController_E131(std::vector<E131Device> device_list)
         /*-----------------------------------------*\
         | Add Universes                             |
         \*-----------------------------------------*/
-        float universe_size = devices[device_idx].universe_size;
-        unsigned int total_universes = ceil( ( ( devices[device_idx].num_leds * 3 ) + devices[device_idx].start_channel ) / universe_size );
+        unsigned int universe_size = devices[device_idx].universe_size;
+
+        if(universe_size == 0)
+        {
+            continue;
+        }
+
+        unsigned int total_universes = ( ( devices[device_idx].num_leds * 3 ) + devices[device_idx].start_channel + universe_size - 1 ) / universe_size;
 
         for (unsigned int univ_idx = 0; univ_idx < total_universes; univ_idx++)
         {
@@ -294,6 +314,21 @@ RGBController_E131::RGBController_E131(std::vector<E131Device> device_list)
         }
     }
 
+    SetupChannelMap();
+
+    /*-----------------------------------------*\
+    | Refresh unchanged universes often enough  |
+    | for the shortest keepalive time           |
+    \*-----------------------------------------*/
+    refresh_delay = E131_REFRESH_DELAY;
+
+    if((keepalive_delay.count() > 0) && ((keepalive_delay / 2) < refresh_delay))
+    {
+        refresh_delay = keepalive_delay / 2;
+    }
+
+    force_send = false;
+
     if(keepalive_delay.count() > 0)
     {
         keepalive_thread_run = 1;
@@ -376,67 +411,179 @@ void RGBController_E131::ResizeZone(int /*zone*/, int /*new_size*/)
     \*---------------------------------------------------------*/
 }
 
-void RGBController_E131::DeviceUpdateLEDs()
+void RGBController_E131::SetupChannelMap()
 {
-    int color_idx = 0;
+    /*-----------------------------------------*\
+    | Map universes to packet indices           |
+    \*-----------------------------------------*/
+    std::map<unsigned int, unsigned int> universe_packets;
 
-    last_update_time = std::chrono::steady_clock::now();
+    for(std::size_t packet_idx = 0; packet_idx < packets.size(); packet_idx++)
+    {
+        universe_packets[universes[packet_idx]] = packet_idx;
+    }
+
+    /*-----------------------------------------*\
+    | Walk each device's channels in the order  |
+    | they are packed, starting at the device's |
+    | start channel in its first universe       |
+    \*-----------------------------------------*/
+    unsigned int color_idx = 0;
 
     for(std::size_t device_idx = 0; device_idx < devices.size(); device_idx++)
     {
-        float universe_size = devices[device_idx].universe_size;
-        unsigned int total_universes = ceil( ( ( devices[device_idx].num_leds * 3 ) + devices[device_idx].start_channel ) / universe_size );
-        unsigned int channel_idx = devices[device_idx].start_channel;
-        unsigned int led_idx = 0;
-        unsigned int rgb_idx = 0;
-        bool         done = false;
+        unsigned int universe_size = devices[device_idx].universe_size;
+        unsigned int num_leds      = devices[device_idx].num_leds;
 
-        for (unsigned int univ_idx = 0; univ_idx < total_universes; univ_idx++)
+        if(universe_size == 0)
         {
-            unsigned int universe = devices[device_idx].start_universe + univ_idx;
+            color_idx += num_leds;
+            continue;
+        }
 
-            for(std::size_t packet_idx = 0; packet_idx < packets.size(); packet_idx++)
+        unsigned int total_universes = ( ( num_leds * 3 ) + devices[device_idx].start_channel + universe_size - 1 ) / universe_size;
+        unsigned int last_channel    = universe_size;
+        unsigned int channel_idx     = devices[device_idx].start_channel;
+        unsigned int led_idx         = 0;
+        unsigned int rgb_idx         = 0;
+
+        if(last_channel > 512)
+        {
+            last_channel = 512;
+        }
+
+        for(unsigned int univ_idx = 0; (univ_idx < total_universes) && (led_idx < num_leds); univ_idx++)
+        {
+            unsigned int packet_idx = universe_packets[devices[device_idx].start_universe + univ_idx];
+
+            while((led_idx < num_leds) && (channel_idx <= last_channel))
             {
-                if(!done && (universes[packet_idx] == universe))
+                unsigned int whole_leds = (last_channel - channel_idx + 1) / 3;
+
+                if(whole_leds > (num_leds - led_idx))
                 {
-                    while(!done && (channel_idx <= universe_size))
-                    {
-                        switch(rgb_idx)
-                        {
-                            case 0:
-                                packets[packet_idx].dmp.prop_val[channel_idx] = RGBGetRValue( colors[color_idx] );
-                                rgb_idx = 1;
-                                break;
-                            case 1:
-                                packets[packet_idx].dmp.prop_val[channel_idx] = RGBGetGValue( colors[color_idx] );
-                                rgb_idx = 2;
-                                break;
-                            case 2:
-                                packets[packet_idx].dmp.prop_val[channel_idx] = RGBGetBValue( colors[color_idx] );
-                                rgb_idx = 0;
-                                led_idx++;
-                                color_idx++;
-                                break;
-                        }
+                    whole_leds = num_leds - led_idx;
+                }
 
-                        if(led_idx >= devices[device_idx].num_leds)
-                        {
-                            done = true;
-                        }
+                if((rgb_idx == 0) && (whole_leds > 0))
+                {
+                    E131ChannelSpan span;
 
-                        channel_idx++;
+                    span.packet_idx = packet_idx;
+                    span.channel    = channel_idx;
+                    span.color_idx  = color_idx + led_idx;
+                    span.num_leds   = whole_leds;
+
+                    channel_spans.push_back(span);
+
+                    led_idx     += whole_leds;
+                    channel_idx += whole_leds * 3;
+                }
+                else
+                {
+                    E131SplitChannel split;
+
+                    split.packet_idx = packet_idx;
+                    split.channel    = channel_idx;
+                    split.color_idx  = color_idx + led_idx;
+                    split.component  = rgb_idx;
+
+                    split_channels.push_back(split);
+
+                    channel_idx++;
+                    rgb_idx++;
+
+                    if(rgb_idx == 3)
+                    {
+                        rgb_idx = 0;
+                        led_idx++;
                     }
                 }
             }
 
             channel_idx = 1;
         }
+
+        color_idx += num_leds;
     }
 
+    packet_changed.assign(packets.size(), 0);
+    packet_repeats.assign(packets.size(), 0);
+    packet_send_times.assign(packets.size(), std::chrono::steady_clock::now());
+}
+
+void RGBController_E131::DeviceUpdateLEDs()
+{
+    last_update_time = std::chrono::steady_clock::now();
+
+    /*-----------------------------------------*\
+    | Pack whole LEDs straight into the packet  |
+    | buffers, noting which packets changed     |
+    \*-----------------------------------------*/
+    for(std::size_t span_idx = 0; span_idx < channel_spans.size(); span_idx++)
+    {
+        const E131ChannelSpan&  span = channel_spans[span_idx];
+        const RGBColor*         src  = &colors[span.color_idx];
+        unsigned char*          dst  = &packets[span.packet_idx].dmp.prop_val[span.channel];
+        unsigned char           diff = 0;
+
+        for(unsigned int led_idx = 0; led_idx < span.num_leds; led_idx++)
+        {
+            unsigned char red = RGBGetRValue(src[led_idx]);
+            unsigned char grn = RGBGetGValue(src[led_idx]);
+            unsigned char blu = RGBGetBValue(src[led_idx]);
+
+            diff  |= (dst[0] ^ red) | (dst[1] ^ grn) | (dst[2] ^ blu);
+
+            dst[0] = red;
+            dst[1] = grn;
+            dst[2] = blu;
+            dst   += 3;
+        }
+
+        packet_changed[span.packet_idx] |= diff;
+    }
+
+    for(std::size_t split_idx = 0; split_idx < split_channels.size(); split_idx++)
+    {
+        const E131SplitChannel& split = split_channels[split_idx];
+        unsigned char           value = (colors[split.color_idx] >> (8 * split.component)) & 0xFF;
+        unsigned char&          dst   = packets[split.packet_idx].dmp.prop_val[split.channel];
+
+        packet_changed[split.packet_idx] |= (dst ^ value);
+
+        dst = value;
+    }
+
+    /*-----------------------------------------*\
+    | Send changed universes.  Unchanged ones   |
+    | are repeated a few times, then refreshed  |
+    | at the reduced rate                       |
+    \*-----------------------------------------*/
+    bool forced = force_send.exchange(false);
+
     for(std::size_t packet_idx = 0; packet_idx < packets.size(); packet_idx++)
     {
-        e131_send(sockfd, &packets[packet_idx], &dest_addrs[packet_idx]);
-        packets[packet_idx].frame.seq_number++;
+        if(packet_changed[packet_idx])
+        {
+            packet_repeats[packet_idx] = 0;
+            packet_changed[packet_idx] = 0;
+        }
+
+        if(forced
+        || (packet_repeats[packet_idx] < E131_UNCHANGED_REPEATS)
+        || ((last_update_time - packet_send_times[packet_idx]) >= refresh_delay))
+        {
+            e131_send(sockfd, &packets[packet_idx], &dest_addrs[packet_idx]);
+            packets[packet_idx].frame.seq_number++;
+
+            if(packet_repeats[packet_idx] < E131_UNCHANGED_REPEATS)
+            {
+                packet_repeats[packet_idx]++;
+            }
+
+            packet_send_times[packet_idx] = last_update_time;
+        }
     }
 }
 
@@ -461,6 +608,7 @@ void RGBController_E131::KeepaliveThreadFunction()
     {
         if((std::chrono::steady_clock::now() - last_update_time) > ( keepalive_delay * 0.95f ) )
         {
+            force_send = true;
             UpdateLEDs();
         }
         std::this_thread::sleep_for(keepalive_delay / 2);
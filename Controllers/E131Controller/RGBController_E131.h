@@ -55,6 +55,29 @@ struct E131Device
     e131_matrix_order matrix_order;
 };
 
+/*-----------------------------------------*\
+| Precomputed channel map entries.  A span  |
+| is a run of whole LEDs packed into one    |
+| packet, a split channel is one color      |
+| component of an LED that straddles two    |
+| universes.                                |
+\*-----------------------------------------*/
+struct E131ChannelSpan
+{
+    unsigned int packet_idx;
+    unsigned int channel;
+    unsigned int color_idx;
+    unsigned int num_leds;
+};
+
+struct E131SplitChannel
+{
+    unsigned int packet_idx;
+    unsigned int channel;
+    unsigned int color_idx;
+    unsigned int component;
+};
+
 class RGBController_E131 : public RGBController
 {
 public:
@@ -74,6 +97,8 @@ public:
     void        KeepaliveThreadFunction();
 
 private:
+    void        SetupChannelMap();
+
 	std::vector<E131Device> 	devices;
     std::vector<e131_packet_t> 	packets;
 	std::vector<e131_addr_t> 	dest_addrs;
@@ -83,4 +108,12 @@ private:
     std::atomic<bool>           keepalive_thread_run;
     std::chrono::milliseconds                           keepalive_delay;
     std::chrono::time_point<std::chrono::steady_clock>  last_update_time;
+
+    std::vector<E131ChannelSpan>                        channel_spans;
+    std::vector<E131SplitChannel>                       split_channels;
+    std::vector<unsigned char>                          packet_changed;
+    std::vector<unsigned int>                           packet_repeats;
+    std::vector<std::chrono::time_point<std::chrono::steady_clock>> packet_send_times;
+    std::chrono::milliseconds                           refresh_delay;
+    std::atomic<bool>                                   force_send;
 };
@@ -271,6 +271,8 @@ void ENESMBusController::SetAllColorsDirect(RGBColor* colors)
         color_buf[i + 2] = RGBGetGValue(colors[i / 3]);
     }
 
+    interface->ENEBatchBegin();
+
     while(bytes_sent < (led_count * 3))
     {
         int bytes_to_send = (led_count * 3) - bytes_sent;
@@ -285,6 +287,8 @@ void ENESMBusController::SetAllColorsDirect(RGBColor* colors)
         bytes_sent += bytes_to_send;
     }
 
+    interface->ENEBatchEnd();
+
     delete[] color_buf;
 }
 
@@ -300,6 +304,8 @@ void ENESMBusController::SetAllColorsEffect(RGBColor* colors)
         color_buf[i + 2] = RGBGetGValue(colors[i / 3]);
     }
 
+    interface->ENEBatchBegin();
+
     while(bytes_sent < (led_count * 3))
     {
         int bytes_to_send = (led_count * 3) - bytes_sent;
@@ -316,6 +322,8 @@ void ENESMBusController::SetAllColorsEffect(RGBColor* colors)
 
     ENERegisterWrite(ENE_REG_APPLY, ENE_APPLY_VAL);
 
+    interface->ENEBatchEnd();
+
     delete[] color_buf;
 }
 
@@ -344,10 +352,17 @@ void ENESMBusController::SetLEDColorEffect(unsigned int led, unsigned char red,
 
 void ENESMBusController::SetMode(unsigned char mode, unsigned char speed, unsigned char direction)
 {
+    interface->ENEBatchBegin();
     ENERegisterWrite(ENE_REG_MODE,      mode);
     ENERegisterWrite(ENE_REG_SPEED,     speed);
     ENERegisterWrite(ENE_REG_DIRECTION, direction);
     ENERegisterWrite(ENE_REG_APPLY,     ENE_APPLY_VAL);
+    interface->ENEBatchEnd();
+}
+
+void ENESMBusController::SetTargetRate(unsigned int fps)
+{
+    interface->ENESetTargetRate(dev, fps);
 }
 
 void ENESMBusController::UpdateDeviceName()
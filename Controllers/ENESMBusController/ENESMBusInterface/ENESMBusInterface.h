@@ -23,4 +23,18 @@ public:
     virtual unsigned char ENERegisterRead(ene_dev_id dev, ene_register reg) = 0;
     virtual void          ENERegisterWrite(ene_dev_id dev, ene_register reg, unsigned char val) = 0;
     virtual void          ENERegisterWriteBlock(ene_dev_id dev, ene_register reg, unsigned char * data, unsigned char sz) = 0;
+
+    /*-----------------------------------------------------*\
+    | Writes between ENEBatchBegin and ENEBatchEnd may be   |
+    | queued and sent together.  Interfaces that do not     |
+    | support batching write immediately.                   |
+    \*-----------------------------------------------------*/
+    virtual void          ENEBatchBegin() {}
+    virtual void          ENEBatchEnd() {}
+
+    /*-----------------------------------------------------*\
+    | Frame rate the device should be given on a shared     |
+    | bus, 0 for no target                                  |
+    \*-----------------------------------------------------*/
+    virtual void          ENESetTargetRate(ene_dev_id /*dev*/, unsigned int /*fps*/) {}
 };
@@ -10,7 +10,8 @@
 
 ENESMBusInterface_i2c_smbus::ENESMBusInterface_i2c_smbus(i2c_smbus_interface* bus)
 {
-    this->bus = bus;
+    this->bus       = bus;
+    batch_active    = false;
 }
 
 ENESMBusInterface_i2c_smbus::~ENESMBusInterface_i2c_smbus()
@@ -31,6 +32,12 @@ int ENESMBusInterface_i2c_smbus::GetMaxBlock()
 
 unsigned char ENESMBusInterface_i2c_smbus::ENERegisterRead(ene_dev_id dev, ene_register reg)
 {
+    //Queue any pending writes so they reach the bus before the read
+    if(batch_active)
+    {
+        SubmitBatch();
+    }
+
     //Write ENE register
     bus->i2c_smbus_write_word_data(dev, 0x00, ((reg << 8) & 0xFF00) | ((reg >> 8) & 0x00FF));
 
@@ -40,6 +47,13 @@ unsigned char ENESMBusInterface_i2c_smbus::ENERegisterRead(ene_dev_id dev, ene_r
 
 void ENESMBusInterface_i2c_smbus::ENERegisterWrite(ene_dev_id dev, ene_register reg, unsigned char val)
 {
+    if(batch_active)
+    {
+        batch.write_word_data(dev, 0x00, ((reg << 8) & 0xFF00) | ((reg >> 8) & 0x00FF));
+        batch.write_byte_data(dev, 0x01, val);
+        return;
+    }
+
     //Write ENE register
     bus->i2c_smbus_write_word_data(dev, 0x00, ((reg << 8) & 0xFF00) | ((reg >> 8) & 0x00FF));
 
@@ -49,9 +63,48 @@ void ENESMBusInterface_i2c_smbus::ENERegisterWrite(ene_dev_id dev, ene_register
 
 void ENESMBusInterface_i2c_smbus::ENERegisterWriteBlock(ene_dev_id dev, ene_register reg, unsigned char * data, unsigned char sz)
 {
+    if(batch_active)
+    {
+        batch.write_word_data(dev, 0x00, ((reg << 8) & 0xFF00) | ((reg >> 8) & 0x00FF));
+        batch.write_block_data(dev, 0x03, sz, data);
+        return;
+    }
+
     //Write ENE register
     bus->i2c_smbus_write_word_data(dev, 0x00, ((reg << 8) & 0xFF00) | ((reg >> 8) & 0x00FF));
 
     //Write ENE block data
     bus->i2c_smbus_write_block_data(dev, 0x03, sz, data);
 }
+
+void ENESMBusInterface_i2c_smbus::ENEBatchBegin()
+{
+    batch_active = true;
+}
+
+void ENESMBusInterface_i2c_smbus::ENEBatchEnd()
+{
+    SubmitBatch();
+
+    batch_active = false;
+}
+
+void ENESMBusInterface_i2c_smbus::ENESetTargetRate(ene_dev_id dev, unsigned int fps)
+{
+    bus->i2c_smbus_set_target_rate(dev, fps);
+}
+
+void ENESMBusInterface_i2c_smbus::SubmitBatch()
+{
+    if(batch.empty())
+    {
+        return;
+    }
+
+    /*---------------------------------------------------------*\
+    | Send the writes as one bus job and wait for it, so that   |
+    | SetMode and SetAllColors return once the device has been  |
+    | written, as they do without batching                      |
+    \*---------------------------------------------------------*/
+    bus->i2c_smbus_xfer_queue(batch).wait();
+}
@@ -24,6 +24,16 @@ public:
     void          ENERegisterWrite(ene_dev_id dev, ene_register reg, unsigned char val);
     void          ENERegisterWriteBlock(ene_dev_id dev, ene_register reg, unsigned char * data, unsigned char sz);
 
+    void          ENEBatchBegin();
+    void          ENEBatchEnd();
+
+    void          ENESetTargetRate(ene_dev_id dev, unsigned int fps);
+
 private:
+    void          SubmitBatch();
+
     i2c_smbus_interface *   bus;
+
+    bool                    batch_active;
+    i2c_smbus_batch         batch;
 };
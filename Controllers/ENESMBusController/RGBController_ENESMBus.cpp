@@ -22,6 +22,7 @@
 RGBController_ENESMBus::RGBController_ENESMBus(ENESMBusController * controller_ptr)
 {
     controller  = controller_ptr;
+    target_rate = 0;
 
     /*---------------------------------------------------------*\
     | Determine name and type (DRAM or Motherboard) by checking |
@@ -145,6 +146,13 @@ RGBController_ENESMBus::RGBController_ENESMBus(ENESMBusController * controller_p
     | Initialize active mode                            |
     \*-------------------------------------------------*/
     active_mode = GetDeviceMode();
+
+    /*-------------------------------------------------*\
+    | Single LED and zone updates only write the        |
+    | changed color registers, enable partial updates   |
+    | to avoid rewriting the whole block every frame    |
+    \*-------------------------------------------------*/
+    SetPartialUpdates(true);
 }
 
 RGBController_ENESMBus::~RGBController_ENESMBus()
@@ -246,6 +254,18 @@ void RGBController_ENESMBus::DeviceUpdateLEDs()
 {
     if(GetMode() == 0)
     {
+        /*---------------------------------------------------------*\
+        | Ask the bus scheduler to keep up with the update rate     |
+        | limit from the settings while animating in Direct mode    |
+        \*---------------------------------------------------------*/
+        unsigned int update_rate = GetUpdateRateLimit();
+
+        if(update_rate != target_rate)
+        {
+            controller->SetTargetRate(update_rate);
+            target_rate = update_rate;
+        }
+
         controller->SetAllColorsDirect(&colors[0]);
     }
     else
@@ -447,6 +467,12 @@ void RGBController_ENESMBus::DeviceUpdateMode()
 
         controller->SetMode(new_mode, new_speed, new_direction);
         controller->SetDirect(false);
+
+        if(target_rate != 0)
+        {
+            controller->SetTargetRate(0);
+            target_rate = 0;
+        }
     }
 }
 
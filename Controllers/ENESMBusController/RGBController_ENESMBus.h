@@ -30,6 +30,7 @@ public:
 
 private:
     ENESMBusController* controller;
+    unsigned int        target_rate;
 
     int         GetDeviceMode();
 };
@@ -5,7 +5,9 @@
 \*---------------------------------------------------------*/
 
 #include "ElgatoKeyLightController.h"
+#include "LogManager.h"
 #include "json.hpp"
+#include "httplib.h"
 #include <iostream>
 
 using json = nlohmann::json;
@@ -18,13 +20,19 @@ ElgatoKeyLightController::ElgatoKeyLightController(std::string ip)
     location    = "IP: " + ip;
 
     /*-----------------------------------------------------------------*\
-    | Open a TCP client sending to the device's IP, port 9123          |
+    | Requests to the device's IP, port 9123 go through its scheduler,  |
+    | which keeps the HTTP connection open between requests             |
     \*-----------------------------------------------------------------*/
-    port.tcp_client(ip.c_str(), "9123");
+    scheduler   = rest_scheduler::get(ip, ELGATO_KEY_LIGHT_PORT);
 }
 
 ElgatoKeyLightController::~ElgatoKeyLightController()
 {
+    scheduler->cancel("lights");
+
+    rest_scheduler_stats stats = scheduler->get_stats();
+
+    LOG_DEBUG("[Elgato Key Light] %s: %llu requests submitted, %llu sent, %llu coalesced, %llu dropped", location.c_str(), stats.submitted, stats.sent, stats.coalesced, stats.dropped);
 }
 
 std::string ElgatoKeyLightController::GetLocation()
@@ -57,14 +65,22 @@ void ElgatoKeyLightController::SetColor(hsv_t hsv_color)
     // Weird elgato color format
     int k_value = HSVToK(hsv_color.hue);
 
-    port.tcp_client_connect();
-    std::string buf = GetRequest(hsv_color.value, k_value);
-    port.tcp_client_write((char *)buf.c_str(), buf.length() + 1);
+    std::string body = GetRequestBody(hsv_color.value, k_value);
+
+    /*-----------------------------------------------------------------*\
+    | Queue the request, replacing any earlier one not yet sent         |
+    \*-----------------------------------------------------------------*/
+    rest_scheduler* request_scheduler = scheduler;
+
+    scheduler->submit("lights", [request_scheduler, body]()
+    {
+        httplib::Result result = request_scheduler->client()->Put("/elgato/lights", body, "application/json");
 
-    port.tcp_close();
+        return(result && ((result->status / 100) == 2));
+    });
 }
 
-std::string ElgatoKeyLightController::GetRequest(int brightness, int temperature)
+std::string ElgatoKeyLightController::GetRequestBody(int brightness, int temperature)
 {
     json command;
 
@@ -74,11 +90,7 @@ std::string ElgatoKeyLightController::GetRequest(int brightness, int temperature
     lights.push_back(json::object({ {"on", 1}, {"temperature", temperature}, {"brightness", brightness}}));
     command["lights"] = lights;
 
-    std::string command_str = command.dump();
-    std::string buf = "PUT /elgato/lights HTTP/1.1\r\nContent-Type: application/json\r\nContent-Length: " +
-                      std::to_string(command_str.length()) +
-                      "\r\nConnection: close\r\n\r\n" + command_str + "\r\n\r\n";
-    return(buf);
+    return(command.dump());
 }
 
 int ElgatoKeyLightController::HSVToK(int hue)
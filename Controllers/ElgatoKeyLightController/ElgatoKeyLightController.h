@@ -5,7 +5,7 @@
 \*---------------------------------------------------------*/
 
 #include "RGBController.h"
-#include "net_port.h"
+#include "rest_scheduler.h"
 #include "hsv.h"
 
 #include <cmath>
@@ -15,6 +15,9 @@
 
 #pragma once
 
+#define ELGATO_KEY_LIGHT_PORT                   9123
+#define ELGATO_KEY_LIGHT_REQUESTS_PER_SECOND    10
+
 class ElgatoKeyLightController
 {
 public:
@@ -30,8 +33,8 @@ public:
     void SetColor(hsv_t hsv_color);
 
 private:
-    std::string GetRequest(int brightness, int temperature);
+    std::string GetRequestBody(int brightness, int temperature);
     int HSVToK(int hue);
     std::string         location;
-    net_port            port;
+    rest_scheduler*     scheduler;
 };
@@ -35,6 +35,18 @@ void DetectElgatoKeyLightControllers()
             {
                 std::string elgato_keylight_ip = elgato_keylight_settings["devices"][device_idx]["ip"];
 
+                /*-------------------------------------------------*\
+                | Set the request budget for the device             |
+                \*-------------------------------------------------*/
+                float requests_per_second = ELGATO_KEY_LIGHT_REQUESTS_PER_SECOND;
+
+                if(elgato_keylight_settings["devices"][device_idx].contains("requests_per_second"))
+                {
+                    requests_per_second = elgato_keylight_settings["devices"][device_idx]["requests_per_second"];
+                }
+
+                rest_scheduler::get(elgato_keylight_ip, ELGATO_KEY_LIGHT_PORT)->set_rate_limit(requests_per_second);
+
                 ElgatoKeyLightController*     controller     = new ElgatoKeyLightController(elgato_keylight_ip);
                 RGBController_ElgatoKeyLight* rgb_controller = new RGBController_ElgatoKeyLight(controller);
 
@@ -6,14 +6,30 @@
 
 #include "LEDStripController.h"
 #include "ResourceManager.h"
+#include "LogManager.h"
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 #include <string>
+#include <thread>
+
+/*---------------------------------------------------------*\
+| Bits sent per byte with 8N1 framing                       |
+\*---------------------------------------------------------*/
+#define SERIAL_BITS_PER_BYTE        10
+
+/*---------------------------------------------------------*\
+| Give up waiting for the previous frame after this long    |
+| and drop whatever is left of it                           |
+\*---------------------------------------------------------*/
+#define SERIAL_QUEUE_TIMEOUT_MS     1000
 
 LEDStripController::LEDStripController()
 {
-
+    serial_queue_supported = true;
+    dropped_frames         = 0;
 }
 
 
@@ -94,6 +110,11 @@ void LEDStripController::Initialize(char* ledstring, led_protocol proto)
     {
         num_leds = atoi(numleds);
     }
+
+    if (serialport != NULL)
+    {
+        LOG_INFO("[LED Strip] %s: %d LEDs at %d baud, up to %.1f FPS", port_name.c_str(), num_leds, baud_rate, GetMaxFPS());
+    }
 }
 
 void LEDStripController::InitializeI2C(char* i2cname)
@@ -159,8 +180,124 @@ char* LEDStripController::GetLEDString()
     return(led_string);
 }
 
-void LEDStripController::SetLEDs(std::vector<RGBColor> colors)
+float LEDStripController::GetMaxFPS()
 {
+    unsigned int packet_size = num_leds * 3;
+
+    if(serialport == NULL)
+    {
+        return(0.0f);
+    }
+
+    switch(protocol)
+    {
+        case LED_PROTOCOL_KEYBOARD_VISUALIZER:
+            packet_size += 3;
+            break;
+
+        case LED_PROTOCOL_ADALIGHT:
+            packet_size += 6;
+            break;
+
+        case LED_PROTOCOL_TPM2:
+            packet_size += 5;
+            break;
+    }
+
+    return((float)baud_rate / (float)(packet_size * SERIAL_BITS_PER_BYTE));
+}
+
+void LEDStripController::WaitForSerialQueue()
+{
+    std::chrono::steady_clock::time_point timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds(SERIAL_QUEUE_TIMEOUT_MS);
+
+    int queued = serialport->serial_output_queue();
+
+    /*-------------------------------------------------------------*\
+    | Fall back to blocking writes if the queue cannot be read      |
+    \*-------------------------------------------------------------*/
+    if(queued < 0)
+    {
+        serial_queue_supported = false;
+        return;
+    }
+
+    /*-------------------------------------------------------------*\
+    | Sleep for about the time the queued bytes take to send at the |
+    | configured baud rate until the previous frame is out          |
+    \*-------------------------------------------------------------*/
+    while(queued > 0)
+    {
+        if(std::chrono::steady_clock::now() >= timeout)
+        {
+            serialport->serial_flush_tx();
+            break;
+        }
+
+        unsigned long long wait_us = ((unsigned long long)queued * SERIAL_BITS_PER_BYTE * 1000000) / std::max(baud_rate, 1);
+
+        std::this_thread::sleep_for(std::chrono::microseconds(std::max(wait_us, 500ULL)));
+
+        queued = serialport->serial_output_queue();
+    }
+}
+
+void LEDStripController::SendSerialFrame(unsigned int packet_size)
+{
+    if(!serial_queue_supported)
+    {
+        serialport->serial_write((char *)frame_buf.data(), packet_size);
+        return;
+    }
+
+    /*-------------------------------------------------------------*\
+    | The port is non-blocking, so the driver may accept only part  |
+    | of the frame.  Write the rest once the queued bytes are out,  |
+    | and give up on the frame if the driver still takes nothing.   |
+    \*-------------------------------------------------------------*/
+    unsigned int    sent    = 0;
+    bool            retried = false;
+
+    while(sent < packet_size)
+    {
+        int written = serialport->serial_write_nowait((char *)frame_buf.data() + sent, packet_size - sent);
+
+        if(written > 0)
+        {
+            sent   += written;
+            retried = false;
+            continue;
+        }
+
+        if(retried)
+        {
+            break;
+        }
+
+        WaitForSerialQueue();
+        retried = true;
+    }
+
+    if(sent < packet_size)
+    {
+        dropped_frames++;
+
+        LOG_DEBUG("[LED Strip] %s: Frame dropped after %u of %u bytes, %u frames dropped", port_name.c_str(), sent, packet_size, dropped_frames);
+    }
+}
+
+void LEDStripController::SetLEDs(const std::vector<RGBColor>& colors)
+{
+    /*-------------------------------------------------------------*\
+    | Wait for the previous frame to finish sending before reading  |
+    | the colors, so the newest colors are sent and frames that     |
+    | arrive in the meantime replace each other instead of queuing  |
+    \*-------------------------------------------------------------*/
+    if((serialport != NULL) && serial_queue_supported)
+    {
+        WaitForSerialQueue();
+    }
+
     switch(protocol)
     {
         case LED_PROTOCOL_KEYBOARD_VISUALIZER:
@@ -181,10 +318,8 @@ void LEDStripController::SetLEDs(std::vector<RGBColor> colors)
     }
 }
 
-void LEDStripController::SetLEDsKeyboardVisualizer(std::vector<RGBColor> colors)
+void LEDStripController::SetLEDsKeyboardVisualizer(const std::vector<RGBColor>& colors)
 {
-    unsigned char *serial_buf;
-
     /*-------------------------------------------------------------*\
     | Keyboard Visualizer Arduino Protocol                          |
     |                                                               |
@@ -198,7 +333,9 @@ void LEDStripController::SetLEDsKeyboardVisualizer(std::vector<RGBColor> colors)
     unsigned int payload_size   = (colors.size() * 3);
     unsigned int packet_size    = payload_size + 3;
 
-    serial_buf = new unsigned char[packet_size];
+    frame_buf.resize(packet_size);
+
+    unsigned char *serial_buf   = frame_buf.data();
 
     /*-------------------------------------------------------------*\
     | Set up header                                                 |
@@ -230,28 +367,24 @@ void LEDStripController::SetLEDsKeyboardVisualizer(std::vector<RGBColor> colors)
     /*-------------------------------------------------------------*\
     | Fill in the checksum bytes                                    |
     \*-------------------------------------------------------------*/
-    serial_buf[(num_leds * 3) + 1] = sum >> 8;
-    serial_buf[(num_leds * 3) + 2] = sum & 0x00FF;
+    serial_buf[payload_size + 1] = sum >> 8;
+    serial_buf[payload_size + 2] = sum & 0x00FF;
 
     /*-------------------------------------------------------------*\
     | Send the packet                                               |
     \*-------------------------------------------------------------*/
     if (serialport != NULL)
     {
-        serialport->serial_write((char *)serial_buf, packet_size);
+        SendSerialFrame(packet_size);
     }
     else if (udpport != NULL)
     {
         udpport->udp_write((char *)serial_buf, packet_size);
     }
-
-    delete[] serial_buf;
 }
 
-void LEDStripController::SetLEDsAdalight(std::vector<RGBColor> colors)
+void LEDStripController::SetLEDsAdalight(const std::vector<RGBColor>& colors)
 {
-    unsigned char *serial_buf;
-
     /*-------------------------------------------------------------*\
     | Adalight Protocol                                             |
     |                                                               |
@@ -269,7 +402,9 @@ void LEDStripController::SetLEDsAdalight(std::vector<RGBColor> colors)
     unsigned int payload_size   = (led_count * 3);
     unsigned int packet_size    = payload_size + 6;
 
-    serial_buf = new unsigned char[packet_size];
+    frame_buf.resize(packet_size);
+
+    unsigned char *serial_buf   = frame_buf.data();
 
     /*-------------------------------------------------------------*\
     | Set up header                                                 |
@@ -298,16 +433,12 @@ void LEDStripController::SetLEDsAdalight(std::vector<RGBColor> colors)
     \*-------------------------------------------------------------*/
     if (serialport != NULL)
     {
-        serialport->serial_write((char *)serial_buf, packet_size);
+        SendSerialFrame(packet_size);
     }
-
-    delete[] serial_buf;
 }
 
-void LEDStripController::SetLEDsTPM2(std::vector<RGBColor> colors)
+void LEDStripController::SetLEDsTPM2(const std::vector<RGBColor>& colors)
 {
-    unsigned char *serial_buf;
-
     /*-------------------------------------------------------------*\
     | TPM2 Protocol                                                 |
     |                                                               |
@@ -323,7 +454,9 @@ void LEDStripController::SetLEDsTPM2(std::vector<RGBColor> colors)
     unsigned int payload_size   = (colors.size() * 3);
     unsigned int packet_size    = payload_size + 5;
 
-    serial_buf = new unsigned char[packet_size];
+    frame_buf.resize(packet_size);
+
+    unsigned char *serial_buf   = frame_buf.data();
 
     /*-------------------------------------------------------------*\
     | Set up header and end byte                                    |
@@ -351,13 +484,11 @@ void LEDStripController::SetLEDsTPM2(std::vector<RGBColor> colors)
     \*-------------------------------------------------------------*/
     if (serialport != NULL)
     {
-        serialport->serial_write((char *)serial_buf, packet_size);
+        SendSerialFrame(packet_size);
     }
-
-    delete[] serial_buf;
 }
 
-void LEDStripController::SetLEDsBasicI2C(std::vector<RGBColor> colors)
+void LEDStripController::SetLEDsBasicI2C(const std::vector<RGBColor>& colors)
 {
     unsigned char serial_buf[30];
 
@@ -58,18 +58,32 @@ public:
     char*       GetLEDString();
     std::string GetLocation();
 
-    void        SetLEDs(std::vector<RGBColor> colors);
+    float       GetMaxFPS();
 
-    void        SetLEDsKeyboardVisualizer(std::vector<RGBColor> colors);
-    void        SetLEDsAdalight(std::vector<RGBColor> colors);
-    void        SetLEDsTPM2(std::vector<RGBColor> colors);
-    void        SetLEDsBasicI2C(std::vector<RGBColor> colors);
+    void        SetLEDs(const std::vector<RGBColor>& colors);
+
+    void        SetLEDsKeyboardVisualizer(const std::vector<RGBColor>& colors);
+    void        SetLEDsAdalight(const std::vector<RGBColor>& colors);
+    void        SetLEDsTPM2(const std::vector<RGBColor>& colors);
+    void        SetLEDsBasicI2C(const std::vector<RGBColor>& colors);
 
     int num_leds;
 
 private:
     int baud_rate;
 
+    /*---------------------------------------------------------*\
+    | Frame buffer reused for every frame.  Serial frames are   |
+    | only written once the previous frame has been sent, so    |
+    | at most one frame is ever queued in the driver.           |
+    \*---------------------------------------------------------*/
+    std::vector<unsigned char> frame_buf;
+    bool        serial_queue_supported;
+    unsigned int dropped_frames;
+
+    void        WaitForSerialQueue();
+    void        SendSerialFrame(unsigned int packet_size);
+
     char led_string[1024];
     std::string port_name;
     std::string client_name;
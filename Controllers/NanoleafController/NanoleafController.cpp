@@ -31,8 +31,11 @@ long APIRequest(std::string method, std::string location, std::string URI, json*
     {
         httplib::Result result = client.Get(URI.c_str());
 
-        status  = result->status;
-        body    = result->body;
+        if(result)
+        {
+            status  = result->status;
+            body    = result->body;
+        }
     }
     else if(method == "PUT")
     {
@@ -40,30 +43,42 @@ long APIRequest(std::string method, std::string location, std::string URI, json*
         {
             httplib::Result result = client.Put(URI.c_str(), request_data->dump(), "application/json");
 
-            status  = result->status;
-            body    = result->body;
+            if(result)
+            {
+                status  = result->status;
+                body    = result->body;
+            }
         }
         else
         {
             httplib::Result result = client.Put(URI.c_str());
 
-            status  = result->status;
-            body    = result->body;
+            if(result)
+            {
+                status  = result->status;
+                body    = result->body;
+            }
         }
     }
     else if(method == "DELETE")
     {
         httplib::Result result = client.Delete(URI.c_str());
 
-        status  = result->status;
-        body    = result->body;
+        if(result)
+        {
+            status  = result->status;
+            body    = result->body;
+        }
     }
     else if(method == "POST")
     {
         httplib::Result result = client.Post(URI.c_str());
 
-        status  = result->status;
-        body    = result->body;
+        if(result)
+        {
+            status  = result->status;
+            body    = result->body;
+        }
     }
 
     /*-------------------------------------------------------------*\
@@ -100,7 +115,7 @@ NanoleafController::NanoleafController(std::string a_address, int a_port, std::s
         firmware_version    = data["firmwareVersion"];
         model               = data["model"];
 
-        brightness          = data["state"]["brightness"]["value"];
+        brightness.store(data["state"]["brightness"]["value"].get<int>());
         selectedEffect      = data["effects"]["select"];
 
         for(json::const_iterator it = data["effects"]["effectsList"].begin(); it != data["effects"]["effectsList"].end(); ++it)
@@ -117,6 +132,21 @@ NanoleafController::NanoleafController(std::string a_address, int a_port, std::s
     {
         throw std::exception();
     }
+
+    /*-------------------------------------------------------------*\
+    | Settings changes made while adjusting the device go through   |
+    | a scheduler so only the latest value is sent                  |
+    \*-------------------------------------------------------------*/
+    scheduler               = rest_scheduler::get(address, port);
+}
+
+NanoleafController::~NanoleafController()
+{
+    scheduler->cancel("state");
+
+    rest_scheduler_stats stats = scheduler->get_stats();
+
+    LOG_DEBUG("[Nanoleaf] %s: %llu requests submitted, %llu sent, %llu coalesced, %llu dropped", location.c_str(), stats.submitted, stats.sent, stats.coalesced, stats.dropped);
 }
 
 std::string NanoleafController::Pair(std::string address, int port)
@@ -289,10 +319,27 @@ void NanoleafController::SetBrightness(int a_brightness)
     json request;
     request["brightness"]["value"] = a_brightness;
 
-    if((APIRequest("PUT", location, "/api/v1/"+auth_token+"/state", &request) / 100) == 2)
+    /*-------------------------------------------------------------*\
+    | Queue the request, replacing any earlier one not yet sent.    |
+    | The brightness is only recorded once the device accepted it.  |
+    | The destructor cancels the request, so this outlives it.      |
+    \*-------------------------------------------------------------*/
+    std::string     uri                 = "/api/v1/" + auth_token + "/state";
+    std::string     body                = request.dump();
+
+    scheduler->submit("state", [this, uri, body, a_brightness]()
     {
-        brightness = a_brightness;
-    }
+        httplib::Result result = scheduler->client()->Put(uri.c_str(), body, "application/json");
+
+        if(!result || ((result->status / 100) != 2))
+        {
+            return(false);
+        }
+
+        brightness.store(a_brightness);
+
+        return(true);
+    });
 }
 
 std::string NanoleafController::GetAuthToken()
@@ -342,5 +389,5 @@ std::string NanoleafController::GetSelectedEffect()
 
 int NanoleafController::GetBrightness()
 {
-    return brightness;
+    return brightness.load();
 };
@@ -10,6 +10,9 @@
 
 #include "RGBController.h"
 #include "net_port.h"
+#include "rest_scheduler.h"
+
+#include <atomic>
 
 #define NANOLEAF_DIRECT_MODE_EFFECT_NAME    "*Dynamic*"
 #define NANOLEAF_LIGHT_PANELS_MODEL         "NL22"
@@ -20,6 +23,7 @@ class NanoleafController
 {
 public:
     NanoleafController(std::string a_address, int a_port, std::string a_auth_token);
+    ~NanoleafController();
 
     static std::string          Pair(std::string address, int port);
     static void                 Unpair(std::string address, int port, std::string auth_token);
@@ -42,6 +46,7 @@ public:
 
 private:
     net_port                    external_control_socket;
+    rest_scheduler*             scheduler;
 
     std::string                 address;
     int                         port;
@@ -58,5 +63,10 @@ private:
     std::vector<int>            panel_ids;
 
     std::string                 selectedEffect;
-    int                         brightness;
+
+    /*-------------------------------------------------------------*\
+    | Written by the scheduler worker once a brightness request is  |
+    | accepted, read from the device and GUI threads                |
+    \*-------------------------------------------------------------*/
+    std::atomic<int>            brightness;
 };
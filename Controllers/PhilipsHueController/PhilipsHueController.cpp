@@ -7,15 +7,27 @@
 #include "PhilipsHueController.h"
 #include "LogManager.h"
 
-PhilipsHueController::PhilipsHueController(hueplusplus::Light light_ptr, std::string bridge_ip):light(light_ptr)
+PhilipsHueController::PhilipsHueController(hueplusplus::Light light_ptr, std::string bridge_ip, int bridge_port):light(light_ptr)
 {
     dark        = false;
     location    = "IP: " + bridge_ip;
+
+    /*-----------------------------------------------------*\
+    | Color changes are sent through the bridge's shared    |
+    | scheduler so lights on the same bridge share its      |
+    | request budget                                        |
+    \*-----------------------------------------------------*/
+    scheduler   = rest_scheduler::get(bridge_ip, bridge_port);
+    request_key = "lights/" + std::to_string(light.getId());
 }
 
 PhilipsHueController::~PhilipsHueController()
 {
+    scheduler->cancel(request_key);
+
+    rest_scheduler_stats stats = scheduler->get_stats();
 
+    LOG_DEBUG("[PhilipsHueController] %s: %llu bridge requests submitted, %llu sent, %llu coalesced, %llu dropped", location.c_str(), stats.submitted, stats.sent, stats.coalesced, stats.dropped);
 }
 
 std::string PhilipsHueController::GetLocation()
@@ -52,31 +64,33 @@ void PhilipsHueController::SetColor(unsigned char red, unsigned char green, unsi
 
     if((red == 0) && (green == 0) && (blue == 0))
     {
-        if(!dark)
+        if(dark)
         {
-            try
-            {
-                light.setColorRGB(rgb, 0);
-            }
-            catch(const std::exception& e)
-            {
-                LOG_ERROR("[PhilipsHueController] An error occured while setting the colors: %s", e.what());
-            }
+            return;
         }
 
-        dark = true;    
+        dark = true;
     }
     else
     {
         dark = false;
+    }
 
+    /*-----------------------------------------------------*\
+    | Queue the color change.  If an earlier change for     |
+    | this light has not been sent yet it is replaced.      |
+    \*-----------------------------------------------------*/
+    scheduler->submit(request_key, [this, rgb]()
+    {
         try
         {
-            light.setColorRGB(rgb, 0);
+            return(light.setColorRGB(rgb, 0));
         }
-        catch(std::exception& e)
+        catch(const std::exception& e)
         {
             LOG_ERROR("[PhilipsHueController] An error occured while setting the colors: %s", e.what());
         }
-    }
+
+        return(false);
+    });
 }
@@ -5,16 +5,22 @@
 \*---------------------------------------------------------*/
 
 #include "HueDeviceTypes.h"
+#include "rest_scheduler.h"
 
 #include <string>
 #include <vector>
 
 #pragma once
 
+/*---------------------------------------------------------*\
+| The bridge handles about 10 light commands per second     |
+\*---------------------------------------------------------*/
+#define PHILIPS_HUE_REQUESTS_PER_SECOND     10
+
 class PhilipsHueController
 {
 public:
-    PhilipsHueController(hueplusplus::Light light_ptr, std::string bridge_ip);
+    PhilipsHueController(hueplusplus::Light light_ptr, std::string bridge_ip, int bridge_port);
     ~PhilipsHueController();
 
     std::string GetLocation();
@@ -29,4 +35,6 @@ private:
     hueplusplus::Light  light;
     std::string         location;
     bool                dark;
+    rest_scheduler*     scheduler;
+    std::string         request_key;
 };
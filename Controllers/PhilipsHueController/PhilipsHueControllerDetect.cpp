@@ -231,6 +231,28 @@ void DetectPhilipsHueControllers()
 
                 if(lights.size() > 0)
                 {
+                    /*-------------------------------------------------*\
+                    | Set the request budget for the bridge, from the   |
+                    | settings entry with the connected bridge's IP     |
+                    \*-------------------------------------------------*/
+                    float requests_per_second = PHILIPS_HUE_REQUESTS_PER_SECOND;
+
+                    if(hue_settings.contains("bridges"))
+                    {
+                        for(const json& bridge_settings : hue_settings["bridges"])
+                        {
+                            if(bridge_settings.contains("ip")
+                            && (bridge_settings["ip"] == bridge.getBridgeIP())
+                            && bridge_settings.contains("requests_per_second"))
+                            {
+                                requests_per_second = bridge_settings["requests_per_second"];
+                                break;
+                            }
+                        }
+                    }
+
+                    rest_scheduler::get(bridge.getBridgeIP(), bridge.getBridgePort())->set_rate_limit(requests_per_second);
+
                     /*-------------------------------------------------*\
                     | Loop through all available lights and add those   |
                     | that have color (RGB) control capability          |
@@ -239,7 +261,7 @@ void DetectPhilipsHueControllers()
                     {
                         if(lights[light_idx].hasColorControl())
                         {
-                            PhilipsHueController*     controller     = new PhilipsHueController(lights[light_idx], bridge.getBridgeIP());
+                            PhilipsHueController*     controller     = new PhilipsHueController(lights[light_idx], bridge.getBridgeIP(), bridge.getBridgePort());
                             RGBController_PhilipsHue* rgb_controller = new RGBController_PhilipsHue(controller);
 
                             ResourceManager::get()->RegisterRGBController(rgb_controller);
@@ -4,17 +4,52 @@
 #include <iostream>
 #include <iomanip>
 #include <chrono>
+#include <cstdlib>
 
 #include "ResourceManager.h"
 
 #include "filesystem.h"
 
+/*-------------------------------------------------*\
+| Number of messages kept for the log console       |
+\*-------------------------------------------------*/
+#define LOG_CONSOLE_MAX_MESSAGES    10000
+
 const char* LogManager::log_codes[] = {"FATAL:", "ERROR:", "Warning:", "Info:", "Verbose:", "Debug:", "Trace:", "Dialog:"};
 
+static void ShutdownLogAtExit()
+{
+    LogManager::get()->shutdown();
+}
+
 LogManager::LogManager()
 {
     base_clock = std::chrono::steady_clock::now();
     log_console_enabled = false;
+    log_stream_opened   = false;
+    loglevel            = LL_INFO;
+    verbosity           = LL_WARNING;
+    print_source        = false;
+
+    /*-------------------------------------------------*\
+    | The queue always holds a node, messages are read  |
+    | from the node after the tail                      |
+    \*-------------------------------------------------*/
+    queue_tail          = new LogQueueNode();
+    queue_tail->next    = nullptr;
+    queue_head          = queue_tail;
+    queue_pending       = 0;
+
+    writer_drains       = 0;
+    writer_draining     = false;
+    writer_running      = true;
+    writer_thread       = new std::thread(&LogManager::WriterThreadFunction, this);
+
+    /*-------------------------------------------------*\
+    | Stop the writer and write out anything still      |
+    | queued on normal exit                             |
+    \*-------------------------------------------------*/
+    std::atexit(ShutdownLogAtExit);
 }
 
 LogManager* LogManager::get()
@@ -112,6 +147,8 @@ void LogManager::configure(json config, const filesystem::path& defaultDir)
         log_stream << "    Launched: " << time_string << std::endl;
         log_stream << "====================================================================================================" << std::endl;
         log_stream << std::endl;
+
+        log_stream_opened = log_stream.is_open();
     }
 
     /*-------------------------------------------------*\
@@ -141,9 +178,75 @@ void LogManager::configure(json config, const filesystem::path& defaultDir)
     /*-------------------------------------------------*\
     | Flush the log                                     |
     \*-------------------------------------------------*/
+    _drain();
     _flush();
 }
 
+void LogManager::_drain()
+{
+    bool console_written = false;
+
+    /*-------------------------------------------------*\
+    | Pop every completely pushed message.  A producer  |
+    | between its exchange and its link is picked up on |
+    | the next drain.                                   |
+    \*-------------------------------------------------*/
+    while(true)
+    {
+        LogQueueNode* next = queue_tail->next.load(std::memory_order_acquire);
+
+        if(next == nullptr)
+        {
+            break;
+        }
+
+        delete queue_tail;
+        queue_tail = next;
+
+        PLogMessage mes = std::move(next->message);
+        queue_pending--;
+
+        /*-------------------------------------------------*\
+        | If the message is within the current verbosity,   |
+        | print it on the screen                            |
+        | TODO: Put the timestamp here                      |
+        \*-------------------------------------------------*/
+        if(mes->level <= verbosity || mes->level == LL_DIALOG)
+        {
+            std::cout << mes->buffer;
+            if(print_source)
+            {
+                std::cout << " [" << mes->filename << ":" << mes->line << "]";
+            }
+            std::cout << '\n';
+
+            console_written = true;
+        }
+
+        /*-------------------------------------------------*\
+        | Add the message to the logfile queue              |
+        \*-------------------------------------------------*/
+        temp_messages.push_back(mes);
+
+        if(log_console_enabled)
+        {
+            std::lock_guard<std::mutex> grd(messages_mutex);
+
+            all_messages.push_back(mes);
+
+            if(all_messages.size() > LOG_CONSOLE_MAX_MESSAGES)
+            {
+                all_messages.pop_front();
+            }
+        }
+    }
+
+    if(console_written)
+    {
+        std::cout.flush();
+    }
+}
+
 void LogManager::_flush()
 {
     /*-------------------------------------------------*\
@@ -166,7 +269,7 @@ void LogManager::_flush()
                     log_stream << " [" << temp_messages[msg]->filename << ":" << temp_messages[msg]->line << "]";
                 }
                 
-                log_stream << std::endl;
+                log_stream << '\n';
             }
         }
 
@@ -185,9 +288,78 @@ void LogManager::_flush()
 void LogManager::flush()
 {
     std::lock_guard<std::mutex> grd(entry_mutex);
+    _drain();
     _flush();
 }
 
+void LogManager::shutdown()
+{
+    /*-------------------------------------------------*\
+    | Stop and join the writer thread, then write out   |
+    | whatever it left queued from this thread          |
+    \*-------------------------------------------------*/
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+
+        if(!writer_running)
+        {
+            return;
+        }
+
+        writer_running = false;
+    }
+
+    writer_cv.notify_all();
+    writer_done_cv.notify_all();
+
+    writer_thread->join();
+    delete writer_thread;
+    writer_thread = nullptr;
+
+    flush();
+}
+
+void LogManager::WriterThreadFunction()
+{
+    while(writer_running)
+    {
+        /*-------------------------------------------------*\
+        | Sleep until messages are queued or shutdown is    |
+        | requested.  The timeout covers a wakeup that was  |
+        | sent just before the wait began.                  |
+        \*-------------------------------------------------*/
+        {
+            std::unique_lock<std::mutex> lock(writer_mutex);
+
+            writer_cv.wait_for(lock, std::chrono::milliseconds(100), [this]
+            {
+                return((queue_pending > 0) || !writer_running);
+            });
+
+            writer_draining = true;
+        }
+
+        /*-------------------------------------------------*\
+        | Write out everything queued so far as one batch,  |
+        | with a single flush of the log file               |
+        \*-------------------------------------------------*/
+        {
+            std::lock_guard<std::mutex> grd(entry_mutex);
+            _drain();
+            _flush();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+
+            writer_draining = false;
+            writer_drains++;
+        }
+
+        writer_done_cv.notify_all();
+    }
+}
+
 void LogManager::_append(const char* filename, int line, unsigned int level, const char* fmt, va_list va)
 {
     /*-------------------------------------------------*\
@@ -201,6 +373,20 @@ void LogManager::_append(const char* filename, int line, unsigned int level, con
         verbosity = LL_DEBUG;
     }
 
+    /*-------------------------------------------------*\
+    | Skip formatting messages that no output will use. |
+    | Until the log file is configured all messages are |
+    | kept, as the configured level is not known yet.   |
+    \*-------------------------------------------------*/
+    if(log_stream_opened
+    && !log_console_enabled
+    && (level != LL_DIALOG)
+    && (level > loglevel)
+    && (level > verbosity))
+    {
+        return;
+    }
+
     /*-------------------------------------------------*\
     | Create a new message                              |
     \*-------------------------------------------------*/
@@ -230,6 +416,8 @@ void LogManager::_append(const char* filename, int line, unsigned int level, con
     \*-------------------------------------------------*/
     if(level == LL_DIALOG)
     {
+        std::lock_guard<std::mutex> grd(dialog_callback_mutex);
+
         for(size_t idx = 0; idx < dialog_show_callbacks.size(); idx++)
         {
             dialog_show_callbacks[idx](dialog_show_callback_args[idx], mes);
@@ -237,43 +425,63 @@ void LogManager::_append(const char* filename, int line, unsigned int level, con
     }
 
     /*-------------------------------------------------*\
-    | If the message is within the current verbosity,   |
-    | print it on the screen                            |
-    | TODO: Put the timestamp here                      |
+    | Push the message onto the writer queue            |
     \*-------------------------------------------------*/
-    if(level <= verbosity || level == LL_DIALOG)
-    {
-        std::cout << mes->buffer;
-        if(print_source)
-        {
-            std::cout << " [" << mes->filename << ":" << mes->line << "]";
-        }
-        std::cout << std::endl;
-    }
+    LogQueueNode* node  = new LogQueueNode();
+    node->message       = mes;
+    node->next.store(nullptr, std::memory_order_relaxed);
+
+    LogQueueNode* prev  = queue_head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+
+    queue_pending++;
 
     /*-------------------------------------------------*\
-    | Add the message to the logfile queue              |
+    | Fatal messages are written out before returning.  |
+    | The writer thread still does the writing, the     |
+    | caller waits for the first drain that started     |
+    | after the message was queued.  Once the writer    |
+    | has stopped, the caller writes it out itself.     |
     \*-------------------------------------------------*/
-    temp_messages.push_back(mes);
+    if(level == LL_FATAL)
+    {
+        std::unique_lock<std::mutex> lock(writer_mutex);
 
-    if(log_console_enabled)
+        if(writer_running)
+        {
+            unsigned long long target = writer_drains + (writer_draining ? 2 : 1);
+
+            writer_cv.notify_one();
+
+            writer_done_cv.wait(lock, [this, target]
+            {
+                return((writer_drains >= target) || !writer_running);
+            });
+        }
+
+        if(!writer_running)
+        {
+            lock.unlock();
+            flush();
+        }
+    }
+    else
     {
-        all_messages.push_back(mes);
+        writer_cv.notify_one();
     }
-
-    /*-------------------------------------------------*\
-    | Flush the queues                                  |
-    \*-------------------------------------------------*/
-    _flush();
 }
 
 std::vector<PLogMessage> LogManager::messages()
 {
-    return all_messages;
+    std::lock_guard<std::mutex> grd(messages_mutex);
+
+    return std::vector<PLogMessage>(all_messages.begin(), all_messages.end());
 }
 
 void LogManager::clearMessages()
 {
+    std::lock_guard<std::mutex> grd(messages_mutex);
+
     all_messages.clear();
 }
 
@@ -282,7 +490,6 @@ void LogManager::append(const char* filename, int line, unsigned int level, cons
     va_list va;
     va_start(va, fmt);
 
-    std::lock_guard<std::mutex> grd(entry_mutex);
     _append(filename, line, level, fmt, va);
 
     va_end(va);
@@ -336,12 +543,16 @@ void LogManager::setPrintSource(bool v)
 void LogManager::RegisterDialogShowCallback(LogDialogShowCallback callback, void* receiver)
 {
     LOG_DEBUG("dialog show callback registered");
+
+    std::lock_guard<std::mutex> grd(dialog_callback_mutex);
     dialog_show_callbacks.push_back(callback);
     dialog_show_callback_args.push_back(receiver);
 }
 
 void LogManager::UnregisterDialogShowCallback(LogDialogShowCallback callback, void* receiver)
 {
+    std::lock_guard<std::mutex> grd(dialog_callback_mutex);
+
     for(size_t idx = 0; idx < dialog_show_callbacks.size(); idx++)
     {
         if(dialog_show_callbacks[idx] == callback && dialog_show_callback_args[idx] == receiver)
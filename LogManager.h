@@ -1,8 +1,12 @@
 #ifndef LOGMANAGER_H
 #define LOGMANAGER_H
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <mutex>
+#include <thread>
 #include <vector>
 #include <queue>
 #include <memory>
@@ -44,6 +48,16 @@ struct LogMessage
 typedef std::shared_ptr<LogMessage> PLogMessage;
 typedef void(*LogDialogShowCallback)(void*, PLogMessage);
 
+/*-------------------------------------------------*\
+| Node of the queue between the threads appending   |
+| messages and the log writer thread                |
+\*-------------------------------------------------*/
+struct LogQueueNode
+{
+    PLogMessage                 message;
+    std::atomic<LogQueueNode*>  next;
+};
+
 class LogManager
 {
 private:
@@ -54,38 +68,71 @@ private:
     std::mutex entry_mutex;
     std::mutex section_mutex;
     std::ofstream log_stream;
+    std::atomic<bool> log_stream_opened;
 
+    std::mutex                          dialog_callback_mutex;
     std::vector<LogDialogShowCallback>  dialog_show_callbacks;
     std::vector<void*>                  dialog_show_callback_args;
 
+    /*-------------------------------------------------*\
+    | Messages are pushed onto a lock-free multiple     |
+    | producer, single consumer queue.  The writer      |
+    | thread, or a caller of flush(), drains it while   |
+    | holding entry_mutex.                              |
+    \*-------------------------------------------------*/
+    std::atomic<LogQueueNode*>  queue_head;
+    LogQueueNode*               queue_tail;
+    std::atomic<unsigned int>   queue_pending;
+
+    std::thread*                writer_thread;
+    std::atomic<bool>           writer_running;
+    std::mutex                  writer_mutex;
+    std::condition_variable     writer_cv;
+
+    /*-------------------------------------------------*\
+    | Counts the writer's completed drains, guarded by  |
+    | writer_mutex, so FATAL callers can wait for their |
+    | message to be written                             |
+    \*-------------------------------------------------*/
+    std::condition_variable     writer_done_cv;
+    unsigned long long          writer_drains;
+    bool                        writer_draining;
+
     // A temporary log message storage to hold them until the stream opens
     std::vector<PLogMessage> temp_messages;
 
-    // A log message storage that will be displayed in the app
-    std::vector<PLogMessage> all_messages;
+    // A log message storage that will be displayed in the app, limited to the most recent messages
+    std::mutex               messages_mutex;
+    std::deque<PLogMessage>  all_messages;
 
     // A flag that marks if the message source file name and line number should be printed on screen
-    bool print_source = false;
+    std::atomic<bool> print_source;
 
     // Logfile max level
-    unsigned int loglevel = LL_INFO;
-    
+    std::atomic<unsigned int> loglevel;
+
     // Verbosity (stdout) max level
-    unsigned int verbosity = LL_WARNING;
+    std::atomic<unsigned int> verbosity;
 
     //Clock from LogManager creation
     std::chrono::time_point<std::chrono::steady_clock> base_clock;
 
-    // A non-guarded append()
+    // Format a message and queue it for the writer thread
     void _append(const char* filename, int line, unsigned int level, const char* fmt, va_list va);
 
+    // Move queued messages to the outputs, entry_mutex must be held
+    void _drain();
+
     // A non-guarded flush()
     void _flush();
 
+    void WriterThreadFunction();
+
 public:
     static LogManager* get();
     void configure(json config, const filesystem::path & defaultDir);
     void flush();
+    void shutdown();
     void append(const char* filename, int line, unsigned int level, const char* fmt, ...);
     void setLoglevel(unsigned int);
     void setVerbosity(unsigned int);
@@ -8,11 +8,11 @@
 
 #include "NetworkClient.h"
 #include "RGBController_Network.h"
+#include <algorithm>
 #include <cstring>
 
 #ifdef _WIN32
 #include <Windows.h>
-#define MSG_NOSIGNAL 0
 #endif
 
 #ifdef __APPLE__
@@ -26,6 +26,13 @@
 
 using namespace std::chrono_literals;
 
+/*---------------------------------------------------------*\
+| Delay between connection attempts.  Starts short so a     |
+| restarted server is picked up quickly, then backs off.    |
+\*---------------------------------------------------------*/
+#define NET_CLIENT_RECONNECT_DELAY_MIN  std::chrono::milliseconds(50)
+#define NET_CLIENT_RECONNECT_DELAY_MAX  std::chrono::milliseconds(1000)
+
 NetworkClient::NetworkClient(std::vector<RGBController *>& control) : controllers(control)
 {
     port_ip                 = "127.0.0.1";
@@ -34,9 +41,13 @@ NetworkClient::NetworkClient(std::vector<RGBController *>& control) : controller
     server_connected        = false;
     server_controller_count = 0;
     change_in_progress      = false;
+    delta_updates           = true;
 
     ListenThread            = NULL;
     ConnectionThread        = NULL;
+
+    pending_controllers_received    = 0;
+    pending_controller_ids_received = false;
 }
 
 NetworkClient::~NetworkClient()
@@ -98,6 +109,11 @@ bool NetworkClient::GetConnected()
     return(server_connected);
 }
 
+bool NetworkClient::GetDeltaUpdates()
+{
+    return(delta_updates && (GetProtocolVersion() >= 6));
+}
+
 bool NetworkClient::GetOnline()
 {
     return(server_connected && server_initialized);
@@ -135,6 +151,11 @@ void NetworkClient::SetPort(unsigned short new_port)
     }
 }
 
+void NetworkClient::SetDeltaUpdates(bool enable)
+{
+    delta_updates = enable;
+}
+
 void NetworkClient::StartClient()
 {
     //Start a TCP server and launch threads
@@ -156,30 +177,39 @@ void NetworkClient::StartClient()
 
 void NetworkClient::StopClient()
 {
+    ConnectionMutex.lock();
+
+    bool was_connected = server_connected;
+
     server_connected = false;
     client_active    = false;
 
-    if(server_connected)
+    ConnectionMutex.unlock();
+
+    ConnectionCV.notify_all();
+
+    if(was_connected)
     {
         shutdown(client_sock, SD_RECEIVE);
         closesocket(client_sock);
     }
 
-    client_active    = false;
-    server_connected = false;
-
-    if(ListenThread)
-    {
-        ListenThread->join();
-        delete ListenThread;
-        ListenThread = nullptr;
-    }
+    /*-------------------------------------------------*\
+    | Join the connection thread first, as it also      |
+    | joins the listener thread when reconnecting       |
+    \*-------------------------------------------------*/
     if(ConnectionThread)
     {
         ConnectionThread->join();
         delete ConnectionThread;
         ConnectionThread = nullptr;
     }
+    if(ListenThread)
+    {
+        ListenThread->join();
+        delete ListenThread;
+        ListenThread = nullptr;
+    }
 
     /*-------------------------------------------------*\
     | Client info has changed, call the callbacks       |
@@ -189,7 +219,8 @@ void NetworkClient::StopClient()
 
 void NetworkClient::ConnectionThreadFunction()
 {
-    unsigned int requested_controllers;
+    std::chrono::milliseconds               reconnect_delay = NET_CLIENT_RECONNECT_DELAY_MIN;
+    std::chrono::steady_clock::time_point   connect_time    = std::chrono::steady_clock::now();
 
     //This thread manages the connection to the server
     while(client_active == true)
@@ -199,15 +230,31 @@ void NetworkClient::ConnectionThreadFunction()
             //Connect to server and reconnect if the connection is lost
             server_initialized = false;
 
+            //Clean up the listener thread from the previous connection
+            if(ListenThread)
+            {
+                ListenThread->join();
+                delete ListenThread;
+                ListenThread = nullptr;
+            }
+
             //Try to connect to server
             if(port.tcp_client_connect() == true)
             {
                 client_sock = port.sock;
                 printf( "Connected to server\n" );
 
+                connect_time    = std::chrono::steady_clock::now();
+                reconnect_delay = NET_CLIENT_RECONNECT_DELAY_MIN;
+
                 //Server is now connected
                 server_connected = true;
 
+                //New connection, the server has no previous frames
+                DeltaFrameMutex.lock();
+                delta_frames.clear();
+                DeltaFrameMutex.unlock();
+
                 //Start the listener thread
                 ListenThread = new std::thread(&NetworkClient::ListenThreadFunction, this);
 
@@ -227,90 +274,351 @@ void NetworkClient::ConnectionThreadFunction()
 
         if(server_initialized == false && server_connected == true)
         {
-            unsigned int timeout_counter     = 0;
-            requested_controllers            = 0;
-            server_controller_count          = 0;
-            server_controller_count_received = false;
-            server_protocol_version_received = false;
-
-            //Wait for server to connect
-            std::this_thread::sleep_for(100ms);
-
-            //Request protocol version
-            SendRequest_ProtocolVersion();
+            std::chrono::steady_clock::time_point init_start = std::chrono::steady_clock::now();
 
-            //Wait up to 1s for protocol version reply
-
-            while(!server_protocol_version_received)
+            if(InitializeServerConnection())
             {
-                std::this_thread::sleep_for(5ms);
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
 
-                timeout_counter++;
+                printf("Client: Ready in %.1f ms (%.1f ms since connect), %d controllers\r\n",
+                       std::chrono::duration<double, std::milli>(now - init_start).count(),
+                       std::chrono::duration<double, std::milli>(now - connect_time).count(),
+                       server_controller_count);
 
                 /*-------------------------------------------------*\
-                | If no protocol version received within 1s, assume |
-                | the server doesn't support protocol versioning    |
-                | and use protocol version 0                        |
+                | Client info has changed, call the callbacks       |
                 \*-------------------------------------------------*/
-                if(timeout_counter > 200)
-                {
-                    server_protocol_version          = 0;
-                    server_protocol_version_received = true;
-                }
+                ClientInfoChanged();
             }
+        }
+
+        /*-------------------------------------------------*\
+        | While connected, sleep until the connection drops |
+        | or the server's device list changes.  Otherwise   |
+        | retry the connection, backing off up to 1s.       |
+        \*-------------------------------------------------*/
+        std::unique_lock<std::mutex> lock(ConnectionMutex);
+
+        if(server_connected)
+        {
+            ConnectionCV.wait(lock, [this]{ return(!client_active || !server_connected || !server_initialized); });
+        }
+        else
+        {
+            ConnectionCV.wait_for(lock, reconnect_delay, [this]{ return(!client_active); });
+
+            reconnect_delay = std::min(reconnect_delay * 2, NET_CLIENT_RECONNECT_DELAY_MAX);
+        }
+    }
+}
+
+/*---------------------------------------------------------*\
+| Bring the controller list in line with the server.  On a  |
+| new connection, the protocol version and controller list  |
+| are requested first.  Controller requests are sent back   |
+| to back and the replies collected as they arrive.  With   |
+| protocol 7 and up, controllers whose ID and revision have |
+| not changed are kept instead of being downloaded again.   |
+| Returns false if the connection is lost, the client       |
+| stopped, or a newer controller list arrived before the    |
+| download finished, in which case it is started over.      |
+\*---------------------------------------------------------*/
+bool NetworkClient::InitializeServerConnection()
+{
+    std::unique_lock<std::mutex> lock(ConnectionMutex);
+
+    /*-------------------------------------------------*\
+    | A device list update from a protocol 7 server     |
+    | already carries the new controller ID list        |
+    \*-------------------------------------------------*/
+    if(!pending_controller_ids_received)
+    {
+        server_controller_count          = 0;
+        server_controller_count_received = false;
+        server_protocol_version_received = false;
+
+        lock.unlock();
 
-            //Once server is connected, send client string
-            SendData_ClientString();
+        //Request protocol version
+        SendRequest_ProtocolVersion();
 
-            //Request number of controllers
+        lock.lock();
+
+        /*-------------------------------------------------*\
+        | If no protocol version received within 1s, assume |
+        | the server doesn't support protocol versioning    |
+        | and use protocol version 0                        |
+        \*-------------------------------------------------*/
+        if(!ConnectionCV.wait_for(lock, 1s, [this]{ return(server_protocol_version_received || !client_active || !server_connected); }))
+        {
+            server_protocol_version          = 0;
+            server_protocol_version_received = true;
+        }
+
+        if(!client_active || !server_connected)
+        {
+            return(false);
+        }
+
+        lock.unlock();
+
+        //Once server is connected, send client string
+        SendData_ClientString();
+
+        //Request controller IDs, or only the number of controllers from older servers
+        if(GetProtocolVersion() >= 7)
+        {
+            SendRequest_ControllerIDs();
+        }
+        else
+        {
             SendRequest_ControllerCount();
+        }
 
-            //Wait for server controller count
-            while(!server_controller_count_received)
-            {
-                std::this_thread::sleep_for(5ms);
-            }
+        lock.lock();
 
-            printf("Client: Received controller count from server: %d\r\n", server_controller_count);
+        //Wait for server controller count
+        ConnectionCV.wait(lock, [this]{ return(server_controller_count_received || !client_active || !server_connected); });
 
-            //Once count is received, request controllers
-            while(requested_controllers < server_controller_count)
-            {
-                printf("Client: Requesting controller %d\r\n", requested_controllers);
+        if(!client_active || !server_connected)
+        {
+            return(false);
+        }
+
+        printf("Client: Received controller count from server: %d\r\n", server_controller_count);
+    }
+
+    std::vector<NetControllerID> controller_ids      = pending_controller_ids;
+    bool                         have_controller_ids = pending_controller_ids_received;
+
+    pending_controller_ids.clear();
+    pending_controller_ids_received = false;
 
-                controller_data_received = false;
-                SendRequest_ControllerData(requested_controllers);
+    if(have_controller_ids)
+    {
+        server_controller_count = controller_ids.size();
+    }
+
+    unsigned int controller_count = server_controller_count;
+
+    lock.unlock();
+
+    /*-------------------------------------------------*\
+    | Match the controllers we already have against the |
+    | new ID list.  Controllers that are gone are       |
+    | removed now and the rest are moved to their new   |
+    | device index.  Unchanged controllers are reused,  |
+    | changed ones stay in the list until their new     |
+    | description arrives.                              |
+    \*-------------------------------------------------*/
+    std::vector<RGBController *>    reused_controllers(controller_count, NULL);
+    std::vector<RGBController *>    removed_controllers;
+    std::vector<RGBController *>    kept_controllers;
+    std::vector<NetControllerID>    kept_controller_ids;
+    unsigned int                    reused_count = 0;
+
+    ControllerListMutex.lock();
+
+    for(std::size_t old_idx = 0; old_idx < server_controllers.size(); old_idx++)
+    {
+        unsigned int new_idx = controller_count;
 
-                //Wait until controller is received
-                while(controller_data_received == false)
+        if(have_controller_ids && (old_idx < server_controller_ids.size()))
+        {
+            for(new_idx = 0; new_idx < controller_count; new_idx++)
+            {
+                if(controller_ids[new_idx].id == server_controller_ids[old_idx].id)
                 {
-                    std::this_thread::sleep_for(5ms);
+                    break;
                 }
+            }
+        }
 
-                requested_controllers++;
+        if(new_idx == controller_count)
+        {
+            for(std::size_t controller_idx = 0; controller_idx < controllers.size(); controller_idx++)
+            {
+                if(controllers[controller_idx] == server_controllers[old_idx])
+                {
+                    controllers.erase(controllers.begin() + controller_idx);
+                    break;
+                }
             }
 
-            ControllerListMutex.lock();
+            removed_controllers.push_back(server_controllers[old_idx]);
+            continue;
+        }
+
+        ((RGBController_Network *)server_controllers[old_idx])->SetDeviceIndex(new_idx);
+
+        kept_controllers.push_back(server_controllers[old_idx]);
+        kept_controller_ids.push_back(server_controller_ids[old_idx]);
+
+        if(controller_ids[new_idx].revision == server_controller_ids[old_idx].revision)
+        {
+            reused_controllers[new_idx] = server_controllers[old_idx];
+            reused_count++;
+        }
+    }
+
+    server_controllers      = kept_controllers;
+    server_controller_ids   = kept_controller_ids;
+
+    /*-------------------------------------------------*\
+    | Device indexes may have moved, start the delta    |
+    | encoded LED updates over                          |
+    \*-------------------------------------------------*/
+    DeltaFrameMutex.lock();
+    delta_frames.clear();
+    DeltaFrameMutex.unlock();
+
+    ControllerListMutex.unlock();
+
+    if(removed_controllers.size() > 0)
+    {
+        for(std::size_t controller_idx = 0; controller_idx < removed_controllers.size(); controller_idx++)
+        {
+            delete removed_controllers[controller_idx];
+        }
+
+        /*-------------------------------------------------*\
+        | Client info has changed, call the callbacks       |
+        \*-------------------------------------------------*/
+        ClientInfoChanged();
+    }
+
+    /*-------------------------------------------------*\
+    | Replies are stored by index as they arrive.       |
+    | Reused controllers fill their slots up front.     |
+    \*-------------------------------------------------*/
+    lock.lock();
+
+    pending_controllers          = reused_controllers;
+    pending_controllers_received = reused_count;
+
+    if(have_controller_ids)
+    {
+        download_controller_ids  = controller_ids;
+    }
+    else
+    {
+        download_controller_ids.clear();
+    }
+
+    lock.unlock();
+
+    if(have_controller_ids && (reused_count > 0))
+    {
+        printf("Client: Reusing %d of %d controllers\r\n", reused_count, controller_count);
+    }
+
+    //Request all controllers that are new or have changed, by ID from protocol 7
+    for(unsigned int requested_controllers = 0; requested_controllers < controller_count; requested_controllers++)
+    {
+        if(reused_controllers[requested_controllers] == NULL)
+        {
+            SendRequest_ControllerData(have_controller_ids ? controller_ids[requested_controllers].id : requested_controllers);
+        }
+    }
 
-            //All controllers received, add them to master list
-            printf("Client: All controllers received, adding them to master list\r\n");
-            for(std::size_t controller_idx = 0; controller_idx < server_controllers.size(); controller_idx++)
+    lock.lock();
+
+    /*-------------------------------------------------*\
+    | Wait until all controllers are received.  If the  |
+    | list changes meanwhile, some replies may never    |
+    | arrive, so start over with the new list.          |
+    \*-------------------------------------------------*/
+    ConnectionCV.wait(lock, [this]{ return((pending_controllers_received == pending_controllers.size()) || pending_controller_ids_received || !client_active || !server_connected); });
+
+    std::vector<RGBController *> received_controllers = pending_controllers;
+    bool                         download_complete    = (pending_controllers_received == pending_controllers.size());
+
+    if(have_controller_ids)
+    {
+        controller_ids = download_controller_ids;
+    }
+
+    pending_controllers.clear();
+    pending_controllers_received = 0;
+    download_controller_ids.clear();
+
+    lock.unlock();
+
+    if(!download_complete || !client_active || !server_connected)
+    {
+        for(std::size_t controller_idx = 0; controller_idx < received_controllers.size(); controller_idx++)
+        {
+            if(received_controllers[controller_idx] != reused_controllers[controller_idx])
             {
-                controllers.push_back(server_controllers[controller_idx]);
+                delete received_controllers[controller_idx];
             }
+        }
+
+        return(false);
+    }
 
-            ControllerListMutex.unlock();
+    ControllerListMutex.lock();
 
-            server_initialized = true;
+    /*-------------------------------------------------*\
+    | Swap the received list in for the current one,    |
+    | keeping track of the changed controllers that     |
+    | have been replaced                                |
+    \*-------------------------------------------------*/
+    std::vector<RGBController *> replaced_controllers;
+
+    for(std::size_t server_controller_idx = 0; server_controller_idx < server_controllers.size(); server_controller_idx++)
+    {
+        for(std::size_t controller_idx = 0; controller_idx < controllers.size(); controller_idx++)
+        {
+            if(controllers[controller_idx] == server_controllers[server_controller_idx])
+            {
+                controllers.erase(controllers.begin() + controller_idx);
+                break;
+            }
+        }
 
-            /*-------------------------------------------------*\
-            | Client info has changed, call the callbacks       |
-            \*-------------------------------------------------*/
-            ClientInfoChanged();
+        if(std::find(received_controllers.begin(), received_controllers.end(), server_controllers[server_controller_idx]) == received_controllers.end())
+        {
+            replaced_controllers.push_back(server_controllers[server_controller_idx]);
         }
+    }
 
-        std::this_thread::sleep_for(1s);
+    server_controllers.clear();
+
+    if(have_controller_ids)
+    {
+        server_controller_ids = controller_ids;
+    }
+    else
+    {
+        server_controller_ids.clear();
     }
+
+    //All controllers received, add them to master list
+    printf("Client: All controllers received, adding them to master list\r\n");
+    for(std::size_t controller_idx = 0; controller_idx < received_controllers.size(); controller_idx++)
+    {
+        server_controllers.push_back(received_controllers[controller_idx]);
+        controllers.push_back(received_controllers[controller_idx]);
+    }
+
+    ControllerListMutex.unlock();
+
+    for(std::size_t controller_idx = 0; controller_idx < replaced_controllers.size(); controller_idx++)
+    {
+        delete replaced_controllers[controller_idx];
+    }
+
+    /*-------------------------------------------------*\
+    | If another device list update arrived meanwhile,  |
+    | leave the server uninitialized so it is applied   |
+    | next                                              |
+    \*-------------------------------------------------*/
+    lock.lock();
+    server_initialized = !pending_controller_ids_received;
+    lock.unlock();
+
+    return(true);
 }
 
 int NetworkClient::recv_select(SOCKET s, char *buf, int len, int flags)
@@ -345,6 +653,32 @@ int NetworkClient::recv_select(SOCKET s, char *buf, int len, int flags)
     }
 }
 
+bool NetworkClient::ReadControllerIDs(unsigned int data_size, char * data, std::vector<NetControllerID> & ids)
+{
+    unsigned int num_controllers;
+
+    if((data == NULL) || (data_size < sizeof(unsigned int)))
+    {
+        return(false);
+    }
+
+    memcpy(&num_controllers, data, sizeof(unsigned int));
+
+    if(((data_size - sizeof(unsigned int)) / sizeof(NetControllerID)) < num_controllers)
+    {
+        return(false);
+    }
+
+    ids.resize(num_controllers);
+
+    for(unsigned int controller_idx = 0; controller_idx < num_controllers; controller_idx++)
+    {
+        memcpy(&ids[controller_idx], &data[sizeof(unsigned int) + (controller_idx * sizeof(NetControllerID))], sizeof(NetControllerID));
+    }
+
+    return(true);
+}
+
 void NetworkClient::ListenThreadFunction()
 {
     printf("Network client listener started\n");
@@ -461,12 +795,16 @@ void NetworkClient::ListenThreadFunction()
                 ProcessReply_ControllerData(header.pkt_size, data, header.pkt_dev_idx);
                 break;
 
+            case NET_PACKET_ID_REQUEST_CONTROLLER_IDS:
+                ProcessReply_ControllerIDs(header.pkt_size, data);
+                break;
+
             case NET_PACKET_ID_REQUEST_PROTOCOL_VERSION:
                 ProcessReply_ProtocolVersion(header.pkt_size, data);
                 break;
 
             case NET_PACKET_ID_DEVICE_LIST_UPDATED:
-                ProcessRequest_DeviceListChanged();
+                ProcessRequest_DeviceListChanged(header.pkt_size, data);
                 break;
         }
 
@@ -475,8 +813,18 @@ void NetworkClient::ListenThreadFunction()
 
 listen_done:
     printf( "Client socket has been closed");
+
+    /*-------------------------------------------------*\
+    | Wake the connection thread so it can reconnect    |
+    \*-------------------------------------------------*/
+    ConnectionMutex.lock();
     server_initialized = false;
     server_connected = false;
+    pending_controller_ids.clear();
+    pending_controller_ids_received = false;
+    ConnectionMutex.unlock();
+
+    ConnectionCV.notify_all();
 
     ControllerListMutex.lock();
 
@@ -495,6 +843,11 @@ listen_done:
     std::vector<RGBController *> server_controllers_copy = server_controllers;
 
     server_controllers.clear();
+    server_controller_ids.clear();
+
+    DeltaFrameMutex.lock();
+    delta_frames.clear();
+    DeltaFrameMutex.unlock();
 
     for(size_t server_controller_idx = 0; server_controller_idx < server_controllers_copy.size(); server_controller_idx++)
     {
@@ -511,36 +864,141 @@ listen_done:
 
 void NetworkClient::WaitOnControllerData()
 {
-    for(int i = 0; i < 1000; i++)
-    {
-        if(controller_data_received)
-        {
-            break;
-        }
-        std::this_thread::sleep_for(1ms);
-    }
+    std::unique_lock<std::mutex> lock(ConnectionMutex);
 
-    return;
+    ConnectionCV.wait_for(lock, 1s, [this]{ return(controller_data_received || !server_connected); });
 }
 
 void NetworkClient::ProcessReply_ControllerCount(unsigned int data_size, char * data)
 {
     if(data_size == sizeof(unsigned int))
     {
+        ConnectionMutex.lock();
         memcpy(&server_controller_count, data, sizeof(unsigned int));
         server_controller_count_received = true;
+        ConnectionMutex.unlock();
+
+        ConnectionCV.notify_all();
     }
 }
 
-void NetworkClient::ProcessReply_ControllerData(unsigned int /*data_size*/, char * data, unsigned int dev_idx)
+void NetworkClient::ProcessReply_ControllerIDs(unsigned int data_size, char * data)
+{
+    std::vector<NetControllerID> controller_ids;
+
+    if(ReadControllerIDs(data_size, data, controller_ids))
+    {
+        ConnectionMutex.lock();
+        pending_controller_ids           = controller_ids;
+        pending_controller_ids_received  = true;
+        server_controller_count          = controller_ids.size();
+        server_controller_count_received = true;
+        ConnectionMutex.unlock();
+
+        ConnectionCV.notify_all();
+    }
+}
+
+void NetworkClient::ProcessReply_ControllerData(unsigned int data_size, char * data, unsigned int dev_idx)
 {
     RGBController_Network * new_controller   = new RGBController_Network(this, dev_idx);
 
     new_controller->ReadDeviceDescription((unsigned char *)data, GetProtocolVersion());
 
+    /*-------------------------------------------------*\
+    | From protocol 7, controllers are requested by ID  |
+    | and the reply ends with the ID and revision of    |
+    | the controller it describes                       |
+    \*-------------------------------------------------*/
+    NetControllerID reply_id;
+    bool            have_reply_id = (GetProtocolVersion() >= 7) && (data_size >= sizeof(NetControllerID));
+
+    if(have_reply_id)
+    {
+        memcpy(&reply_id, &data[data_size - sizeof(NetControllerID)], sizeof(NetControllerID));
+
+        new_controller->SetServerID(reply_id.id);
+    }
+
+    /*-------------------------------------------------*\
+    | While the controller list is being downloaded,    |
+    | store the reply at the index of its ID for the    |
+    | connection thread.  Replies for a controller that |
+    | is not in the list are dropped, the new list      |
+    | restarts the download.                            |
+    \*-------------------------------------------------*/
+    ConnectionMutex.lock();
+
+    if(have_reply_id && !pending_controllers.empty())
+    {
+        dev_idx = pending_controllers.size();
+
+        for(std::size_t id_idx = 0; id_idx < download_controller_ids.size(); id_idx++)
+        {
+            if(download_controller_ids[id_idx].id == reply_id.id)
+            {
+                dev_idx = id_idx;
+                break;
+            }
+        }
+
+        if(dev_idx == pending_controllers.size())
+        {
+            ConnectionMutex.unlock();
+
+            delete new_controller;
+            return;
+        }
+
+        new_controller->SetDeviceIndex(dev_idx);
+    }
+
+    if(dev_idx < pending_controllers.size())
+    {
+        if(pending_controllers[dev_idx] == NULL)
+        {
+            if(have_reply_id)
+            {
+                download_controller_ids[dev_idx].revision = reply_id.revision;
+            }
+
+            pending_controllers[dev_idx] = new_controller;
+            pending_controllers_received++;
+        }
+        else
+        {
+            delete new_controller;
+        }
+
+        ConnectionMutex.unlock();
+
+        ConnectionCV.notify_all();
+        return;
+    }
+
+    ConnectionMutex.unlock();
+
     ControllerListMutex.lock();
 
-    if(dev_idx >= server_controllers.size())
+    if(have_reply_id)
+    {
+        dev_idx = server_controllers.size();
+
+        for(std::size_t id_idx = 0; id_idx < server_controller_ids.size(); id_idx++)
+        {
+            if(server_controller_ids[id_idx].id == reply_id.id)
+            {
+                dev_idx = id_idx;
+                break;
+            }
+        }
+    }
+
+    if(have_reply_id && (dev_idx >= server_controllers.size()))
+    {
+        delete new_controller;
+    }
+    else if(dev_idx >= server_controllers.size())
     {
         server_controllers.push_back(new_controller);
     }
@@ -551,25 +1009,53 @@ void NetworkClient::ProcessReply_ControllerData(unsigned int /*data_size*/, char
         {
             server_controllers[dev_idx]->zones[i].leds_count = new_controller->zones[i].leds_count;
         }
+        server_controllers[dev_idx]->IncrementRevision();
         delete new_controller;
     }
 
     ControllerListMutex.unlock();
 
+    ConnectionMutex.lock();
     controller_data_received = true;
+    ConnectionMutex.unlock();
+
+    ConnectionCV.notify_all();
 }
 
 void NetworkClient::ProcessReply_ProtocolVersion(unsigned int data_size, char * data)
 {
     if(data_size == sizeof(unsigned int))
     {
+        ConnectionMutex.lock();
         memcpy(&server_protocol_version, data, sizeof(unsigned int));
         server_protocol_version_received = true;
+        ConnectionMutex.unlock();
+
+        ConnectionCV.notify_all();
     }
 }
 
-void NetworkClient::ProcessRequest_DeviceListChanged()
+void NetworkClient::ProcessRequest_DeviceListChanged(unsigned int data_size, char * data)
 {
+    /*-------------------------------------------------*\
+    | Protocol 7 servers send the new controller ID     |
+    | list.  Hand it to the connection thread, which    |
+    | only downloads the controllers that changed.      |
+    \*-------------------------------------------------*/
+    std::vector<NetControllerID> controller_ids;
+
+    if((GetProtocolVersion() >= 7) && ReadControllerIDs(data_size, data, controller_ids))
+    {
+        ConnectionMutex.lock();
+        pending_controller_ids          = controller_ids;
+        pending_controller_ids_received = true;
+        server_initialized              = false;
+        ConnectionMutex.unlock();
+
+        ConnectionCV.notify_all();
+        return;
+    }
+
     change_in_progress = true;
 
     ControllerListMutex.lock();
@@ -589,6 +1075,11 @@ void NetworkClient::ProcessRequest_DeviceListChanged()
     std::vector<RGBController *> server_controllers_copy = server_controllers;
 
     server_controllers.clear();
+    server_controller_ids.clear();
+
+    DeltaFrameMutex.lock();
+    delta_frames.clear();
+    DeltaFrameMutex.unlock();
 
     for(size_t server_controller_idx = 0; server_controller_idx < server_controllers_copy.size(); server_controller_idx++)
     {
@@ -603,71 +1094,47 @@ void NetworkClient::ProcessRequest_DeviceListChanged()
     ClientInfoChanged();
 
     /*-------------------------------------------------*\
-    | Mark server as uninitialized and delete the list  |
+    | Mark server as uninitialized and wake the         |
+    | connection thread to download the new list        |
     \*-------------------------------------------------*/
+    ConnectionMutex.lock();
     server_initialized = false;
+    ConnectionMutex.unlock();
+
+    ConnectionCV.notify_all();
 
     change_in_progress = false;
 }
 
 void NetworkClient::SendData_ClientString()
 {
-    NetPacketHeader reply_hdr;
-
-    reply_hdr.pkt_magic[0] = 'O';
-    reply_hdr.pkt_magic[1] = 'R';
-    reply_hdr.pkt_magic[2] = 'G';
-    reply_hdr.pkt_magic[3] = 'B';
-
-    reply_hdr.pkt_dev_idx  = 0;
-    reply_hdr.pkt_id       = NET_PACKET_ID_SET_CLIENT_NAME;
-    reply_hdr.pkt_size     = strlen(client_name.c_str()) + 1;
-
-    send(client_sock, (char *)&reply_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
-    send(client_sock, (char *)client_name.c_str(), reply_hdr.pkt_size, MSG_NOSIGNAL);
+    SendNetPacket(client_sock, 0, NET_PACKET_ID_SET_CLIENT_NAME, client_name.c_str(), strlen(client_name.c_str()) + 1);
 }
 
 void NetworkClient::SendRequest_ControllerCount()
 {
-    NetPacketHeader request_hdr;
-
-    request_hdr.pkt_magic[0] = 'O';
-    request_hdr.pkt_magic[1] = 'R';
-    request_hdr.pkt_magic[2] = 'G';
-    request_hdr.pkt_magic[3] = 'B';
-
-    request_hdr.pkt_dev_idx  = 0;
-    request_hdr.pkt_id       = NET_PACKET_ID_REQUEST_CONTROLLER_COUNT;
-    request_hdr.pkt_size     = 0;
+    SendNetPacket(client_sock, 0, NET_PACKET_ID_REQUEST_CONTROLLER_COUNT, NULL, 0);
+}
 
-    send(client_sock, (char *)&request_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
+void NetworkClient::SendRequest_ControllerIDs()
+{
+    SendNetPacket(client_sock, 0, NET_PACKET_ID_REQUEST_CONTROLLER_IDS, NULL, 0);
 }
 
 void NetworkClient::SendRequest_ControllerData(unsigned int dev_idx)
 {
-    NetPacketHeader request_hdr;
     unsigned int    protocol_version;
 
+    ConnectionMutex.lock();
     controller_data_received = false;
-
-    request_hdr.pkt_magic[0] = 'O';
-    request_hdr.pkt_magic[1] = 'R';
-    request_hdr.pkt_magic[2] = 'G';
-    request_hdr.pkt_magic[3] = 'B';
-
-    request_hdr.pkt_dev_idx  = dev_idx;
-    request_hdr.pkt_id       = NET_PACKET_ID_REQUEST_CONTROLLER_DATA;
+    ConnectionMutex.unlock();
 
     if(server_protocol_version == 0)
     {
-        request_hdr.pkt_size     = 0;
-
-        send(client_sock, (char *)&request_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
+        SendNetPacket(client_sock, dev_idx, NET_PACKET_ID_REQUEST_CONTROLLER_DATA, NULL, 0);
     }
     else
     {
-        request_hdr.pkt_size     = sizeof(unsigned int);
-
         /*-------------------------------------------------------------*\
         | Limit the protocol version to the highest supported by both   |
         | the client and the server.                                    |
@@ -681,29 +1148,17 @@ void NetworkClient::SendRequest_ControllerData(unsigned int dev_idx)
             protocol_version = server_protocol_version;
         }
 
-        send(client_sock, (char *)&request_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
-        send(client_sock, (char *)&protocol_version, sizeof(unsigned int), MSG_NOSIGNAL);
+        SendNetPacket(client_sock, dev_idx, NET_PACKET_ID_REQUEST_CONTROLLER_DATA, &protocol_version, sizeof(unsigned int));
     }
 }
 
 void NetworkClient::SendRequest_ProtocolVersion()
 {
-    NetPacketHeader request_hdr;
     unsigned int    request_data;
 
-    request_hdr.pkt_magic[0] = 'O';
-    request_hdr.pkt_magic[1] = 'R';
-    request_hdr.pkt_magic[2] = 'G';
-    request_hdr.pkt_magic[3] = 'B';
-
-    request_hdr.pkt_dev_idx  = 0;
-    request_hdr.pkt_id       = NET_PACKET_ID_REQUEST_PROTOCOL_VERSION;
-    request_hdr.pkt_size     = sizeof(unsigned int);
-
     request_data             = OPENRGB_SDK_PROTOCOL_VERSION;
 
-    send(client_sock, (char *)&request_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
-    send(client_sock, (char *)&request_data, sizeof(unsigned int), MSG_NOSIGNAL);
+    SendNetPacket(client_sock, 0, NET_PACKET_ID_REQUEST_PROTOCOL_VERSION, &request_data, sizeof(unsigned int));
 }
 
 void NetworkClient::SendRequest_RGBController_ResizeZone(unsigned int dev_idx, int zone, int new_size)
@@ -713,23 +1168,12 @@ void NetworkClient::SendRequest_RGBController_ResizeZone(unsigned int dev_idx, i
         return;
     }
 
-    NetPacketHeader request_hdr;
     int             request_data[2];
 
-    request_hdr.pkt_magic[0] = 'O';
-    request_hdr.pkt_magic[1] = 'R';
-    request_hdr.pkt_magic[2] = 'G';
-    request_hdr.pkt_magic[3] = 'B';
-
-    request_hdr.pkt_dev_idx  = dev_idx;
-    request_hdr.pkt_id       = NET_PACKET_ID_RGBCONTROLLER_RESIZEZONE;
-    request_hdr.pkt_size     = sizeof(request_data);
+    request_data[0] = zone;
+    request_data[1] = new_size;
 
-    request_data[0]          = zone;
-    request_data[1]          = new_size;
-
-    send(client_sock, (char *)&request_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
-    send(client_sock, (char *)&request_data, sizeof(request_data), MSG_NOSIGNAL);
+    SendNetPacket(client_sock, dev_idx, NET_PACKET_ID_RGBCONTROLLER_RESIZEZONE, &request_data, sizeof(request_data));
 }
 
 void NetworkClient::SendRequest_RGBController_UpdateLEDs(unsigned int dev_idx, unsigned char * data, unsigned int size)
@@ -739,19 +1183,7 @@ void NetworkClient::SendRequest_RGBController_UpdateLEDs(unsigned int dev_idx, u
         return;
     }
 
-    NetPacketHeader request_hdr;
-
-    request_hdr.pkt_magic[0] = 'O';
-    request_hdr.pkt_magic[1] = 'R';
-    request_hdr.pkt_magic[2] = 'G';
-    request_hdr.pkt_magic[3] = 'B';
-
-    request_hdr.pkt_dev_idx  = dev_idx;
-    request_hdr.pkt_id       = NET_PACKET_ID_RGBCONTROLLER_UPDATELEDS;
-    request_hdr.pkt_size     = size;
-
-    send(client_sock, (char *)&request_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
-    send(client_sock, (char *)data, size, 0);
+    SendNetPacket(client_sock, dev_idx, NET_PACKET_ID_RGBCONTROLLER_UPDATELEDS, data, size);
 }
 
 void NetworkClient::SendRequest_RGBController_UpdateZoneLEDs(unsigned int dev_idx, unsigned char * data, unsigned int size)
@@ -761,41 +1193,134 @@ void NetworkClient::SendRequest_RGBController_UpdateZoneLEDs(unsigned int dev_id
         return;
     }
 
-    NetPacketHeader request_hdr;
-
-    request_hdr.pkt_magic[0] = 'O';
-    request_hdr.pkt_magic[1] = 'R';
-    request_hdr.pkt_magic[2] = 'G';
-    request_hdr.pkt_magic[3] = 'B';
+    SendNetPacket(client_sock, dev_idx, NET_PACKET_ID_RGBCONTROLLER_UPDATEZONELEDS, data, size);
+}
 
-    request_hdr.pkt_dev_idx  = dev_idx;
-    request_hdr.pkt_id       = NET_PACKET_ID_RGBCONTROLLER_UPDATEZONELEDS;
-    request_hdr.pkt_size     = size;
+void NetworkClient::SendRequest_RGBController_UpdateSingleLED(unsigned int dev_idx, unsigned char * data, unsigned int size)
+{
+    if(change_in_progress)
+    {
+        return;
+    }
 
-    send(client_sock, (char *)&request_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
-    send(client_sock, (char *)data, size, MSG_NOSIGNAL);
+    SendNetPacket(client_sock, dev_idx, NET_PACKET_ID_RGBCONTROLLER_UPDATESINGLELED, data, size);
 }
 
-void NetworkClient::SendRequest_RGBController_UpdateSingleLED(unsigned int dev_idx, unsigned char * data, unsigned int size)
+void NetworkClient::SendRequest_RGBController_UpdateLEDsDelta(unsigned int dev_idx, std::vector<RGBColor> & colors)
 {
     if(change_in_progress)
     {
         return;
     }
 
-    NetPacketHeader request_hdr;
+    std::lock_guard<std::mutex> lock(DeltaFrameMutex);
 
-    request_hdr.pkt_magic[0] = 'O';
-    request_hdr.pkt_magic[1] = 'R';
-    request_hdr.pkt_magic[2] = 'G';
-    request_hdr.pkt_magic[3] = 'B';
+    /*---------------------------------------------------------*\
+    | If there is no previous frame of the same size, send a    |
+    | keyframe encoded against an all-black frame               |
+    \*---------------------------------------------------------*/
+    std::vector<RGBColor> & last_frame  = delta_frames[dev_idx];
+    unsigned char           flags       = 0;
+    unsigned int            num_colors  = colors.size();
 
-    request_hdr.pkt_dev_idx  = dev_idx;
-    request_hdr.pkt_id       = NET_PACKET_ID_RGBCONTROLLER_UPDATESINGLELED;
-    request_hdr.pkt_size     = size;
+    if(last_frame.size() != colors.size())
+    {
+        last_frame.assign(colors.size(), 0);
+        flags |= NET_DELTA_FLAG_KEYFRAME;
+    }
+
+    /*---------------------------------------------------------*\
+    | Only the encoded runs are written here, the reference     |
+    | frame is updated once the packet has been sent            |
+    \*---------------------------------------------------------*/
+
+    /*---------------------------------------------------------*\
+    | Worst case, every LED changed and is sent in runs of      |
+    | 65535 LEDs                                                |
+    \*---------------------------------------------------------*/
+    std::vector<unsigned char>  data_buf;
+    unsigned int                data_size   = 0;
+    unsigned int                data_ptr    = 0;
+
+    data_buf.resize(sizeof(data_size) + sizeof(flags) + sizeof(num_colors) + (num_colors * 3) + (((num_colors / 65535) + 1) * 2 * sizeof(unsigned short)));
+
+    data_ptr += sizeof(data_size);
+
+    memcpy(&data_buf[data_ptr], &flags, sizeof(flags));
+    data_ptr += sizeof(flags);
+
+    memcpy(&data_buf[data_ptr], &num_colors, sizeof(num_colors));
+    data_ptr += sizeof(num_colors);
+
+    unsigned int color_idx = 0;
+
+    while(color_idx < num_colors)
+    {
+        /*-----------------------------------------------------*\
+        | Count the unchanged LEDs, then the changed LEDs that  |
+        | follow.  Single unchanged LEDs inside a run are sent  |
+        | as part of the run, which is smaller than a new run.  |
+        \*-----------------------------------------------------*/
+        unsigned short skip  = 0;
+        unsigned short count = 0;
+
+        while((color_idx < num_colors) && (skip < 0xFFFF) && (colors[color_idx] == last_frame[color_idx]))
+        {
+            skip++;
+            color_idx++;
+        }
 
-    send(client_sock, (char *)&request_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
-    send(client_sock, (char *)data, size, MSG_NOSIGNAL);
+        unsigned int run_start = color_idx;
+
+        while((color_idx < num_colors) && (count < 0xFFFF))
+        {
+            if(colors[color_idx] == last_frame[color_idx])
+            {
+                if(((color_idx + 1) >= num_colors) || (colors[color_idx + 1] == last_frame[color_idx + 1]))
+                {
+                    break;
+                }
+            }
+
+            count++;
+            color_idx++;
+        }
+
+        if((count == 0) && (color_idx >= num_colors))
+        {
+            break;
+        }
+
+        memcpy(&data_buf[data_ptr], &skip, sizeof(skip));
+        data_ptr += sizeof(skip);
+
+        memcpy(&data_buf[data_ptr], &count, sizeof(count));
+        data_ptr += sizeof(count);
+
+        for(unsigned int run_idx = run_start; run_idx < (run_start + count); run_idx++)
+        {
+            data_buf[data_ptr++] = RGBGetRValue(colors[run_idx]);
+            data_buf[data_ptr++] = RGBGetGValue(colors[run_idx]);
+            data_buf[data_ptr++] = RGBGetBValue(colors[run_idx]);
+        }
+    }
+
+    data_size = data_ptr;
+    memcpy(&data_buf[0], &data_size, sizeof(data_size));
+
+    /*---------------------------------------------------------*\
+    | If the packet was not sent the server still has the old   |
+    | frame, or none at all.  Forget the reference frame so the |
+    | next update is sent as a keyframe.                        |
+    \*---------------------------------------------------------*/
+    if(SendNetPacket(client_sock, dev_idx, NET_PACKET_ID_RGBCONTROLLER_UPDATELEDS_DELTA, &data_buf[0], data_size) < 0)
+    {
+        last_frame.clear();
+    }
+    else
+    {
+        last_frame = colors;
+    }
 }
 
 void NetworkClient::SendRequest_RGBController_SetCustomMode(unsigned int dev_idx)
@@ -805,18 +1330,7 @@ void NetworkClient::SendRequest_RGBController_SetCustomMode(unsigned int dev_idx
         return;
     }
 
-    NetPacketHeader request_hdr;
-
-    request_hdr.pkt_magic[0] = 'O';
-    request_hdr.pkt_magic[1] = 'R';
-    request_hdr.pkt_magic[2] = 'G';
-    request_hdr.pkt_magic[3] = 'B';
-
-    request_hdr.pkt_dev_idx  = dev_idx;
-    request_hdr.pkt_id       = NET_PACKET_ID_RGBCONTROLLER_SETCUSTOMMODE;
-    request_hdr.pkt_size     = 0;
-
-    send(client_sock, (char *)&request_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
+    SendNetPacket(client_sock, dev_idx, NET_PACKET_ID_RGBCONTROLLER_SETCUSTOMMODE, NULL, 0);
 }
 
 void NetworkClient::SendRequest_RGBController_UpdateMode(unsigned int dev_idx, unsigned char * data, unsigned int size)
@@ -826,19 +1340,7 @@ void NetworkClient::SendRequest_RGBController_UpdateMode(unsigned int dev_idx, u
         return;
     }
 
-    NetPacketHeader request_hdr;
-
-    request_hdr.pkt_magic[0] = 'O';
-    request_hdr.pkt_magic[1] = 'R';
-    request_hdr.pkt_magic[2] = 'G';
-    request_hdr.pkt_magic[3] = 'B';
-
-    request_hdr.pkt_dev_idx  = dev_idx;
-    request_hdr.pkt_id       = NET_PACKET_ID_RGBCONTROLLER_UPDATEMODE;
-    request_hdr.pkt_size     = size;
-
-    send(client_sock, (char *)&request_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
-    send(client_sock, (char *)data, size, MSG_NOSIGNAL);
+    SendNetPacket(client_sock, dev_idx, NET_PACKET_ID_RGBCONTROLLER_UPDATEMODE, data, size);
 }
 
 void NetworkClient::SendRequest_RGBController_SaveMode(unsigned int dev_idx, unsigned char * data, unsigned int size)
@@ -848,86 +1350,27 @@ void NetworkClient::SendRequest_RGBController_SaveMode(unsigned int dev_idx, uns
         return;
     }
 
-    NetPacketHeader request_hdr;
-
-    request_hdr.pkt_magic[0] = 'O';
-    request_hdr.pkt_magic[1] = 'R';
-    request_hdr.pkt_magic[2] = 'G';
-    request_hdr.pkt_magic[3] = 'B';
-
-    request_hdr.pkt_dev_idx  = dev_idx;
-    request_hdr.pkt_id       = NET_PACKET_ID_RGBCONTROLLER_SAVEMODE;
-    request_hdr.pkt_size     = size;
-
-    send(client_sock, (char *)&request_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
-    send(client_sock, (char *)data, size, MSG_NOSIGNAL);
+    SendNetPacket(client_sock, dev_idx, NET_PACKET_ID_RGBCONTROLLER_SAVEMODE, data, size);
 }
 
 void NetworkClient::SendRequest_LoadProfile(std::string profile_name)
 {
-    NetPacketHeader reply_hdr;
-
-    reply_hdr.pkt_magic[0] = 'O';
-    reply_hdr.pkt_magic[1] = 'R';
-    reply_hdr.pkt_magic[2] = 'G';
-    reply_hdr.pkt_magic[3] = 'B';
-
-    reply_hdr.pkt_dev_idx  = 0;
-    reply_hdr.pkt_id       = NET_PACKET_ID_REQUEST_LOAD_PROFILE;
-    reply_hdr.pkt_size     = strlen(profile_name.c_str()) + 1;
-
-    send(client_sock, (char *)&reply_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
-    send(client_sock, (char *)profile_name.c_str(), reply_hdr.pkt_size, MSG_NOSIGNAL);
+    SendNetPacket(client_sock, 0, NET_PACKET_ID_REQUEST_LOAD_PROFILE, profile_name.c_str(), strlen(profile_name.c_str()) + 1);
 }
 
 void NetworkClient::SendRequest_SaveProfile(std::string profile_name)
 {
-    NetPacketHeader reply_hdr;
-
-    reply_hdr.pkt_magic[0] = 'O';
-    reply_hdr.pkt_magic[1] = 'R';
-    reply_hdr.pkt_magic[2] = 'G';
-    reply_hdr.pkt_magic[3] = 'B';
-
-    reply_hdr.pkt_dev_idx  = 0;
-    reply_hdr.pkt_id       = NET_PACKET_ID_REQUEST_SAVE_PROFILE;
-    reply_hdr.pkt_size     = strlen(profile_name.c_str()) + 1;
-
-    send(client_sock, (char *)&reply_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
-    send(client_sock, (char *)profile_name.c_str(), reply_hdr.pkt_size, MSG_NOSIGNAL);
+    SendNetPacket(client_sock, 0, NET_PACKET_ID_REQUEST_SAVE_PROFILE, profile_name.c_str(), strlen(profile_name.c_str()) + 1);
 }
 
 void NetworkClient::SendRequest_DeleteProfile(std::string profile_name)
 {
-    NetPacketHeader reply_hdr;
-
-    reply_hdr.pkt_magic[0] = 'O';
-    reply_hdr.pkt_magic[1] = 'R';
-    reply_hdr.pkt_magic[2] = 'G';
-    reply_hdr.pkt_magic[3] = 'B';
-
-    reply_hdr.pkt_dev_idx  = 0;
-    reply_hdr.pkt_id       = NET_PACKET_ID_REQUEST_DELETE_PROFILE;
-    reply_hdr.pkt_size     = strlen(profile_name.c_str()) + 1;
-
-    send(client_sock, (char *)&reply_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
-    send(client_sock, (char *)profile_name.c_str(), reply_hdr.pkt_size, MSG_NOSIGNAL);
+    SendNetPacket(client_sock, 0, NET_PACKET_ID_REQUEST_DELETE_PROFILE, profile_name.c_str(), strlen(profile_name.c_str()) + 1);
 }
 
 void NetworkClient::SendRequest_GetProfileList()
 {
-    NetPacketHeader reply_hdr;
-
-    reply_hdr.pkt_magic[0] = 'O';
-    reply_hdr.pkt_magic[1] = 'R';
-    reply_hdr.pkt_magic[2] = 'G';
-    reply_hdr.pkt_magic[3] = 'B';
-
-    reply_hdr.pkt_dev_idx  = 0;
-    reply_hdr.pkt_id       = NET_PACKET_ID_REQUEST_PROFILE_LIST;
-    reply_hdr.pkt_size     = 0;
-
-    send(client_sock, (char *)&reply_hdr, sizeof(NetPacketHeader), MSG_NOSIGNAL);
+    SendNetPacket(client_sock, 0, NET_PACKET_ID_REQUEST_PROFILE_LIST, NULL, 0);
 }
 
 std::vector<std::string> * NetworkClient::ProcessReply_ProfileList(unsigned int data_size, char * data)
@@ -10,6 +10,8 @@
 #include "NetworkProtocol.h"
 #include "net_port.h"
 
+#include <condition_variable>
+#include <map>
 #include <mutex>
 #include <thread>
 
@@ -30,6 +32,7 @@ public:
     unsigned short  GetPort();
     unsigned int    GetProtocolVersion();
     bool            GetOnline();
+    bool            GetDeltaUpdates();
 
     void            ClearCallbacks();
     void            RegisterClientInfoChangeCallback(NetClientCallback new_callback, void * new_callback_arg);
@@ -37,25 +40,29 @@ public:
     void            SetIP(std::string new_ip);
     void            SetName(std::string new_name);
     void            SetPort(unsigned short new_port);
+    void            SetDeltaUpdates(bool enable);
 
     void            StartClient();
     void            StopClient();
 
     void            ConnectionThreadFunction();
+    bool            InitializeServerConnection();
     void            ListenThreadFunction();
 
     void            WaitOnControllerData();
     
     void        ProcessReply_ControllerCount(unsigned int data_size, char * data);
+    void        ProcessReply_ControllerIDs(unsigned int data_size, char * data);
     void        ProcessReply_ControllerData(unsigned int data_size, char * data, unsigned int dev_idx);
     void        ProcessReply_ProtocolVersion(unsigned int data_size, char * data);
 
-    void        ProcessRequest_DeviceListChanged();
+    void        ProcessRequest_DeviceListChanged(unsigned int data_size, char * data);
 
     void        SendData_ClientString();
 
     void        SendRequest_ControllerCount();
     void        SendRequest_ControllerData(unsigned int dev_idx);
+    void        SendRequest_ControllerIDs();
     void        SendRequest_ProtocolVersion();
 
     void        SendRequest_RGBController_ResizeZone(unsigned int dev_idx, int zone, int new_size);
@@ -63,6 +70,7 @@ public:
     void        SendRequest_RGBController_UpdateLEDs(unsigned int dev_idx, unsigned char * data, unsigned int size);
     void        SendRequest_RGBController_UpdateZoneLEDs(unsigned int dev_idx, unsigned char * data, unsigned int size);
     void        SendRequest_RGBController_UpdateSingleLED(unsigned int dev_idx, unsigned char * data, unsigned int size);
+    void        SendRequest_RGBController_UpdateLEDsDelta(unsigned int dev_idx, std::vector<RGBColor> & colors);
 
     void        SendRequest_RGBController_SetCustomMode(unsigned int dev_idx);
 
@@ -104,9 +112,50 @@ private:
     std::thread *   ConnectionThread;
     std::thread *   ListenThread;
 
+    /*-----------------------------------------------------*\
+    | Connection state and setup replies are signalled to   |
+    | the connection thread through ConnectionCV.  During   |
+    | setup, controller replies are stored by index.        |
+    \*-----------------------------------------------------*/
+    std::mutex                          ConnectionMutex;
+    std::condition_variable             ConnectionCV;
+    std::vector<RGBController *>        pending_controllers;
+    unsigned int                        pending_controllers_received;
+
+    /*-----------------------------------------------------*\
+    | Controller IDs and revisions, protocol 7 and up.      |
+    | server_controller_ids matches server_controllers and  |
+    | is protected by ControllerListMutex.  A new ID list   |
+    | from the server is held in pending_controller_ids     |
+    | until the connection thread applies it.               |
+    \*-----------------------------------------------------*/
+    std::vector<NetControllerID>        server_controller_ids;
+    std::vector<NetControllerID>        pending_controller_ids;
+    bool                                pending_controller_ids_received;
+
+    /*-----------------------------------------------------*\
+    | The ID list being downloaded, protected by            |
+    | ConnectionMutex.  Controller data replies carry the   |
+    | controller's ID so a reply for a controller that has  |
+    | since moved is not stored in the wrong slot.          |
+    \*-----------------------------------------------------*/
+    std::vector<NetControllerID>        download_controller_ids;
+
+    /*-----------------------------------------------------*\
+    | Last frame sent for each device address, used as the  |
+    | base for delta encoded LED updates.  Delta updates    |
+    | are only used when enabled and the server supports    |
+    | them.                                                 |
+    \*-----------------------------------------------------*/
+    bool                                delta_updates;
+    std::mutex                          DeltaFrameMutex;
+    std::map<unsigned int, std::vector<RGBColor>> delta_frames;
+
     std::mutex                          ClientInfoChangeMutex;
     std::vector<NetClientCallback>      ClientInfoChangeCallbacks;
     std::vector<void *>                 ClientInfoChangeCallbackArgs;
 
     int recv_select(SOCKET s, char *buf, int len, int flags);
+
+    bool ReadControllerIDs(unsigned int data_size, char * data, std::vector<NetControllerID> & ids);
 };
@@ -1,20 +1,246 @@
+/*-----------------------------------------*\
+|  NetworkProtocol.cpp                      |
+|                                           |
+|  Packet writer for OpenRGB SDK            |
+|                                           |
+|  Adam Honse (CalcProgrammer1) 5/9/2020    |
+\*-----------------------------------------*/
+
 #include "NetworkProtocol.h"
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#ifdef WIN32
+#define MSG_NOSIGNAL 0
+#else
+#include <errno.h>
+#include <poll.h>
+#include <sys/uio.h>
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/*---------------------------------------------------------*\
+| How long to wait for a slow peer to accept the rest of a  |
+| packet before giving up on the connection                 |
+\*---------------------------------------------------------*/
+#define NET_SEND_TIMEOUT_MS 5000
+
+/*---------------------------------------------------------*\
+| Packets on one socket may be sent from several threads.   |
+| Each packet is written while holding its socket's send    |
+| lock so that packets never interleave.                    |
+\*---------------------------------------------------------*/
+static std::mutex & GetSendLock(SOCKET sock)
+{
+    static std::mutex                   send_locks_mutex;
+    static std::map<SOCKET, std::mutex> send_locks;
+
+    std::lock_guard<std::mutex> lock(send_locks_mutex);
+
+    return(send_locks[sock]);
+}
+
+void InitNetPacketHeader
+    (
+    NetPacketHeader *       pkt_hdr,
+    unsigned int            pkt_dev_idx,
+    unsigned int            pkt_id,
+    unsigned int            pkt_size
+    )
+{
+    pkt_hdr->pkt_magic[0] = 'O';
+    pkt_hdr->pkt_magic[1] = 'R';
+    pkt_hdr->pkt_magic[2] = 'G';
+    pkt_hdr->pkt_magic[3] = 'B';
+
+    pkt_hdr->pkt_dev_idx  = pkt_dev_idx;
+    pkt_hdr->pkt_id       = pkt_id;
+    pkt_hdr->pkt_size     = pkt_size;
+}
 
-NetPacketHeader * InitNetPacketHeader
+int SendNetPacket
     (
-    unsigned int        pkt_dev_idx,
-    unsigned int        pkt_id,
-    unsigned int        pkt_size
+    SOCKET                  sock,
+    unsigned int            pkt_dev_idx,
+    unsigned int            pkt_id,
+    const void *            data,
+    unsigned int            data_size
     )
 {
-    NetPacketHeader * new_header = new NetPacketHeader;
+    NetPacketBuffer buffer;
+
+    buffer.data = data;
+    buffer.size = data_size;
+
+    return(SendNetPacketBuffers(sock, pkt_dev_idx, pkt_id, &buffer, 1));
+}
+
+int SendNetPacketBuffers
+    (
+    SOCKET                  sock,
+    unsigned int            pkt_dev_idx,
+    unsigned int            pkt_id,
+    const NetPacketBuffer * buffers,
+    unsigned int            num_buffers
+    )
+{
+    NetPacketHeader pkt_hdr;
+    unsigned int    pkt_size    = 0;
+
+    if(num_buffers > NET_PACKET_MAX_BUFFERS)
+    {
+        return(-1);
+    }
+
+    for(unsigned int buf_idx = 0; buf_idx < num_buffers; buf_idx++)
+    {
+        pkt_size += buffers[buf_idx].size;
+    }
+
+    InitNetPacketHeader(&pkt_hdr, pkt_dev_idx, pkt_id, pkt_size);
+
+    std::size_t total_size  = sizeof(NetPacketHeader) + pkt_size;
+    std::size_t total_sent  = 0;
+
+    std::lock_guard<std::mutex> send_lock(GetSendLock(sock));
+
+#ifdef WIN32
+    /*-------------------------------------------------*\
+    | Coalesce header and data into one buffer and send |
+    | it, retrying until everything has been written    |
+    \*-------------------------------------------------*/
+    std::vector<char> pkt_buf(total_size);
+    std::size_t       pkt_ptr = 0;
+
+    memcpy(&pkt_buf[pkt_ptr], &pkt_hdr, sizeof(NetPacketHeader));
+    pkt_ptr += sizeof(NetPacketHeader);
+
+    for(unsigned int buf_idx = 0; buf_idx < num_buffers; buf_idx++)
+    {
+        if(buffers[buf_idx].size > 0)
+        {
+            memcpy(&pkt_buf[pkt_ptr], buffers[buf_idx].data, buffers[buf_idx].size);
+            pkt_ptr += buffers[buf_idx].size;
+        }
+    }
+
+    while(total_sent < total_size)
+    {
+        int sent = send(sock, &pkt_buf[total_sent], (int)(total_size - total_sent), MSG_NOSIGNAL);
+
+        if(sent <= 0)
+        {
+            /*-----------------------------------------*\
+            | The rest of a partly sent packet can not  |
+            | be resent, close the connection instead   |
+            | of leaving the stream out of sync         |
+            \*-----------------------------------------*/
+            if(total_sent > 0)
+            {
+                shutdown(sock, SD_BOTH);
+            }
+
+            return(-1);
+        }
+
+        total_sent += sent;
+    }
+#else
+    /*-------------------------------------------------*\
+    | Gather header and data into one sendmsg call      |
+    \*-------------------------------------------------*/
+    struct iovec    iov[NET_PACKET_MAX_BUFFERS + 1];
+    struct msghdr   msg;
+    unsigned int    iov_count   = 0;
+
+    iov[iov_count].iov_base = &pkt_hdr;
+    iov[iov_count].iov_len  = sizeof(NetPacketHeader);
+    iov_count++;
+
+    for(unsigned int buf_idx = 0; buf_idx < num_buffers; buf_idx++)
+    {
+        if(buffers[buf_idx].size > 0)
+        {
+            iov[iov_count].iov_base = (void *)buffers[buf_idx].data;
+            iov[iov_count].iov_len  = buffers[buf_idx].size;
+            iov_count++;
+        }
+    }
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov     = iov;
+    msg.msg_iovlen  = iov_count;
+
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(NET_SEND_TIMEOUT_MS);
+
+    while(total_sent < total_size)
+    {
+        ssize_t sent = sendmsg(sock, &msg, MSG_NOSIGNAL);
+
+        if(sent < 0)
+        {
+            /*-----------------------------------------*\
+            | Non-blocking sockets may not accept all   |
+            | of the data, wait until writable again    |
+            \*-----------------------------------------*/
+            if((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                struct pollfd pfd;
+
+                pfd.fd      = sock;
+                pfd.events  = POLLOUT;
+
+                int timeout_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+
+                if((timeout_ms > 0) && (poll(&pfd, 1, timeout_ms) > 0))
+                {
+                    continue;
+                }
+            }
+            else if(errno == EINTR)
+            {
+                continue;
+            }
+
+            /*-----------------------------------------*\
+            | The rest of a partly sent packet can not  |
+            | be resent, close the connection instead   |
+            | of leaving the stream out of sync         |
+            \*-----------------------------------------*/
+            if(total_sent > 0)
+            {
+                shutdown(sock, SD_BOTH);
+            }
+
+            return(-1);
+        }
+
+        total_sent += sent;
+
+        /*-------------------------------------------------*\
+        | On a partial write, skip the buffers that were    |
+        | fully sent and offset into the first remaining one|
+        \*-------------------------------------------------*/
+        while((msg.msg_iovlen > 0) && ((std::size_t)sent >= msg.msg_iov[0].iov_len))
+        {
+            sent -= msg.msg_iov[0].iov_len;
+            msg.msg_iov++;
+            msg.msg_iovlen--;
+        }
 
-    new_header->pkt_magic[0] = 'O';
-    new_header->pkt_magic[1] = 'R';
-    new_header->pkt_magic[2] = 'G';
-    new_header->pkt_magic[3] = 'B';
+        if(msg.msg_iovlen > 0)
+        {
+            msg.msg_iov[0].iov_base  = (char *)msg.msg_iov[0].iov_base + sent;
+            msg.msg_iov[0].iov_len  -= sent;
+        }
+    }
+#endif
 
-    new_header->pkt_dev_idx  = pkt_dev_idx;
-    new_header->pkt_id       = pkt_id;
-    new_header->pkt_size     = pkt_size;
-}
\ No newline at end of file
+    return((int)total_sent);
+}
@@ -8,6 +8,8 @@
 
 #pragma once
 
+#include "net_port.h"
+
 /*---------------------------------------------------------------------*\
 | OpenRGB SDK protocol version                                          |
 |                                                                       |
@@ -16,8 +18,12 @@
 |   2:      Add profile controls (Release 0.6)                          |
 |   3:      Add brightness field to modes (Release 0.7)                 |
 |   4:      Add segments field to zones, network plugins (Release 0.9)  |
+|   5:      Add batched multi-device LED updates                        |
+|   6:      Add delta encoded LED updates                               |
+|   7:      Add controller IDs and incremental device list updates      |
+|   8:      Use 32-bit counts in device, mode and color descriptions    |
 \*---------------------------------------------------------------------*/
-#define OPENRGB_SDK_PROTOCOL_VERSION    4
+#define OPENRGB_SDK_PROTOCOL_VERSION    8
 
 /*-----------------------------------------------------*\
 | Default Interface to bind to.                         |
@@ -38,6 +44,62 @@ typedef struct NetPacketHeader
     unsigned int        pkt_size;                   /* Packet size                                          */
 } NetPacketHeader;
 
+/*-----------------------------------------------------*\
+| Delta encoded LED updates                             |
+|   The payload is a list of runs against the previous  |
+|   frame sent for the device on this connection:       |
+|     unsigned int      data_size                       |
+|     unsigned char     flags                           |
+|     unsigned int      num_colors                      |
+|     runs of:                                          |
+|       unsigned short  skip  (LEDs left unchanged)     |
+|       unsigned short  count (LEDs that follow)        |
+|       count x 3 bytes (packed R, G, B)                |
+|   A keyframe is encoded against an all-black frame.   |
+\*-----------------------------------------------------*/
+enum
+{
+    NET_DELTA_FLAG_KEYFRAME                     = (1 << 0), /* Frame is not relative to the previous one    */
+};
+
+/*-----------------------------------------------------*\
+| Controller IDs                                        |
+|   Each controller on the server has an ID that stays  |
+|   the same while the controller exists, and a         |
+|   revision that changes when its description (zones,  |
+|   active mode) changes.  The controller ID list is    |
+|   sent in reply to REQUEST_CONTROLLER_IDS and, for    |
+|   protocol 7 clients, as the payload of               |
+|   DEVICE_LIST_UPDATED:                                |
+|     unsigned int      num_controllers                 |
+|     num_controllers x NetControllerID, in device      |
+|     index order                                       |
+|   Clients only need to request the data of            |
+|   controllers whose ID is new or whose revision has   |
+|   changed.                                            |
+|                                                       |
+|   For protocol 7 clients, the controller data reply   |
+|   ends with the NetControllerID of the controller,    |
+|   and RGBCONTROLLER requests carry the controller ID  |
+|   in pkt_dev_idx instead of the device index.         |
+\*-----------------------------------------------------*/
+typedef struct NetControllerID
+{
+    unsigned int        id;                         /* Controller ID                                        */
+    unsigned int        revision;                   /* Controller description revision                      */
+} NetControllerID;
+
+/*-----------------------------------------------------*\
+| Maximum number of data buffers in a single packet     |
+\*-----------------------------------------------------*/
+#define NET_PACKET_MAX_BUFFERS  5
+
+typedef struct NetPacketBuffer
+{
+    const void *        data;                       /* Pointer to data to send                              */
+    unsigned int        size;                       /* Size of data to send                                 */
+} NetPacketBuffer;
+
 enum
 {
     /*----------------------------------------------------------------------------------------------------------*\
@@ -45,6 +107,7 @@ enum
     \*----------------------------------------------------------------------------------------------------------*/
     NET_PACKET_ID_REQUEST_CONTROLLER_COUNT      = 0,    /* Request RGBController device count from server       */
     NET_PACKET_ID_REQUEST_CONTROLLER_DATA       = 1,    /* Request RGBController data block                     */
+    NET_PACKET_ID_REQUEST_CONTROLLER_IDS        = 2,    /* Request RGBController IDs and revisions              */
 
     NET_PACKET_ID_REQUEST_PROTOCOL_VERSION      = 40,   /* Request OpenRGB SDK protocol version from server     */
 
@@ -68,8 +131,46 @@ enum
     NET_PACKET_ID_RGBCONTROLLER_UPDATELEDS      = 1050, /* RGBController::UpdateLEDs()                          */
     NET_PACKET_ID_RGBCONTROLLER_UPDATEZONELEDS  = 1051, /* RGBController::UpdateZoneLEDs()                      */
     NET_PACKET_ID_RGBCONTROLLER_UPDATESINGLELED = 1052, /* RGBController::UpdateSingleLED()                     */
+    NET_PACKET_ID_RGBCONTROLLER_UPDATELEDS_BATCH= 1053, /* RGBController::UpdateLEDs() on multiple devices      */
+    NET_PACKET_ID_RGBCONTROLLER_UPDATELEDS_DELTA= 1054, /* RGBController::UpdateLEDs() with delta encoding      */
 
     NET_PACKET_ID_RGBCONTROLLER_SETCUSTOMMODE   = 1100, /* RGBController::SetCustomMode()                       */
     NET_PACKET_ID_RGBCONTROLLER_UPDATEMODE      = 1101, /* RGBController::UpdateMode()                          */
     NET_PACKET_ID_RGBCONTROLLER_SAVEMODE        = 1102, /* RGBController::SaveMode()                            */
 };
+
+/*-----------------------------------------------------*\
+| Packet writer functions                               |
+|   These build the packet header and send it together  |
+|   with the packet data in a single call, retrying on  |
+|   partial writes.  Packets on the same socket are     |
+|   sent one at a time.  If a packet can only be partly |
+|   sent, the connection is shut down so the peer never |
+|   sees a truncated packet.  Returns the number of     |
+|   bytes sent or -1 on error.                          |
+\*-----------------------------------------------------*/
+void InitNetPacketHeader
+    (
+    NetPacketHeader *       pkt_hdr,
+    unsigned int            pkt_dev_idx,
+    unsigned int            pkt_id,
+    unsigned int            pkt_size
+    );
+
+int SendNetPacket
+    (
+    SOCKET                  sock,
+    unsigned int            pkt_dev_idx,
+    unsigned int            pkt_id,
+    const void *            data,
+    unsigned int            data_size
+    );
+
+int SendNetPacketBuffers
+    (
+    SOCKET                  sock,
+    unsigned int            pkt_dev_idx,
+    unsigned int            pkt_id,
+    const NetPacketBuffer * buffers,
+    unsigned int            num_buffers
+    );
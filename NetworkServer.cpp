@@ -8,8 +8,15 @@
 
 #include "NetworkServer.h"
 #include "LogManager.h"
+#include "ResourceManager.h"
+#include <algorithm>
 #include <cstring>
 
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
 #ifndef WIN32
 #include <sys/ioctl.h>
 #include <netinet/tcp.h>
@@ -23,7 +30,7 @@
 #include <stdlib.h>
 #include <iostream>
 
-const char yes = 1;
+const int yes = 1;
 
 #ifdef WIN32
 #include <Windows.h>
@@ -40,6 +47,17 @@ NetworkClientInfo::NetworkClientInfo()
     client_sock             = INVALID_SOCKET;
     client_listen_thread    = nullptr;
     client_protocol_version = 0;
+    recv_buf.resize(NET_RECV_BUFFER_SIZE);
+    recv_buf_start          = 0;
+    recv_buf_end            = 0;
+    delta_frames_reset      = false;
+    send_buffered           = false;
+    send_buf_start          = 0;
+    send_epoll_fd           = -1;
+    send_epoll_out          = false;
+    send_failed             = false;
+    send_refs               = 0;
+    removed                 = false;
 }
 
 NetworkClientInfo::~NetworkClientInfo()
@@ -64,6 +82,15 @@ NetworkServer::NetworkServer(std::vector<RGBController *>& control) : controller
         ConnectionThread[i] = nullptr;
     }
     profile_manager  = nullptr;
+
+    event_loop          = false;
+    event_thread_count  = NET_SERVER_EVENT_THREADS_DEFAULT;
+    max_clients         = NET_SERVER_MAX_CLIENTS_DEFAULT;
+
+#ifdef __linux__
+    event_wake_fd       = -1;
+    event_next_thread   = 0;
+#endif
 }
 
 NetworkServer::~NetworkServer()
@@ -90,11 +117,63 @@ void NetworkServer::DeviceListChanged()
 {
     /*-------------------------------------------------*\
     | Indicate to the clients that the controller list  |
-    | has changed                                       |
+    | has changed.  The clients are only referenced     |
+    | under the lock, so a client that is slow to       |
+    | accept the notification does not hold up accept   |
+    | and disconnect handling.                          |
     \*-------------------------------------------------*/
+    std::vector<NetworkClientInfo *> clients;
+
+    ServerClientsMutex.lock();
+
     for(unsigned int client_idx = 0; client_idx < ServerClients.size(); client_idx++)
     {
-        SendRequest_DeviceListChanged(ServerClients[client_idx]->client_sock);
+        ServerClients[client_idx]->delta_frames_reset = true;
+        ServerClients[client_idx]->send_refs++;
+
+        clients.push_back(ServerClients[client_idx]);
+    }
+
+    ServerClientsMutex.unlock();
+
+    for(unsigned int client_idx = 0; client_idx < clients.size(); client_idx++)
+    {
+        SendRequest_DeviceListChanged(clients[client_idx]);
+    }
+
+    /*-------------------------------------------------*\
+    | Release the clients, deleting any that were       |
+    | removed while the notifications were sent         |
+    \*-------------------------------------------------*/
+    ServerClientsMutex.lock();
+
+    for(unsigned int client_idx = 0; client_idx < clients.size(); client_idx++)
+    {
+        clients[client_idx]->send_refs--;
+
+        if(clients[client_idx]->removed && (clients[client_idx]->send_refs == 0))
+        {
+            delete clients[client_idx];
+        }
+    }
+
+    ServerClientsMutex.unlock();
+}
+
+void NetworkServer::DeleteClient(NetworkClientInfo * client_info)
+{
+    /*-------------------------------------------------*\
+    | ServerClientsMutex must be held.  If another      |
+    | thread is still sending to the client, leave the  |
+    | delete to it.                                     |
+    \*-------------------------------------------------*/
+    if(client_info->send_refs > 0)
+    {
+        client_info->removed = true;
+    }
+    else
+    {
+        delete client_info;
     }
 }
 
@@ -135,6 +214,8 @@ bool NetworkServer::GetListening()
 
 unsigned int NetworkServer::GetNumClients()
 {
+    std::lock_guard<std::mutex> lock(ServerClientsMutex);
+
     return ServerClients.size();
 }
 
@@ -226,6 +307,27 @@ void NetworkServer::SetPort(unsigned short new_port)
     }
 }
 
+void NetworkServer::SetEventLoop(bool enable)
+{
+    if(server_online == false)
+    {
+        event_loop = enable;
+    }
+}
+
+void NetworkServer::SetEventThreads(unsigned int num_threads)
+{
+    if((server_online == false) && (num_threads > 0))
+    {
+        event_thread_count = num_threads;
+    }
+}
+
+void NetworkServer::SetMaxClients(unsigned int num_clients)
+{
+    max_clients = num_clients;
+}
+
 void NetworkServer::StartServer()
 {
     int err;
@@ -274,6 +376,16 @@ void NetworkServer::StartServer()
             return;
         }
 
+#ifndef _WIN32
+        /*-------------------------------------------------*\
+        | Allow the port to be reused right away when the   |
+        | server restarts, so clients can reconnect without |
+        | waiting for old connections to time out           |
+        \*-------------------------------------------------*/
+        int reuse_addr = 1;
+        setsockopt(server_sock[socket_count], SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse_addr, sizeof(reuse_addr));
+#endif
+
         /*-------------------------------------------------*\
         | Bind the server socket                            |
         \*-------------------------------------------------*/
@@ -313,14 +425,25 @@ void NetworkServer::StartServer()
         /*-------------------------------------------------*\
         | Set socket options - no delay                     |
         \*-------------------------------------------------*/
-        setsockopt(server_sock[socket_count], IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        setsockopt(server_sock[socket_count], IPPROTO_TCP, TCP_NODELAY, (const char *)&yes, sizeof(yes));
 
         socket_count += 1;
     }
 
     freeaddrinfo(result);
     server_online = true;
-    
+
+#ifdef __linux__
+    /*-------------------------------------------------*\
+    | If enabled, start the event loop.  Fall back to   |
+    | connection threads if it cannot be started        |
+    \*-------------------------------------------------*/
+    if(event_loop && StartEventLoop())
+    {
+        return;
+    }
+#endif
+
     /*-------------------------------------------------*\
     | Start the connection thread                       |
     \*-------------------------------------------------*/
@@ -336,11 +459,18 @@ void NetworkServer::StopServer()
     int curr_socket;
     server_online = false;
 
+#ifdef __linux__
+    /*-------------------------------------------------*\
+    | Stop the event threads before deleting clients    |
+    \*-------------------------------------------------*/
+    StopEventLoop();
+#endif
+
     ServerClientsMutex.lock();
 
     for(unsigned int client_idx = 0; client_idx < ServerClients.size(); client_idx++)
     {
-        delete ServerClients[client_idx];
+        DeleteClient(ServerClients[client_idx]);
     }
 
     ServerClients.clear();
@@ -415,34 +545,23 @@ void NetworkServer::ConnectionThreadFunction(int socket_idx)
         }
 
         /*-------------------------------------------------*\
-        | Get the new client socket and store it in the     |
-        | clients vector                                    |
+        | Refuse the connection if the client limit has     |
+        | been reached                                      |
         \*-------------------------------------------------*/
-        u_long arg = 0;
-        ioctlsocket(client_info->client_sock, FIONBIO, &arg);
-        setsockopt(client_info->client_sock, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        if(GetNumClients() >= max_clients)
+        {
+            LOG_WARNING("[NetworkServer] Client limit of %u reached, refusing connection", max_clients);
+            delete client_info;
+            continue;
+        }
 
         /*-------------------------------------------------*\
-        | Discover the remote hosts IP                      |
+        | Set the new client socket to blocking mode        |
         \*-------------------------------------------------*/
-        struct sockaddr_storage tmp_addr;
-        char ipstr[INET6_ADDRSTRLEN];
-        socklen_t len;
-        len = sizeof(tmp_addr);
-        getpeername(client_info->client_sock, (struct sockaddr*)&tmp_addr, &len);
-        
-        if(tmp_addr.ss_family == AF_INET)
-        {
-            struct sockaddr_in *s_4 = (struct sockaddr_in *)&tmp_addr;
-            inet_ntop(AF_INET, &s_4->sin_addr, ipstr, sizeof(ipstr));
-            client_info->client_ip = ipstr;
-        }
-        else
-        {
-            struct sockaddr_in6 *s_6 = (struct sockaddr_in6 *)&tmp_addr;
-            inet_ntop(AF_INET6, &s_6->sin6_addr, ipstr, sizeof(ipstr));
-            client_info->client_ip = ipstr;
-        }
+        u_long arg = 0;
+        ioctlsocket(client_info->client_sock, FIONBIO, &arg);
+
+        InitClientInfo(client_info);
 
         /* We need to lock before the thread could possibly finish */
         ServerClientsMutex.lock();
@@ -536,334 +655,830 @@ void NetworkServer::ListenThreadFunction(NetworkClientInfo * client_info)
     //This thread handles messages received from clients
     while(server_online == true)
     {
-        NetPacketHeader header;
-        int             bytes_read  = 0;
-        char *          data        = NULL;
-
-        //Read first byte of magic
-        bytes_read = recv_select(client_sock, &header.pkt_magic[0], 1, 0);
-
-        if(bytes_read <= 0)
-        {
-            goto listen_done;
-        }
-
-        //Test first character of magic - 'O'
-        if(header.pkt_magic[0] != 'O')
+        /*-------------------------------------------------*\
+        | Make room at the end of the receive buffer, then  |
+        | read as much as is available in one call          |
+        \*-------------------------------------------------*/
+        if(client_info->recv_buf_start > 0)
         {
-            continue;
+            memmove(&client_info->recv_buf[0], &client_info->recv_buf[client_info->recv_buf_start], client_info->recv_buf_end - client_info->recv_buf_start);
+            client_info->recv_buf_end  -= client_info->recv_buf_start;
+            client_info->recv_buf_start = 0;
         }
 
-        //Read second byte of magic
-        bytes_read = recv_select(client_sock, &header.pkt_magic[1], 1, 0);
+        int bytes_read = recv_select(client_sock, &client_info->recv_buf[client_info->recv_buf_end], client_info->recv_buf.size() - client_info->recv_buf_end, 0);
 
         if(bytes_read <= 0)
         {
             goto listen_done;
         }
 
-        //Test second character of magic - 'R'
-        if(header.pkt_magic[1] != 'R')
-        {
-            continue;
-        }
-
-        //Read third byte of magic
-        bytes_read = recv_select(client_sock, &header.pkt_magic[2], 1, 0);
+        client_info->recv_buf_end += bytes_read;
 
-        if(bytes_read <= 0)
+        /*-------------------------------------------------*\
+        | Process every complete packet in the buffer       |
+        \*-------------------------------------------------*/
+        if(!ProcessClientData(client_info))
         {
             goto listen_done;
         }
+    }
 
-        //Test third character of magic - 'G'
-        if(header.pkt_magic[2] != 'G')
-        {
-            continue;
-        }
-
-        //Read fourth byte of magic
-        bytes_read = recv_select(client_sock, &header.pkt_magic[3], 1, 0);
+listen_done:
+    RemoveClient(client_info);
+}
 
-        if(bytes_read <= 0)
+/*---------------------------------------------------------*\
+| Find the controller a request is for.  Protocol 7 clients |
+| address controllers by ID, older clients by device index. |
+| Returns -1 if there is no such controller.                |
+\*---------------------------------------------------------*/
+int NetworkServer::GetControllerIndex(NetworkClientInfo * client_info, unsigned int pkt_dev_idx)
+{
+    if(client_info->client_protocol_version >= 7)
+    {
+        for(std::size_t controller_idx = 0; controller_idx < controllers.size(); controller_idx++)
         {
-            goto listen_done;
+            if(controllers[controller_idx]->GetID() == pkt_dev_idx)
+            {
+                return((int)controller_idx);
+            }
         }
 
-        //Test fourth character of magic - 'B'
-        if(header.pkt_magic[3] != 'B')
-        {
-            continue;
-        }
+        return(-1);
+    }
 
-        //If we get to this point, the magic is correct.  Read the rest of the header
-        bytes_read = 0;
-        do
-        {
-            int tmp_bytes_read = 0;
+    if(pkt_dev_idx < controllers.size())
+    {
+        return((int)pkt_dev_idx);
+    }
 
-            tmp_bytes_read = recv_select(client_sock, (char *)&header.pkt_dev_idx + bytes_read, sizeof(header) - sizeof(header.pkt_magic) - bytes_read, 0);
+    return(-1);
+}
 
-            bytes_read += tmp_bytes_read;
+std::vector<unsigned char> NetworkServer::GetControllerIDs()
+{
+    unsigned int                num_controllers = controllers.size();
+    std::vector<unsigned char>  data(sizeof(unsigned int) + (num_controllers * sizeof(NetControllerID)));
 
-            if(tmp_bytes_read <= 0)
-            {
-                goto listen_done;
-            }
+    memcpy(&data[0], &num_controllers, sizeof(unsigned int));
 
-        } while(bytes_read != sizeof(header) - sizeof(header.pkt_magic));
+    for(unsigned int controller_idx = 0; controller_idx < num_controllers; controller_idx++)
+    {
+        NetControllerID controller_id;
 
-        //Header received, now receive the data
-        if(header.pkt_size > 0)
-        {
-            bytes_read = 0;
+        controller_id.id        = controllers[controller_idx]->GetID();
+        controller_id.revision  = controllers[controller_idx]->GetRevision();
 
-            data = new char[header.pkt_size];
+        memcpy(&data[sizeof(unsigned int) + (controller_idx * sizeof(NetControllerID))], &controller_id, sizeof(NetControllerID));
+    }
 
-            do
-            {
-                int tmp_bytes_read = 0;
+    return(data);
+}
 
-                tmp_bytes_read = recv_select(client_sock, &data[(unsigned int)bytes_read], header.pkt_size - bytes_read, 0);
+void NetworkServer::InitClientInfo(NetworkClientInfo * client_info)
+{
+    /*-------------------------------------------------*\
+    | Set socket options - no delay                     |
+    \*-------------------------------------------------*/
+    setsockopt(client_info->client_sock, IPPROTO_TCP, TCP_NODELAY, (const char *)&yes, sizeof(yes));
 
-                if(tmp_bytes_read <= 0)
-                {
-                    goto listen_done;
-                }
-                bytes_read += tmp_bytes_read;
+    /*-------------------------------------------------*\
+    | Discover the remote hosts IP                      |
+    \*-------------------------------------------------*/
+    struct sockaddr_storage tmp_addr;
+    char ipstr[INET6_ADDRSTRLEN];
+    socklen_t len;
+    len = sizeof(tmp_addr);
+    getpeername(client_info->client_sock, (struct sockaddr*)&tmp_addr, &len);
 
-            } while ((unsigned int)bytes_read < header.pkt_size);
-        }
+    if(tmp_addr.ss_family == AF_INET)
+    {
+        struct sockaddr_in *s_4 = (struct sockaddr_in *)&tmp_addr;
+        inet_ntop(AF_INET, &s_4->sin_addr, ipstr, sizeof(ipstr));
+        client_info->client_ip = ipstr;
+    }
+    else
+    {
+        struct sockaddr_in6 *s_6 = (struct sockaddr_in6 *)&tmp_addr;
+        inet_ntop(AF_INET6, &s_6->sin6_addr, ipstr, sizeof(ipstr));
+        client_info->client_ip = ipstr;
+    }
+}
+
+void NetworkServer::RemoveClient(NetworkClientInfo * client_info)
+{
+    ServerClientsMutex.lock();
 
-        //Entire request received, select functionality based on request ID
-        switch(header.pkt_id)
+    for(unsigned int this_idx = 0; this_idx < ServerClients.size(); this_idx++)
+    {
+        if(ServerClients[this_idx] == client_info)
         {
-            case NET_PACKET_ID_REQUEST_CONTROLLER_COUNT:
-                SendReply_ControllerCount(client_sock);
-                break;
+            DeleteClient(client_info);
+            ServerClients.erase(ServerClients.begin() + this_idx);
+            break;
+        }
+    }
 
-            case NET_PACKET_ID_REQUEST_CONTROLLER_DATA:
-                {
-                    unsigned int protocol_version = 0;
+    ServerClientsMutex.unlock();
 
-                    if(header.pkt_size == sizeof(unsigned int))
-                    {
-                        memcpy(&protocol_version, data, sizeof(unsigned int));
-                    }
+    /*-------------------------------------------------*\
+    | Client info has changed, call the callbacks       |
+    \*-------------------------------------------------*/
+    ClientInfoChanged();
+}
 
-                    SendReply_ControllerData(client_sock, header.pkt_dev_idx, protocol_version);
-                }
-                break;
+#ifdef __linux__
+bool NetworkServer::StartEventLoop()
+{
+    /*-------------------------------------------------*\
+    | Create the wake event, used to wake all of the    |
+    | event threads when the server is stopped          |
+    \*-------------------------------------------------*/
+    event_wake_fd = eventfd(0, EFD_NONBLOCK);
 
-            case NET_PACKET_ID_REQUEST_PROTOCOL_VERSION:
-                SendReply_ProtocolVersion(client_sock);
-                ProcessRequest_ClientProtocolVersion(client_sock, header.pkt_size, data);
-                break;
+    if(event_wake_fd < 0)
+    {
+        LOG_ERROR("[NetworkServer] Unable to create event loop wake event, using connection threads");
+        return(false);
+    }
 
-            case NET_PACKET_ID_SET_CLIENT_NAME:
-                if(data == NULL)
-                {
-                    break;
-                }
+    /*-------------------------------------------------*\
+    | Create an epoll instance for each event thread.   |
+    | The listening sockets are handled by the first    |
+    | event thread.                                     |
+    \*-------------------------------------------------*/
+    for(unsigned int thread_idx = 0; thread_idx < event_thread_count; thread_idx++)
+    {
+        int                 epoll_fd = epoll_create1(0);
+        struct epoll_event  event;
 
-                ProcessRequest_ClientString(client_sock, header.pkt_size, data);
-                break;
+        if(epoll_fd < 0)
+        {
+            LOG_ERROR("[NetworkServer] Unable to create event loop, using connection threads");
+            StopEventLoop();
+            return(false);
+        }
 
-            case NET_PACKET_ID_RGBCONTROLLER_RESIZEZONE:
-                if(data == NULL)
-                {
-                    break;
-                }
+        event_fds.push_back(epoll_fd);
 
-                if((header.pkt_dev_idx < controllers.size()) && (header.pkt_size == (2 * sizeof(int))))
-                {
-                    int zone;
-                    int new_size;
+        event.events    = EPOLLIN;
+        event.data.ptr  = &event_wake_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_wake_fd, &event);
+    }
 
-                    memcpy(&zone, data, sizeof(int));
-                    memcpy(&new_size, data + sizeof(int), sizeof(int));
+    for(int curr_socket = 0; curr_socket < socket_count; curr_socket++)
+    {
+        struct epoll_event  event;
+        u_long              arg = 1;
 
-                    controllers[header.pkt_dev_idx]->ResizeZone(zone, new_size);
-                    profile_manager->SaveProfile("sizes", true);
-                }
-                break;
+        if(listen(server_sock[curr_socket], 10) < 0)
+        {
+            LOG_ERROR("[NetworkServer] Unable to listen on server socket, using connection threads");
+            StopEventLoop();
+            return(false);
+        }
 
-            case NET_PACKET_ID_RGBCONTROLLER_UPDATELEDS:
-                if(data == NULL)
-                {
-                    break;
-                }
+        ioctlsocket(server_sock[curr_socket], FIONBIO, &arg);
 
-                if(header.pkt_dev_idx < controllers.size())
-                {
-                    controllers[header.pkt_dev_idx]->SetColorDescription((unsigned char *)data);
-                    controllers[header.pkt_dev_idx]->UpdateLEDs();
-                }
-                break;
+        event.events    = EPOLLIN;
+        event.data.ptr  = &server_sock[curr_socket];
+        epoll_ctl(event_fds[0], EPOLL_CTL_ADD, server_sock[curr_socket], &event);
+    }
 
-            case NET_PACKET_ID_RGBCONTROLLER_UPDATEZONELEDS:
-                if(data == NULL)
-                {
-                    break;
-                }
+    /*-------------------------------------------------*\
+    | Start the event threads                           |
+    \*-------------------------------------------------*/
+    for(unsigned int thread_idx = 0; thread_idx < event_thread_count; thread_idx++)
+    {
+        EventThreads.push_back(new std::thread(&NetworkServer::EventThreadFunction, this, thread_idx));
+    }
 
-                if(header.pkt_dev_idx < controllers.size())
-                {
-                    int zone;
+    printf("Network event loop started on port %hu with %d threads\n", GetPort(), event_thread_count);
 
-                    memcpy(&zone, &data[sizeof(unsigned int)], sizeof(int));
+    server_listening = true;
+    ServerListeningChanged();
 
-                    controllers[header.pkt_dev_idx]->SetZoneColorDescription((unsigned char *)data);
-                    controllers[header.pkt_dev_idx]->UpdateZoneLEDs(zone);
-                }
-                break;
+    return(true);
+}
 
-            case NET_PACKET_ID_RGBCONTROLLER_UPDATESINGLELED:
-                if(data == NULL)
-                {
-                    break;
-                }
+void NetworkServer::StopEventLoop()
+{
+    /*-------------------------------------------------*\
+    | The wake event is never cleared, so signaling it  |
+    | once wakes every event thread                     |
+    \*-------------------------------------------------*/
+    if(event_wake_fd >= 0)
+    {
+        eventfd_write(event_wake_fd, 1);
+    }
 
-                if(header.pkt_dev_idx < controllers.size())
-                {
-                    int led;
+    for(std::size_t thread_idx = 0; thread_idx < EventThreads.size(); thread_idx++)
+    {
+        EventThreads[thread_idx]->join();
+        delete EventThreads[thread_idx];
+    }
 
-                    memcpy(&led, data, sizeof(int));
+    EventThreads.clear();
 
-                    controllers[header.pkt_dev_idx]->SetSingleLEDColorDescription((unsigned char *)data);
-                    controllers[header.pkt_dev_idx]->UpdateSingleLED(led);
-                }
-                break;
+    for(std::size_t thread_idx = 0; thread_idx < event_fds.size(); thread_idx++)
+    {
+        close(event_fds[thread_idx]);
+    }
 
-            case NET_PACKET_ID_RGBCONTROLLER_SETCUSTOMMODE:
-                if(header.pkt_dev_idx < controllers.size())
-                {
-                    controllers[header.pkt_dev_idx]->SetCustomMode();
-                }
-                break;
+    event_fds.clear();
 
-            case NET_PACKET_ID_RGBCONTROLLER_UPDATEMODE:
-                if(data == NULL)
-                {
-                    break;
-                }
+    if(event_wake_fd >= 0)
+    {
+        close(event_wake_fd);
+        event_wake_fd = -1;
 
-                if(header.pkt_dev_idx < controllers.size())
-                {
-                    controllers[header.pkt_dev_idx]->SetModeDescription((unsigned char *)data, client_info->client_protocol_version);
-                    controllers[header.pkt_dev_idx]->UpdateMode();
-                }
-                break;
+        server_listening = false;
+        ServerListeningChanged();
+    }
+}
 
-            case NET_PACKET_ID_RGBCONTROLLER_SAVEMODE:
-                if(data == NULL)
-                {
-                    break;
-                }
+void NetworkServer::EventThreadFunction(unsigned int thread_idx)
+{
+    struct epoll_event events[NET_SERVER_MAX_EVENTS];
 
-                if(header.pkt_dev_idx < controllers.size())
-                {
-                    controllers[header.pkt_dev_idx]->SetModeDescription((unsigned char *)data, client_info->client_protocol_version);
-                    controllers[header.pkt_dev_idx]->SaveMode();
-                }
-                break;
+    while(server_online == true)
+    {
+        int num_events = epoll_wait(event_fds[thread_idx], events, NET_SERVER_MAX_EVENTS, -1);
 
-            case NET_PACKET_ID_REQUEST_PROFILE_LIST:
-                SendReply_ProfileList(client_sock);
-                break;
+        if(num_events < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
 
-            case NET_PACKET_ID_REQUEST_SAVE_PROFILE:
-                if(data == NULL)
-                {
-                    break;
-                }
+            break;
+        }
 
-                if(profile_manager)
-                {
-                    profile_manager->SaveProfile(data);
-                }
+        for(int event_idx = 0; event_idx < num_events; event_idx++)
+        {
+            void * event_ptr = events[event_idx].data.ptr;
 
-                break;
+            /*-------------------------------------------------*\
+            | Wake event, the server is stopping                |
+            \*-------------------------------------------------*/
+            if(event_ptr == &event_wake_fd)
+            {
+                continue;
+            }
 
-            case NET_PACKET_ID_REQUEST_LOAD_PROFILE:
-                if(data == NULL)
-                {
-                    break;
-                }
+            /*-------------------------------------------------*\
+            | Listening socket, accept new clients              |
+            \*-------------------------------------------------*/
+            if((event_ptr >= (void *)&server_sock[0]) && (event_ptr < (void *)&server_sock[MAXSOCK]))
+            {
+                AcceptEventClient((SOCKET *)event_ptr - &server_sock[0]);
+                continue;
+            }
 
-                if(profile_manager)
-                {
-                    profile_manager->LoadProfile(data);
-                }
+            /*-------------------------------------------------*\
+            | Client socket, write out any buffered replies     |
+            | once it is writable                               |
+            \*-------------------------------------------------*/
+            NetworkClientInfo * client_info = (NetworkClientInfo *)event_ptr;
 
-                for(RGBController* controller : controllers)
-                {
-                    controller->UpdateLEDs();
-                }
+            if(events[event_idx].events & EPOLLOUT)
+            {
+                std::lock_guard<std::mutex> lock(client_info->send_mutex);
 
-                break;
+                FlushEventClient(client_info);
+            }
 
-            case NET_PACKET_ID_REQUEST_DELETE_PROFILE:
-                if(data == NULL)
-                {
-                    break;
-                }
+            /*-------------------------------------------------*\
+            | Read and process requests                         |
+            \*-------------------------------------------------*/
+            if((events[event_idx].events & ~EPOLLOUT) == 0)
+            {
+                continue;
+            }
 
-                if(profile_manager)
-                {
-                    profile_manager->DeleteProfile(data);
-                }
+            if(!ReadEventClient(client_info))
+            {
+                epoll_ctl(event_fds[thread_idx], EPOLL_CTL_DEL, client_info->client_sock, NULL);
+                RemoveClient(client_info);
+            }
+        }
+    }
+}
 
-                break;
+void NetworkServer::AcceptEventClient(int socket_idx)
+{
+    while(server_online == true)
+    {
+        SOCKET client_sock = accept(server_sock[socket_idx], NULL, NULL);
 
-            case NET_PACKET_ID_REQUEST_PLUGIN_LIST:
-                SendReply_PluginList(client_sock);
-                break;
+        if(client_sock == INVALID_SOCKET)
+        {
+            return;
+        }
 
-            case NET_PACKET_ID_PLUGIN_SPECIFIC:
-                {
-                    unsigned int plugin_pkt_type = *((unsigned int*)(data));
-                    unsigned int plugin_pkt_size = header.pkt_size - (sizeof(unsigned int));
-                    unsigned char* plugin_data = (unsigned char*)(data + sizeof(unsigned int));
+        NetworkClientInfo * client_info = new NetworkClientInfo();
 
-                    if(header.pkt_dev_idx < plugins.size())
-                    {
-                        NetworkPlugin plugin = plugins[header.pkt_dev_idx];
-                        unsigned char* output = plugin.callback(plugin.callback_arg, plugin_pkt_type, plugin_data, &plugin_pkt_size);
-                        if(output != nullptr)
-                        {
-                            SendReply_PluginSpecific(client_sock, plugin_pkt_type, output, plugin_pkt_size);
-                        }
-                    }
-                    break;
-                }
+        client_info->client_sock = client_sock;
+
+        /*-------------------------------------------------*\
+        | Refuse the connection if the client limit has     |
+        | been reached                                      |
+        \*-------------------------------------------------*/
+        if(GetNumClients() >= max_clients)
+        {
+            LOG_WARNING("[NetworkServer] Client limit of %u reached, refusing connection", max_clients);
+            delete client_info;
+            continue;
         }
 
-        delete[] data;
+        /*-------------------------------------------------*\
+        | Set the new client socket to non-blocking mode    |
+        \*-------------------------------------------------*/
+        u_long arg = 1;
+        ioctlsocket(client_info->client_sock, FIONBIO, &arg);
+
+        InitClientInfo(client_info);
+
+        client_info->send_buffered = true;
+
+        ServerClientsMutex.lock();
+        ServerClients.push_back(client_info);
+        ServerClientsMutex.unlock();
+
+        /*-------------------------------------------------*\
+        | Assign the client to the event threads in turn.   |
+        | Replies may already have been buffered for it, in |
+        | which case it is also registered for writing.     |
+        \*-------------------------------------------------*/
+        struct epoll_event event;
+
+        client_info->send_mutex.lock();
+
+        client_info->send_epoll_fd  = event_fds[event_next_thread];
+        client_info->send_epoll_out = client_info->send_buf_start < client_info->send_buf.size();
+
+        event.events    = EPOLLIN | EPOLLRDHUP | (client_info->send_epoll_out ? EPOLLOUT : 0);
+        event.data.ptr  = client_info;
+
+        epoll_ctl(client_info->send_epoll_fd, EPOLL_CTL_ADD, client_info->client_sock, &event);
+
+        client_info->send_mutex.unlock();
+
+        event_next_thread = (event_next_thread + 1) % event_fds.size();
+
+        /*-------------------------------------------------*\
+        | Client info has changed, call the callbacks       |
+        \*-------------------------------------------------*/
+        ClientInfoChanged();
     }
+}
 
-listen_done:
+bool NetworkServer::ReadEventClient(NetworkClientInfo * client_info)
+{
+    /*-------------------------------------------------*\
+    | Read until the socket has no more data, parsing   |
+    | packets out of the receive buffer as they arrive  |
+    \*-------------------------------------------------*/
+    while(true)
+    {
+        if(client_info->recv_buf_start > 0)
+        {
+            memmove(&client_info->recv_buf[0], &client_info->recv_buf[client_info->recv_buf_start], client_info->recv_buf_end - client_info->recv_buf_start);
+            client_info->recv_buf_end  -= client_info->recv_buf_start;
+            client_info->recv_buf_start = 0;
+        }
 
-    ServerClientsMutex.lock();
+        ssize_t bytes_read = recv(client_info->client_sock, &client_info->recv_buf[client_info->recv_buf_end], client_info->recv_buf.size() - client_info->recv_buf_end, 0);
 
-    for(unsigned int this_idx = 0; this_idx < ServerClients.size(); this_idx++)
+        if(bytes_read < 0)
+        {
+            return((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR));
+        }
+        else if(bytes_read == 0)
+        {
+            return(false);
+        }
+
+        client_info->recv_buf_end += bytes_read;
+
+        if(!ProcessClientData(client_info))
+        {
+            return(false);
+        }
+    }
+}
+
+bool NetworkServer::FlushEventClient(NetworkClientInfo * client_info)
+{
+    /*-------------------------------------------------*\
+    | Called with the client's send mutex held.  Write  |
+    | as much of the send buffer as the socket accepts  |
+    \*-------------------------------------------------*/
+    while(!client_info->send_failed && (client_info->send_buf_start < client_info->send_buf.size()))
     {
-        if(ServerClients[this_idx] == client_info)
+        ssize_t sent = send(client_info->client_sock, &client_info->send_buf[client_info->send_buf_start], client_info->send_buf.size() - client_info->send_buf_start, MSG_NOSIGNAL);
+
+        if(sent < 0)
         {
-            delete client_info;
-            ServerClients.erase(ServerClients.begin() + this_idx);
+            if(errno == EINTR)
+            {
+                continue;
+            }
+            else if((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                break;
+            }
+
+            /*-----------------------------------------*\
+            | Close the connection, the event thread    |
+            | removes the client when it sees the hang  |
+            | up                                        |
+            \*-----------------------------------------*/
+            client_info->send_failed = true;
+            shutdown(client_info->client_sock, SD_BOTH);
             break;
         }
+
+        client_info->send_buf_start += sent;
     }
 
-    client_info = nullptr;
+    if(client_info->send_failed || (client_info->send_buf_start == client_info->send_buf.size()))
+    {
+        client_info->send_buf.clear();
+        client_info->send_buf_start = 0;
 
-    ServerClientsMutex.unlock();
+        if(client_info->send_buf.capacity() > NET_RECV_BUFFER_SIZE)
+        {
+            client_info->send_buf.shrink_to_fit();
+        }
+    }
 
     /*-------------------------------------------------*\
-    | Client info has changed, call the callbacks       |
+    | Only ask for write events while data is waiting   |
     \*-------------------------------------------------*/
-    ClientInfoChanged();
+    bool send_epoll_out = !client_info->send_buf.empty();
+
+    if((client_info->send_epoll_fd >= 0) && (send_epoll_out != client_info->send_epoll_out))
+    {
+        struct epoll_event event;
+
+        event.events    = EPOLLIN | EPOLLRDHUP | (send_epoll_out ? EPOLLOUT : 0);
+        event.data.ptr  = client_info;
+
+        epoll_ctl(client_info->send_epoll_fd, EPOLL_CTL_MOD, client_info->client_sock, &event);
+
+        client_info->send_epoll_out = send_epoll_out;
+    }
+
+    return(!client_info->send_failed);
+}
+#endif
+
+bool NetworkServer::ProcessClientData(NetworkClientInfo * client_info)
+{
+    while(true)
+    {
+        char *          buf     = &client_info->recv_buf[client_info->recv_buf_start];
+        std::size_t     avail   = client_info->recv_buf_end - client_info->recv_buf_start;
+        NetPacketHeader header;
+
+        /*-------------------------------------------------*\
+        | Resynchronize on the "ORGB" magic, discarding any |
+        | bytes that precede it                             |
+        \*-------------------------------------------------*/
+        std::size_t skip = 0;
+
+        while((avail - skip) >= sizeof(header.pkt_magic) && memcmp(&buf[skip], "ORGB", sizeof(header.pkt_magic)) != 0)
+        {
+            skip++;
+        }
+
+        client_info->recv_buf_start += skip;
+        buf                         += skip;
+        avail                       -= skip;
+
+        /*-------------------------------------------------*\
+        | Wait for the rest of the header                   |
+        \*-------------------------------------------------*/
+        if(avail < sizeof(NetPacketHeader))
+        {
+            break;
+        }
+
+        memcpy(&header, buf, sizeof(NetPacketHeader));
+
+        /*-------------------------------------------------*\
+        | Wait for the rest of the data, growing the buffer |
+        | if the packet does not fit                        |
+        \*-------------------------------------------------*/
+        if(header.pkt_size > NET_MAX_PACKET_SIZE)
+        {
+            LOG_WARNING("[NetworkServer] Packet of %u bytes from %s is too large, closing connection", header.pkt_size, client_info->client_ip.c_str());
+            return(false);
+        }
+
+        std::size_t packet_size = sizeof(NetPacketHeader) + header.pkt_size;
+
+        if(avail < packet_size)
+        {
+            if(packet_size > client_info->recv_buf.size())
+            {
+                client_info->recv_buf.resize(packet_size);
+            }
+            break;
+        }
+
+        /*-------------------------------------------------*\
+        | Entire request received, process it and consume   |
+        | it from the buffer                                |
+        \*-------------------------------------------------*/
+        char * data = NULL;
+
+        if(header.pkt_size > 0)
+        {
+            data = buf + sizeof(NetPacketHeader);
+        }
+
+        ProcessRequest(client_info, header, data);
+
+        client_info->recv_buf_start += packet_size;
+    }
+
+    if(client_info->recv_buf_start == client_info->recv_buf_end)
+    {
+        client_info->recv_buf_start = 0;
+        client_info->recv_buf_end   = 0;
+
+        /*-------------------------------------------------*\
+        | Release the memory used by a large packet once it |
+        | has been processed                                |
+        \*-------------------------------------------------*/
+        if(client_info->recv_buf.size() > NET_RECV_BUFFER_SIZE)
+        {
+            client_info->recv_buf.resize(NET_RECV_BUFFER_SIZE);
+            client_info->recv_buf.shrink_to_fit();
+        }
+    }
+
+    return(true);
+}
+
+void NetworkServer::ProcessRequest(NetworkClientInfo * client_info, NetPacketHeader & header, char * data)
+{
+    SOCKET  client_sock     = client_info->client_sock;
+    int     controller_idx  = -1;
+
+    /*-------------------------------------------------*\
+    | Select functionality based on request ID          |
+    \*-------------------------------------------------*/
+    switch(header.pkt_id)
+    {
+        case NET_PACKET_ID_REQUEST_CONTROLLER_COUNT:
+            SendReply_ControllerCount(client_info);
+            break;
+
+        case NET_PACKET_ID_REQUEST_CONTROLLER_IDS:
+            SendReply_ControllerIDs(client_info);
+            break;
+
+        case NET_PACKET_ID_REQUEST_CONTROLLER_DATA:
+            {
+                unsigned int protocol_version = 0;
+
+                if(header.pkt_size == sizeof(unsigned int))
+                {
+                    memcpy(&protocol_version, data, sizeof(unsigned int));
+                }
+
+                SendReply_ControllerData(client_info, header.pkt_dev_idx, protocol_version);
+            }
+            break;
+
+        case NET_PACKET_ID_REQUEST_PROTOCOL_VERSION:
+            SendReply_ProtocolVersion(client_info);
+            ProcessRequest_ClientProtocolVersion(client_sock, header.pkt_size, data);
+            break;
+
+        case NET_PACKET_ID_SET_CLIENT_NAME:
+            if(data == NULL)
+            {
+                break;
+            }
+
+            ProcessRequest_ClientString(client_sock, header.pkt_size, data);
+            break;
+
+        case NET_PACKET_ID_RGBCONTROLLER_RESIZEZONE:
+            if(data == NULL)
+            {
+                break;
+            }
+
+            controller_idx = GetControllerIndex(client_info, header.pkt_dev_idx);
+
+            if((controller_idx >= 0) && (header.pkt_size == (2 * sizeof(int))))
+            {
+                int zone;
+                int new_size;
+
+                memcpy(&zone, data, sizeof(int));
+                memcpy(&new_size, data + sizeof(int), sizeof(int));
+
+                controllers[controller_idx]->ResizeZone(zone, new_size);
+                profile_manager->SaveProfile("sizes", true);
+            }
+            break;
+
+        case NET_PACKET_ID_RGBCONTROLLER_UPDATELEDS:
+            if(data == NULL)
+            {
+                break;
+            }
+
+            controller_idx = GetControllerIndex(client_info, header.pkt_dev_idx);
+
+            if(controller_idx >= 0)
+            {
+                controllers[controller_idx]->SetColorDescription((unsigned char *)data, client_info->client_protocol_version, header.pkt_size);
+                controllers[controller_idx]->UpdateLEDs();
+            }
+            break;
+
+        case NET_PACKET_ID_RGBCONTROLLER_UPDATELEDS_BATCH:
+            if(data == NULL)
+            {
+                break;
+            }
+
+            ProcessRequest_UpdateLEDsBatch(client_info, header.pkt_size, data);
+            break;
+
+        case NET_PACKET_ID_RGBCONTROLLER_UPDATELEDS_DELTA:
+            if(data == NULL)
+            {
+                break;
+            }
+
+            controller_idx = GetControllerIndex(client_info, header.pkt_dev_idx);
+
+            if(controller_idx >= 0)
+            {
+                ProcessRequest_UpdateLEDsDelta(client_info, controller_idx, header.pkt_size, data);
+            }
+            break;
+
+        case NET_PACKET_ID_RGBCONTROLLER_UPDATEZONELEDS:
+            if(data == NULL)
+            {
+                break;
+            }
+
+            controller_idx = GetControllerIndex(client_info, header.pkt_dev_idx);
+
+            if((controller_idx >= 0) && (header.pkt_size >= (sizeof(unsigned int) + sizeof(int))))
+            {
+                int zone;
+
+                memcpy(&zone, &data[sizeof(unsigned int)], sizeof(int));
+
+                controllers[controller_idx]->SetZoneColorDescription((unsigned char *)data, client_info->client_protocol_version, header.pkt_size);
+                controllers[controller_idx]->UpdateZoneLEDs(zone);
+            }
+            break;
+
+        case NET_PACKET_ID_RGBCONTROLLER_UPDATESINGLELED:
+            if(data == NULL)
+            {
+                break;
+            }
+
+            controller_idx = GetControllerIndex(client_info, header.pkt_dev_idx);
+
+            if(controller_idx >= 0)
+            {
+                int led;
+
+                memcpy(&led, data, sizeof(int));
+
+                controllers[controller_idx]->SetSingleLEDColorDescription((unsigned char *)data);
+                controllers[controller_idx]->UpdateSingleLED(led);
+            }
+            break;
+
+        case NET_PACKET_ID_RGBCONTROLLER_SETCUSTOMMODE:
+            controller_idx = GetControllerIndex(client_info, header.pkt_dev_idx);
+
+            if(controller_idx >= 0)
+            {
+                controllers[controller_idx]->SetCustomMode();
+            }
+            break;
+
+        case NET_PACKET_ID_RGBCONTROLLER_UPDATEMODE:
+            if(data == NULL)
+            {
+                break;
+            }
+
+            controller_idx = GetControllerIndex(client_info, header.pkt_dev_idx);
+
+            if(controller_idx >= 0)
+            {
+                controllers[controller_idx]->SetModeDescription((unsigned char *)data, client_info->client_protocol_version, header.pkt_size);
+                controllers[controller_idx]->UpdateMode();
+            }
+            break;
+
+        case NET_PACKET_ID_RGBCONTROLLER_SAVEMODE:
+            if(data == NULL)
+            {
+                break;
+            }
+
+            controller_idx = GetControllerIndex(client_info, header.pkt_dev_idx);
+
+            if(controller_idx >= 0)
+            {
+                controllers[controller_idx]->SetModeDescription((unsigned char *)data, client_info->client_protocol_version, header.pkt_size);
+                controllers[controller_idx]->SaveMode();
+            }
+            break;
+
+        case NET_PACKET_ID_REQUEST_PROFILE_LIST:
+            SendReply_ProfileList(client_info);
+            break;
+
+        case NET_PACKET_ID_REQUEST_SAVE_PROFILE:
+            if(data == NULL)
+            {
+                break;
+            }
+
+            if(profile_manager)
+            {
+                profile_manager->SaveProfile(std::string(data, strnlen(data, header.pkt_size)));
+            }
+
+            break;
+
+        case NET_PACKET_ID_REQUEST_LOAD_PROFILE:
+            if(data == NULL)
+            {
+                break;
+            }
+
+            if(profile_manager)
+            {
+                profile_manager->LoadProfile(std::string(data, strnlen(data, header.pkt_size)));
+            }
+
+            break;
+
+        case NET_PACKET_ID_REQUEST_DELETE_PROFILE:
+            if(data == NULL)
+            {
+                break;
+            }
+
+            if(profile_manager)
+            {
+                profile_manager->DeleteProfile(std::string(data, strnlen(data, header.pkt_size)));
+            }
+
+            break;
+
+        case NET_PACKET_ID_REQUEST_PLUGIN_LIST:
+            SendReply_PluginList(client_info);
+            break;
+
+        case NET_PACKET_ID_PLUGIN_SPECIFIC:
+            if((data == NULL) || (header.pkt_size < sizeof(unsigned int)))
+            {
+                break;
+            }
+
+            {
+                unsigned int plugin_pkt_type;
+
+                memcpy(&plugin_pkt_type, data, sizeof(unsigned int));
+
+                unsigned int plugin_pkt_size = header.pkt_size - (sizeof(unsigned int));
+                unsigned char* plugin_data = (unsigned char*)(data + sizeof(unsigned int));
+
+                if(header.pkt_dev_idx < plugins.size())
+                {
+                    NetworkPlugin plugin = plugins[header.pkt_dev_idx];
+                    unsigned char* output = plugin.callback(plugin.callback_arg, plugin_pkt_type, plugin_data, &plugin_pkt_size);
+                    if(output != nullptr)
+                    {
+                        SendReply_PluginSpecific(client_info, plugin_pkt_type, output, plugin_pkt_size);
+                    }
+                }
+                break;
+            }
+    }
 }
 
 void NetworkServer::ProcessRequest_ClientProtocolVersion(SOCKET client_sock, unsigned int data_size, char * data)
@@ -897,14 +1512,14 @@ void NetworkServer::ProcessRequest_ClientProtocolVersion(SOCKET client_sock, uns
     ClientInfoChanged();
 }
 
-void NetworkServer::ProcessRequest_ClientString(SOCKET client_sock, unsigned int /*data_size*/, char * data)
+void NetworkServer::ProcessRequest_ClientString(SOCKET client_sock, unsigned int data_size, char * data)
 {
     ServerClientsMutex.lock();
     for(unsigned int this_idx = 0; this_idx < ServerClients.size(); this_idx++)
     {
         if(ServerClients[this_idx]->client_sock == client_sock)
         {
-            ServerClients[this_idx]->client_string = data;
+            ServerClients[this_idx]->client_string = std::string(data, strnlen(data, data_size));
             break;
         }
     }
@@ -916,115 +1531,406 @@ void NetworkServer::ProcessRequest_ClientString(SOCKET client_sock, unsigned int
     ClientInfoChanged();
 }
 
-void NetworkServer::SendReply_ControllerCount(SOCKET client_sock)
+void NetworkServer::ProcessRequest_UpdateLEDsBatch(NetworkClientInfo * client_info, unsigned int data_size, char * data)
 {
-    NetPacketHeader reply_hdr;
-    unsigned int    reply_data;
+    std::vector<RGBController *>    batch_controllers;
+    std::vector<unsigned char *>    batch_colors;
+    std::vector<unsigned int>       batch_sizes;
+    unsigned int                    data_ptr    = sizeof(unsigned int);
+    unsigned short                  num_devices;
+    unsigned int                    protocol_version = client_info->client_protocol_version;
+    unsigned int                    count_size  = (protocol_version >= 8) ? sizeof(unsigned int) : sizeof(unsigned short);
+
+    if(data_size < (sizeof(unsigned int) + sizeof(unsigned short)))
+    {
+        return;
+    }
 
-    reply_hdr.pkt_magic[0] = 'O';
-    reply_hdr.pkt_magic[1] = 'R';
-    reply_hdr.pkt_magic[2] = 'G';
-    reply_hdr.pkt_magic[3] = 'B';
+    memcpy(&num_devices, &data[data_ptr], sizeof(unsigned short));
+    data_ptr += sizeof(unsigned short);
 
-    reply_hdr.pkt_dev_idx  = 0;
-    reply_hdr.pkt_id       = NET_PACKET_ID_REQUEST_CONTROLLER_COUNT;
-    reply_hdr.pkt_size     = sizeof(unsigned int);
+    /*---------------------------------------------------------*\
+    | Validate the whole batch before applying any of it        |
+    \*---------------------------------------------------------*/
+    for(unsigned int device_idx = 0; device_idx < num_devices; device_idx++)
+    {
+        unsigned int    dev_idx;
+        unsigned int    color_size;
+        unsigned int    num_colors;
+
+        if((data_size - data_ptr) < (sizeof(unsigned int) + sizeof(unsigned int) + count_size))
+        {
+            return;
+        }
+
+        memcpy(&dev_idx, &data[data_ptr], sizeof(unsigned int));
+        data_ptr += sizeof(unsigned int);
+
+        memcpy(&color_size, &data[data_ptr], sizeof(unsigned int));
+
+        if(protocol_version >= 8)
+        {
+            memcpy(&num_colors, &data[data_ptr + sizeof(unsigned int)], sizeof(unsigned int));
+        }
+        else
+        {
+            unsigned short short_num_colors;
+
+            memcpy(&short_num_colors, &data[data_ptr + sizeof(unsigned int)], sizeof(unsigned short));
+            num_colors = short_num_colors;
+        }
 
-    reply_data             = controllers.size();
+        int controller_idx = GetControllerIndex(client_info, dev_idx);
 
-    send(client_sock, (const char *)&reply_hdr, sizeof(NetPacketHeader), 0);
-    send(client_sock, (const char *)&reply_data, sizeof(unsigned int), 0);
+        if((color_size > (data_size - data_ptr))
+        || (color_size < (sizeof(unsigned int) + count_size))
+        || (num_colors > ((color_size - sizeof(unsigned int) - count_size) / sizeof(RGBColor)))
+        || (controller_idx < 0))
+        {
+            return;
+        }
+
+        batch_controllers.push_back(controllers[controller_idx]);
+        batch_colors.push_back((unsigned char *)&data[data_ptr]);
+        batch_sizes.push_back(color_size);
+
+        data_ptr += color_size;
+    }
+
+    /*---------------------------------------------------------*\
+    | Apply the batch as one update transaction, so the device  |
+    | threads hold their updates until all colors are set and   |
+    | then flush together                                       |
+    \*---------------------------------------------------------*/
+    ResourceManager::get()->BeginUpdateTransaction(batch_controllers);
+
+    for(std::size_t batch_idx = 0; batch_idx < batch_controllers.size(); batch_idx++)
+    {
+        batch_controllers[batch_idx]->SetColorDescription(batch_colors[batch_idx], protocol_version, batch_sizes[batch_idx]);
+        batch_controllers[batch_idx]->UpdateLEDs();
+    }
+
+    ResourceManager::get()->CommitUpdateTransaction(batch_controllers);
 }
 
-void NetworkServer::SendReply_ControllerData(SOCKET client_sock, unsigned int dev_idx, unsigned int protocol_version)
+void NetworkServer::ProcessRequest_UpdateLEDsDelta(NetworkClientInfo * client_info, unsigned int dev_idx, unsigned int data_size, char * data)
 {
-    if(dev_idx < controllers.size())
+    unsigned int    data_ptr    = sizeof(unsigned int);
+    unsigned char   flags;
+    unsigned int    num_colors;
+
+    if((dev_idx >= controllers.size()) || (data_size < (sizeof(unsigned int) + sizeof(flags) + sizeof(num_colors))))
     {
-        NetPacketHeader reply_hdr;
-        unsigned char *reply_data = controllers[dev_idx]->GetDeviceDescription(protocol_version);
-        unsigned int   reply_size;
+        return;
+    }
 
-        memcpy(&reply_size, reply_data, sizeof(reply_size));
+    memcpy(&flags, &data[data_ptr], sizeof(flags));
+    data_ptr += sizeof(flags);
 
-        reply_hdr.pkt_magic[0] = 'O';
-        reply_hdr.pkt_magic[1] = 'R';
-        reply_hdr.pkt_magic[2] = 'G';
-        reply_hdr.pkt_magic[3] = 'B';
+    memcpy(&num_colors, &data[data_ptr], sizeof(num_colors));
+    data_ptr += sizeof(num_colors);
 
-        reply_hdr.pkt_dev_idx  = dev_idx;
-        reply_hdr.pkt_id       = NET_PACKET_ID_REQUEST_CONTROLLER_DATA;
-        reply_hdr.pkt_size     = reply_size;
+    RGBController * controller = controllers[dev_idx];
 
-        send(client_sock, (const char *)&reply_hdr, sizeof(NetPacketHeader), 0);
-        send(client_sock, (const char *)reply_data, reply_size, 0);
+    if(num_colors > controller->colors.size())
+    {
+        return;
+    }
 
-        delete[] reply_data;
+    /*---------------------------------------------------------*\
+    | The device list changed, the client sends keyframes for   |
+    | the new list once it has been told                        |
+    \*---------------------------------------------------------*/
+    if(client_info->delta_frames_reset.exchange(false))
+    {
+        client_info->delta_frames.clear();
     }
+
+    if(dev_idx >= client_info->delta_frames.size())
+    {
+        client_info->delta_frames.resize(dev_idx + 1);
+    }
+
+    /*---------------------------------------------------------*\
+    | A keyframe resets the reference frame to all-black.  A    |
+    | delta against a frame of a different size is dropped, the |
+    | client sends a keyframe once it sees the new size.        |
+    \*---------------------------------------------------------*/
+    std::vector<RGBColor> & frame = client_info->delta_frames[dev_idx];
+
+    if(flags & NET_DELTA_FLAG_KEYFRAME)
+    {
+        frame.assign(num_colors, 0);
+    }
+    else if(frame.size() != num_colors)
+    {
+        return;
+    }
+
+    /*---------------------------------------------------------*\
+    | Apply the runs to a copy so that a truncated packet does  |
+    | not leave a partially updated reference frame             |
+    \*---------------------------------------------------------*/
+    std::vector<RGBColor>   new_frame   = frame;
+    unsigned int            color_idx   = 0;
+
+    while((data_ptr + (2 * sizeof(unsigned short))) <= data_size)
+    {
+        unsigned short skip;
+        unsigned short count;
+
+        memcpy(&skip, &data[data_ptr], sizeof(skip));
+        data_ptr += sizeof(skip);
+
+        memcpy(&count, &data[data_ptr], sizeof(count));
+        data_ptr += sizeof(count);
+
+        color_idx += skip;
+
+        if(((color_idx + count) > num_colors) || ((data_ptr + (count * 3)) > data_size))
+        {
+            return;
+        }
+
+        for(unsigned int run_idx = 0; run_idx < count; run_idx++)
+        {
+            unsigned char red   = data[data_ptr++];
+            unsigned char grn   = data[data_ptr++];
+            unsigned char blu   = data[data_ptr++];
+
+            new_frame[color_idx++] = ToRGBColor(red, grn, blu);
+        }
+    }
+
+    frame = new_frame;
+
+    /*---------------------------------------------------------*\
+    | Write the frame into the controller and update it         |
+    \*---------------------------------------------------------*/
+    std::copy(frame.begin(), frame.end(), controller->colors.begin());
+
+    controller->UpdateLEDs();
+}
+
+void NetworkServer::SendClientPacket(NetworkClientInfo * client_info, unsigned int pkt_dev_idx, unsigned int pkt_id, const void * data, unsigned int data_size)
+{
+    NetPacketBuffer buffer;
+
+    buffer.data = data;
+    buffer.size = data_size;
+
+    SendClientPacketBuffers(client_info, pkt_dev_idx, pkt_id, &buffer, 1);
+}
+
+void NetworkServer::SendClientPacketBuffers(NetworkClientInfo * client_info, unsigned int pkt_dev_idx, unsigned int pkt_id, const NetPacketBuffer * buffers, unsigned int num_buffers)
+{
+    /*-------------------------------------------------*\
+    | Connection threads send directly, blocking until  |
+    | the whole packet is written                       |
+    \*-------------------------------------------------*/
+    if(!client_info->send_buffered)
+    {
+        SendNetPacketBuffers(client_info->client_sock, pkt_dev_idx, pkt_id, buffers, num_buffers);
+        return;
+    }
+
+#ifdef __linux__
+    /*-------------------------------------------------*\
+    | Event loop clients must never block the event     |
+    | thread.  Append the whole packet to the client's  |
+    | send buffer and write what the socket accepts,    |
+    | the rest is written once the socket is writable.  |
+    \*-------------------------------------------------*/
+    std::lock_guard<std::mutex> lock(client_info->send_mutex);
+
+    if(client_info->send_failed)
+    {
+        return;
+    }
+
+    NetPacketHeader pkt_hdr;
+    unsigned int    pkt_size = 0;
+
+    for(unsigned int buffer_idx = 0; buffer_idx < num_buffers; buffer_idx++)
+    {
+        pkt_size += buffers[buffer_idx].size;
+    }
+
+    InitNetPacketHeader(&pkt_hdr, pkt_dev_idx, pkt_id, pkt_size);
+
+    /*-------------------------------------------------*\
+    | Disconnect clients that stopped reading instead   |
+    | of buffering without limit                        |
+    \*-------------------------------------------------*/
+    if((client_info->send_buf.size() - client_info->send_buf_start + sizeof(pkt_hdr) + pkt_size) > NET_MAX_SEND_BUFFER_SIZE)
+    {
+        LOG_WARNING("[NetworkServer] Client %s is not reading replies, closing connection", client_info->client_ip.c_str());
+
+        client_info->send_failed = true;
+        shutdown(client_info->client_sock, SD_BOTH);
+        FlushEventClient(client_info);
+        return;
+    }
+
+    if(client_info->send_buf_start > 0)
+    {
+        client_info->send_buf.erase(client_info->send_buf.begin(), client_info->send_buf.begin() + client_info->send_buf_start);
+        client_info->send_buf_start = 0;
+    }
+
+    client_info->send_buf.insert(client_info->send_buf.end(), (const char *)&pkt_hdr, (const char *)&pkt_hdr + sizeof(pkt_hdr));
+
+    for(unsigned int buffer_idx = 0; buffer_idx < num_buffers; buffer_idx++)
+    {
+        const char * buffer_data = (const char *)buffers[buffer_idx].data;
+
+        if(buffers[buffer_idx].size > 0)
+        {
+            client_info->send_buf.insert(client_info->send_buf.end(), buffer_data, buffer_data + buffers[buffer_idx].size);
+        }
+    }
+
+    FlushEventClient(client_info);
+#endif
 }
 
-void NetworkServer::SendReply_ProtocolVersion(SOCKET client_sock)
+void NetworkServer::SendReply_ControllerCount(NetworkClientInfo * client_info)
 {
-    NetPacketHeader reply_hdr;
     unsigned int    reply_data;
 
-    reply_hdr.pkt_magic[0] = 'O';
-    reply_hdr.pkt_magic[1] = 'R';
-    reply_hdr.pkt_magic[2] = 'G';
-    reply_hdr.pkt_magic[3] = 'B';
+    reply_data = controllers.size();
 
-    reply_hdr.pkt_dev_idx  = 0;
-    reply_hdr.pkt_id       = NET_PACKET_ID_REQUEST_PROTOCOL_VERSION;
-    reply_hdr.pkt_size     = sizeof(unsigned int);
+    SendClientPacket(client_info, 0, NET_PACKET_ID_REQUEST_CONTROLLER_COUNT, &reply_data, sizeof(unsigned int));
+}
 
-    reply_data             = OPENRGB_SDK_PROTOCOL_VERSION;
+void NetworkServer::SendReply_ControllerIDs(NetworkClientInfo * client_info)
+{
+    std::vector<unsigned char> reply_data = GetControllerIDs();
 
-    send(client_sock, (const char *)&reply_hdr, sizeof(NetPacketHeader), 0);
-    send(client_sock, (const char *)&reply_data, sizeof(unsigned int), 0);
+    SendClientPacket(client_info, 0, NET_PACKET_ID_REQUEST_CONTROLLER_IDS, reply_data.data(), reply_data.size());
 }
 
-void NetworkServer::SendRequest_DeviceListChanged(SOCKET client_sock)
+void NetworkServer::SendReply_ControllerData(NetworkClientInfo * client_info, unsigned int pkt_dev_idx, unsigned int protocol_version)
 {
-    NetPacketHeader pkt_hdr;
+    /*-------------------------------------------------*\
+    | From protocol 7 the controller is requested by    |
+    | ID, the reply is addressed the same way           |
+    \*-------------------------------------------------*/
+    int dev_idx = GetControllerIndex(client_info, pkt_dev_idx);
 
-    pkt_hdr.pkt_magic[0] = 'O';
-    pkt_hdr.pkt_magic[1] = 'R';
-    pkt_hdr.pkt_magic[2] = 'G';
-    pkt_hdr.pkt_magic[3] = 'B';
+    if(dev_idx >= 0)
+    {
+        /*-------------------------------------------------*\
+        | Never serialize a newer format than we know of,   |
+        | so each controller caches at most one description |
+        | per known protocol version                        |
+        \*-------------------------------------------------*/
+        if(protocol_version > OPENRGB_SDK_PROTOCOL_VERSION)
+        {
+            protocol_version = OPENRGB_SDK_PROTOCOL_VERSION;
+        }
+
+        /*-------------------------------------------------*\
+        | The description is cached by the controller and   |
+        | shared between clients, only the colors are       |
+        | copied for each reply                             |
+        \*-------------------------------------------------*/
+        std::shared_ptr<const std::vector<unsigned char>> description = controllers[dev_idx]->GetDeviceDescriptionData(protocol_version);
+        std::vector<RGBColor>   reply_colors        = controllers[dev_idx]->colors;
+        unsigned int            num_colors          = reply_colors.size();
+        unsigned short          short_num_colors    = std::min(num_colors, 0xFFFFu);
+        unsigned int            reply_size;
+        unsigned int            num_bufs            = 4;
+        NetPacketBuffer         reply_bufs[5];
+        NetControllerID         reply_id;
+
+        /*-------------------------------------------------*\
+        | The color count is 32-bit from protocol 8 on      |
+        \*-------------------------------------------------*/
+        if(protocol_version >= 8)
+        {
+            reply_bufs[2].data = &num_colors;
+            reply_bufs[2].size = sizeof(num_colors);
+        }
+        else
+        {
+            num_colors         = short_num_colors;
+            reply_bufs[2].data = &short_num_colors;
+            reply_bufs[2].size = sizeof(short_num_colors);
+        }
 
-    pkt_hdr.pkt_dev_idx  = 0;
-    pkt_hdr.pkt_id       = NET_PACKET_ID_DEVICE_LIST_UPDATED;
-    pkt_hdr.pkt_size     = 0;
+        reply_size = sizeof(reply_size) + description->size() + reply_bufs[2].size + (num_colors * sizeof(RGBColor));
 
-    send(client_sock, (char *)&pkt_hdr, sizeof(NetPacketHeader), 0);
+        reply_bufs[0].data = &reply_size;
+        reply_bufs[0].size = sizeof(reply_size);
+        reply_bufs[1].data = description->data();
+        reply_bufs[1].size = description->size();
+        reply_bufs[3].data = reply_colors.data();
+        reply_bufs[3].size = num_colors * sizeof(RGBColor);
+
+        /*-------------------------------------------------*\
+        | From protocol 7, tag the reply with the ID and    |
+        | revision of the controller it describes, so the   |
+        | client can tell if the list changed since it sent |
+        | the request                                       |
+        \*-------------------------------------------------*/
+        if(protocol_version >= 7)
+        {
+            reply_id.id        = controllers[dev_idx]->GetID();
+            reply_id.revision  = controllers[dev_idx]->GetRevision();
+
+            reply_bufs[4].data = &reply_id;
+            reply_bufs[4].size = sizeof(reply_id);
+            num_bufs++;
+        }
+
+        SendClientPacketBuffers(client_info, pkt_dev_idx, NET_PACKET_ID_REQUEST_CONTROLLER_DATA, reply_bufs, num_bufs);
+    }
+}
+
+void NetworkServer::SendReply_ProtocolVersion(NetworkClientInfo * client_info)
+{
+    unsigned int    reply_data;
+
+    reply_data = OPENRGB_SDK_PROTOCOL_VERSION;
+
+    SendClientPacket(client_info, 0, NET_PACKET_ID_REQUEST_PROTOCOL_VERSION, &reply_data, sizeof(unsigned int));
+}
+
+void NetworkServer::SendRequest_DeviceListChanged(NetworkClientInfo * client_info)
+{
+    /*-------------------------------------------------*\
+    | Protocol 7 clients get the new controller ID list |
+    | so they only download controllers that changed    |
+    \*-------------------------------------------------*/
+    if(client_info->client_protocol_version >= 7)
+    {
+        std::vector<unsigned char> request_data = GetControllerIDs();
+
+        SendClientPacket(client_info, 0, NET_PACKET_ID_DEVICE_LIST_UPDATED, request_data.data(), request_data.size());
+    }
+    else
+    {
+        SendClientPacket(client_info, 0, NET_PACKET_ID_DEVICE_LIST_UPDATED, NULL, 0);
+    }
 }
 
-void NetworkServer::SendReply_ProfileList(SOCKET client_sock)
+void NetworkServer::SendReply_ProfileList(NetworkClientInfo * client_info)
 {
     if(!profile_manager)
     {
         return;
     }
 
-    NetPacketHeader reply_hdr;
     unsigned char *reply_data = profile_manager->GetProfileListDescription();
     unsigned int reply_size;
 
     memcpy(&reply_size, reply_data, sizeof(reply_size));
 
-    reply_hdr.pkt_magic[0] = 'O';
-    reply_hdr.pkt_magic[1] = 'R';
-    reply_hdr.pkt_magic[2] = 'G';
-    reply_hdr.pkt_magic[3] = 'B';
-
-    reply_hdr.pkt_dev_idx  = 0;
-    reply_hdr.pkt_id       = NET_PACKET_ID_REQUEST_PROFILE_LIST;
-    reply_hdr.pkt_size     = reply_size;
-
-    send(client_sock, (const char *)&reply_hdr, sizeof(NetPacketHeader), 0);
-    send(client_sock, (const char *)reply_data, reply_size, 0);
+    SendClientPacket(client_info, 0, NET_PACKET_ID_REQUEST_PROFILE_LIST, reply_data, reply_size);
 }
 
-void NetworkServer::SendReply_PluginList(SOCKET client_sock)
+void NetworkServer::SendReply_PluginList(NetworkClientInfo * client_info)
 {
     unsigned int data_size = 0;
     unsigned int data_ptr = 0;
@@ -1111,42 +2017,25 @@ void NetworkServer::SendReply_PluginList(SOCKET client_sock)
         data_ptr += sizeof(int);
     }
     
-    NetPacketHeader reply_hdr;
     unsigned int reply_size;
 
     memcpy(&reply_size, data_buf, sizeof(reply_size));
 
-    reply_hdr.pkt_magic[0] = 'O';
-    reply_hdr.pkt_magic[1] = 'R';
-    reply_hdr.pkt_magic[2] = 'G';
-    reply_hdr.pkt_magic[3] = 'B';
-
-    reply_hdr.pkt_dev_idx  = 0;
-    reply_hdr.pkt_id       = NET_PACKET_ID_REQUEST_PLUGIN_LIST;
-    reply_hdr.pkt_size     = reply_size;
-
-    send(client_sock, (const char *)&reply_hdr, sizeof(NetPacketHeader), 0);
-    send(client_sock, (const char *)data_buf, reply_size, 0);
+    SendClientPacket(client_info, 0, NET_PACKET_ID_REQUEST_PLUGIN_LIST, data_buf, reply_size);
 
     delete [] data_buf;
 }
 
-void NetworkServer::SendReply_PluginSpecific(SOCKET client_sock, unsigned int pkt_type, unsigned char* data, unsigned int data_size)
+void NetworkServer::SendReply_PluginSpecific(NetworkClientInfo * client_info, unsigned int pkt_type, unsigned char* data, unsigned int data_size)
 {
-    NetPacketHeader reply_hdr;
-
-    reply_hdr.pkt_magic[0] = 'O';
-    reply_hdr.pkt_magic[1] = 'R';
-    reply_hdr.pkt_magic[2] = 'G';
-    reply_hdr.pkt_magic[3] = 'B';
+    NetPacketBuffer reply_bufs[2];
 
-    reply_hdr.pkt_dev_idx  = 0;
-    reply_hdr.pkt_id       = NET_PACKET_ID_PLUGIN_SPECIFIC;
-    reply_hdr.pkt_size     = data_size + sizeof(pkt_type);
+    reply_bufs[0].data = &pkt_type;
+    reply_bufs[0].size = sizeof(pkt_type);
+    reply_bufs[1].data = data;
+    reply_bufs[1].size = data_size;
 
-    send(client_sock, (const char *)&reply_hdr, sizeof(NetPacketHeader), 0);
-    send(client_sock, (const char *)&pkt_type, sizeof(pkt_type), 0);
-    send(client_sock, (const char *)data, data_size, 0);
+    SendClientPacketBuffers(client_info, 0, NET_PACKET_ID_PLUGIN_SPECIFIC, reply_bufs, 2);
     delete [] data;
 }
 
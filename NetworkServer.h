@@ -11,6 +11,7 @@
 #include "net_port.h"
 #include "ProfileManager.h"
 
+#include <atomic>
 #include <mutex>
 #include <thread>
 #include <chrono>
@@ -19,6 +20,30 @@
 
 #define MAXSOCK 32
 #define TCP_TIMEOUT_SECONDS 5
+#define NET_RECV_BUFFER_SIZE 65536
+
+/*-----------------------------------------------------*\
+| Largest request a client may send.  Connections that  |
+| announce a larger packet are closed.                  |
+\*-----------------------------------------------------*/
+#define NET_MAX_PACKET_SIZE (64 * 1024 * 1024)
+
+/*-----------------------------------------------------*\
+| Most data that may wait in a client's send buffer in  |
+| event loop mode.  Clients that fall further behind    |
+| are disconnected.                                     |
+\*-----------------------------------------------------*/
+#define NET_MAX_SEND_BUFFER_SIZE (16 * 1024 * 1024)
+
+/*-----------------------------------------------------*\
+| Event loop server mode (Linux only)                   |
+|   Client sockets are multiplexed with epoll on a      |
+|   small fixed pool of event threads instead of one    |
+|   listener thread per client                          |
+\*-----------------------------------------------------*/
+#define NET_SERVER_MAX_CLIENTS_DEFAULT      1024
+#define NET_SERVER_EVENT_THREADS_DEFAULT    2
+#define NET_SERVER_MAX_EVENTS               64
 
 typedef void (*NetServerCallback)(void *);
 typedef unsigned char* (*NetPluginCallback)(void *, unsigned int, unsigned char*, unsigned int*);
@@ -44,6 +69,48 @@ public:
     std::string     client_string;
     unsigned int    client_protocol_version;
     std::string     client_ip;
+
+    /*-----------------------------------------------------*\
+    | Receive buffer, packets are parsed out of the range   |
+    | [recv_buf_start, recv_buf_end)                        |
+    \*-----------------------------------------------------*/
+    std::vector<char>   recv_buf;
+    std::size_t         recv_buf_start;
+    std::size_t         recv_buf_end;
+
+    /*-----------------------------------------------------*\
+    | Last frame received for each device, used as the base |
+    | for delta encoded LED updates.  Device indexes change |
+    | with the device list, so the frames are discarded by  |
+    | the receiving thread when delta_frames_reset is set.  |
+    \*-----------------------------------------------------*/
+    std::vector<std::vector<RGBColor>>  delta_frames;
+    std::atomic<bool>                   delta_frames_reset;
+
+    /*-----------------------------------------------------*\
+    | Send buffer, used in event loop mode.  Data that the  |
+    | socket does not accept right away is kept in the      |
+    | range [send_buf_start, send_buf.size()) and written   |
+    | by the event thread once the socket is writable.      |
+    | send_epoll_fd is the epoll instance the socket is     |
+    | registered with, or -1 before it is registered.       |
+    \*-----------------------------------------------------*/
+    bool                send_buffered;
+    std::mutex          send_mutex;
+    std::vector<char>   send_buf;
+    std::size_t         send_buf_start;
+    int                 send_epoll_fd;
+    bool                send_epoll_out;
+    bool                send_failed;
+
+    /*-----------------------------------------------------*\
+    | Number of threads sending to the client without       |
+    | holding ServerClientsMutex.  A client removed while   |
+    | this is non-zero is deleted by the last of them.      |
+    | Both are guarded by ServerClientsMutex.               |
+    \*-----------------------------------------------------*/
+    unsigned int        send_refs;
+    bool                removed;
 };
 
 class NetworkServer
@@ -70,24 +137,39 @@ public:
 
     void                                SetHost(std::string host);
     void                                SetPort(unsigned short new_port);
+    void                                SetEventLoop(bool enable);
+    void                                SetEventThreads(unsigned int num_threads);
+    void                                SetMaxClients(unsigned int num_clients);
 
     void                                StartServer();
     void                                StopServer();
 
     void                                ConnectionThreadFunction(int socket_idx);
     void                                ListenThreadFunction(NetworkClientInfo * client_sock);
+    void                                EventThreadFunction(unsigned int thread_idx);
+
+    bool                                ProcessClientData(NetworkClientInfo * client_info);
+    void                                ProcessRequest(NetworkClientInfo * client_info, NetPacketHeader & header, char * data);
 
     void                                ProcessRequest_ClientProtocolVersion(SOCKET client_sock, unsigned int data_size, char * data);
     void                                ProcessRequest_ClientString(SOCKET client_sock, unsigned int data_size, char * data);
+    void                                ProcessRequest_UpdateLEDsBatch(NetworkClientInfo * client_info, unsigned int data_size, char * data);
+    void                                ProcessRequest_UpdateLEDsDelta(NetworkClientInfo * client_info, unsigned int dev_idx, unsigned int data_size, char * data);
+
+    void                                SendClientPacket(NetworkClientInfo * client_info, unsigned int pkt_dev_idx, unsigned int pkt_id, const void * data, unsigned int data_size);
+    void                                SendClientPacketBuffers(NetworkClientInfo * client_info, unsigned int pkt_dev_idx, unsigned int pkt_id, const NetPacketBuffer * buffers, unsigned int num_buffers);
 
-    void                                SendReply_ControllerCount(SOCKET client_sock);
-    void                                SendReply_ControllerData(SOCKET client_sock, unsigned int dev_idx, unsigned int protocol_version);
-    void                                SendReply_ProtocolVersion(SOCKET client_sock);
+    void                                SendReply_ControllerCount(NetworkClientInfo * client_info);
+    void                                SendReply_ControllerIDs(NetworkClientInfo * client_info);
+    void                                SendReply_ControllerData(NetworkClientInfo * client_info, unsigned int pkt_dev_idx, unsigned int protocol_version);
+    void                                SendReply_ProtocolVersion(NetworkClientInfo * client_info);
 
-    void                                SendRequest_DeviceListChanged(SOCKET client_sock);
-    void                                SendReply_ProfileList(SOCKET client_sock);
-    void                                SendReply_PluginList(SOCKET client_sock);
-    void                                SendReply_PluginSpecific(SOCKET client_sock, unsigned int pkt_type, unsigned char* data, unsigned int data_size);
+    void                                SendRequest_DeviceListChanged(NetworkClientInfo * client_info);
+
+    void                                DeleteClient(NetworkClientInfo * client_info);
+    void                                SendReply_ProfileList(NetworkClientInfo * client_info);
+    void                                SendReply_PluginList(NetworkClientInfo * client_info);
+    void                                SendReply_PluginSpecific(NetworkClientInfo * client_info, unsigned int pkt_type, unsigned char* data, unsigned int data_size);
 
     void                                SetProfileManager(ProfileManagerInterface* profile_manager_pointer);
     
@@ -105,6 +187,11 @@ protected:
     std::mutex                          ServerClientsMutex;
     std::vector<NetworkClientInfo *>    ServerClients;
     std::thread *                       ConnectionThread[MAXSOCK];
+    std::vector<std::thread *>          EventThreads;
+
+    bool                                event_loop;
+    unsigned int                        event_thread_count;
+    unsigned int                        max_clients;
 
     std::mutex                          ClientInfoChangeMutex;
     std::vector<NetServerCallback>      ClientInfoChangeCallbacks;
@@ -128,4 +215,22 @@ private:
 
     int             accept_select(int sockfd);
     int             recv_select(SOCKET s, char *buf, int len, int flags);
+
+    std::vector<unsigned char>  GetControllerIDs();
+    int                         GetControllerIndex(NetworkClientInfo * client_info, unsigned int pkt_dev_idx);
+
+    void            InitClientInfo(NetworkClientInfo * client_info);
+    void            RemoveClient(NetworkClientInfo * client_info);
+
+#ifdef __linux__
+    std::vector<int>    event_fds;
+    int                 event_wake_fd;
+    unsigned int        event_next_thread;
+
+    bool            StartEventLoop();
+    void            StopEventLoop();
+    void            AcceptEventClient(int socket_idx);
+    bool            ReadEventClient(NetworkClientInfo * client_info);
+    bool            FlushEventClient(NetworkClientInfo * client_info);
+#endif
 };
@@ -211,8 +211,10 @@ HEADERS +=
     i2c_smbus/i2c_smbus.h                                                                       \
     i2c_tools/i2c_tools.h                                                                       \
     net_port/net_port.h                                                                         \
+    net_port/rest_scheduler.h                                                                   \
     pci_ids/pci_ids.h                                                                           \
     qt/DeviceView.h                                                                             \
+    qt/DeviceViewRefreshTicker.h                                                                \
     qt/OpenRGBDialog2.h                                                                         \
     qt/OpenRGBElgatoKeyLightSettingsPage/OpenRGBElgatoKeyLightSettingsEntry.h                   \
     qt/OpenRGBElgatoKeyLightSettingsPage/OpenRGBElgatoKeyLightSettingsPage.h                    \
@@ -727,6 +729,7 @@ SOURCES +=
     cli.cpp                                                                                     \
     LogManager.cpp                                                                              \
     NetworkClient.cpp                                                                           \
+    NetworkProtocol.cpp                                                                         \
     NetworkServer.cpp                                                                           \
     PluginManager.cpp                                                                           \
     ProfileManager.cpp                                                                          \
@@ -741,7 +744,9 @@ SOURCES +=
     i2c_smbus/i2c_smbus.cpp                                                                     \
     i2c_tools/i2c_tools.cpp                                                                     \
     net_port/net_port.cpp                                                                       \
+    net_port/rest_scheduler.cpp                                                                 \
     qt/DeviceView.cpp                                                                           \
+    qt/DeviceViewRefreshTicker.cpp                                                              \
     qt/OpenRGBDialog2.cpp                                                                       \
     qt/OpenRGBElgatoKeyLightSettingsPage/OpenRGBElgatoKeyLightSettingsEntry.cpp                 \
     qt/OpenRGBElgatoKeyLightSettingsPage/OpenRGBElgatoKeyLightSettingsPage.cpp                  \
@@ -1612,6 +1617,7 @@ contains(QMAKE_PLATFORM, linux) {
     Controllers/LinuxLEDController                                                              \
 
     HEADERS +=                                                                                  \
+    hidapi_wrapper/hid_hotplug_monitor.h                                                        \
     i2c_smbus/i2c_smbus_linux.h                                                                 \
     AutoStart/AutoStart-Linux.h                                                                 \
     Controllers/AsusTUFLaptopLinuxController/AsusTUFLaptopLinuxController.h                     \
@@ -1661,6 +1667,7 @@ contains(QMAKE_PLATFORM, linux) {
 
     SOURCES +=                                                                                  \
     dependencies/hueplusplus-1.0.0/src/LinHttpHandler.cpp                                       \
+    hidapi_wrapper/hid_hotplug_monitor_linux.cpp                                                \
     i2c_smbus/i2c_smbus_linux.cpp                                                               \
     serial_port/find_usb_serial_port_linux.cpp                                                  \
     AutoStart/AutoStart-Linux.cpp                                                               \
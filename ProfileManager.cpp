@@ -3,6 +3,7 @@
 #include "RGBController_Dummy.h"
 #include "LogManager.h"
 #include "filesystem.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <cstring>
@@ -11,6 +12,240 @@
 #define OPENRGB_PROFILE_HEADER  "OPENRGB_PROFILE"
 #define OPENRGB_PROFILE_VERSION OPENRGB_SDK_PROTOCOL_VERSION
 
+/*---------------------------------------------------------*\
+| Read a profile file into a list of dummy controllers.     |
+| The whole file is read in a single call and parsed from   |
+| memory.                                                   |
+\*---------------------------------------------------------*/
+static void ReadProfileFile(const filesystem::path& filename, std::vector<RGBController*>& temp_controllers)
+{
+    /*---------------------------------------------------------*\
+    | Open input file in binary mode and read it into a buffer  |
+    \*---------------------------------------------------------*/
+    std::ifstream controller_file(filename, std::ios::in | std::ios::binary | std::ios::ate);
+
+    if(!controller_file.is_open())
+    {
+        return;
+    }
+
+    std::streamoff file_size = controller_file.tellg();
+
+    if(file_size < (std::streamoff)(16 + sizeof(unsigned int)))
+    {
+        return;
+    }
+
+    std::vector<unsigned char> file_data((std::size_t)file_size);
+
+    controller_file.seekg(0);
+    controller_file.read((char *)file_data.data(), file_size);
+
+    if(controller_file.gcount() != file_size)
+    {
+        return;
+    }
+
+    /*---------------------------------------------------------*\
+    | Read and verify file header                               |
+    \*---------------------------------------------------------*/
+    unsigned int    profile_version;
+    std::size_t     controller_offset = 0;
+
+    if(memcmp(&file_data[0], OPENRGB_PROFILE_HEADER, 16) != 0)
+    {
+        return;
+    }
+
+    memcpy(&profile_version, &file_data[16], sizeof(unsigned int));
+
+    /*---------------------------------------------------------*\
+    | Profile version started at 1 and protocol version started |
+    | at 0.  Version 1 profiles should use protocol 0, but 2 or |
+    | greater should be synchronized                            |
+    \*---------------------------------------------------------*/
+    if(profile_version == 1)
+    {
+        profile_version = 0;
+    }
+
+    if(profile_version > OPENRGB_PROFILE_VERSION)
+    {
+        return;
+    }
+
+    controller_offset += 16 + sizeof(unsigned int);
+
+    /*---------------------------------------------------------*\
+    | Read controller data until the end of the buffer, stop at |
+    | the first truncated entry                                 |
+    \*---------------------------------------------------------*/
+    while(controller_offset + sizeof(unsigned int) <= file_data.size())
+    {
+        unsigned int controller_size;
+
+        memcpy(&controller_size, &file_data[controller_offset], sizeof(controller_size));
+
+        if((controller_size <= sizeof(controller_size))
+         ||(controller_size > file_data.size() - controller_offset))
+        {
+            LOG_WARNING("Profile %s is truncated, ignoring remaining data", filename.filename().string().c_str());
+            break;
+        }
+
+        RGBController_Dummy *temp_controller = new RGBController_Dummy();
+
+        temp_controller->ReadDeviceDescription(&file_data[controller_offset], profile_version);
+
+        temp_controllers.push_back(temp_controller);
+
+        controller_offset += controller_size;
+    }
+}
+
+/*---------------------------------------------------------*\
+| Hash of the identity fields that must match exactly for a |
+| saved controller to be applied to a live one.  Location   |
+| is left out as it is not always compared exactly.         |
+\*---------------------------------------------------------*/
+static std::size_t ProfileIdentityHash(RGBController* controller)
+{
+    std::hash<std::string>  string_hash;
+    std::size_t             hash = std::hash<int>()(controller->type);
+
+    hash ^= string_hash(controller->name)        + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+    hash ^= string_hash(controller->description) + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+    hash ^= string_hash(controller->version)     + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+    hash ^= string_hash(controller->serial)      + 0x9E3779B9 + (hash << 6) + (hash >> 2);
+
+    return(hash);
+}
+
+static bool ProfileControllerMatches(RGBController* temp_controller, RGBController* load_controller)
+{
+    /*---------------------------------------------------------*\
+    | Do not compare location string for HID devices, as the    |
+    | location string may change between runs as devices are    |
+    | connected and disconnected. Also do not compare the I2C   |
+    | bus number, since it is not persistent across reboots     |
+    | on Linux - strip the I2C number and compare only address. |
+    \*---------------------------------------------------------*/
+    bool location_check;
+
+    if(load_controller->location.find("HID: ") == 0)
+    {
+        location_check = true;
+    } 
+    else if(load_controller->location.find("I2C: ") == 0)
+    {
+        std::string i2c_address = load_controller->location.substr(load_controller->location.find_last_of(", ") + 2);
+        location_check = temp_controller->location.find(i2c_address) != std::string::npos;
+    }
+    else
+    {
+        location_check = temp_controller->location == load_controller->location;
+    }
+
+    /*---------------------------------------------------------*\
+    | Test if saved controller data matches this controller     |
+    \*---------------------------------------------------------*/
+    return((temp_controller->type               == load_controller->type       )
+         &&(temp_controller->name               == load_controller->name       )
+         &&(temp_controller->description        == load_controller->description)
+         &&(temp_controller->version            == load_controller->version    )
+         &&(temp_controller->serial             == load_controller->serial     )
+         &&(location_check                      == true                        ));
+}
+
+static void ApplyProfileToController
+    (
+    RGBController*                  temp_controller,
+    RGBController*                  load_controller,
+    bool                            load_size,
+    bool                            load_settings
+    )
+{
+    /*---------------------------------------------------------*\
+    | Update zone sizes if requested                            |
+    \*---------------------------------------------------------*/
+    if(load_size)
+    {
+        if(temp_controller->zones.size() == load_controller->zones.size())
+        {
+            for(std::size_t zone_idx = 0; zone_idx < temp_controller->zones.size(); zone_idx++)
+            {
+                if((temp_controller->zones[zone_idx].name       == load_controller->zones[zone_idx].name      )
+                 &&(temp_controller->zones[zone_idx].type       == load_controller->zones[zone_idx].type      )
+                 &&(temp_controller->zones[zone_idx].leds_min   == load_controller->zones[zone_idx].leds_min  )
+                 &&(temp_controller->zones[zone_idx].leds_max   == load_controller->zones[zone_idx].leds_max  ))
+                {
+                    if (temp_controller->zones[zone_idx].leds_count != load_controller->zones[zone_idx].leds_count)
+                    {
+                        load_controller->ResizeZone(zone_idx, temp_controller->zones[zone_idx].leds_count);
+                    }
+
+                    for(std::size_t segment_idx = 0; segment_idx < temp_controller->zones[zone_idx].segments.size(); segment_idx++)
+                    {
+                        load_controller->zones[zone_idx].segments.push_back(temp_controller->zones[zone_idx].segments[segment_idx]);
+                    }
+                }
+            }
+        }
+    }
+
+    /*---------------------------------------------------------*\
+    | Update settings if requested                              |
+    \*---------------------------------------------------------*/
+    if(load_settings)
+    {
+        /*---------------------------------------------------------*\
+        | Update all modes                                          |
+        \*---------------------------------------------------------*/
+        if(temp_controller->modes.size() == load_controller->modes.size())
+        {
+            for(std::size_t mode_index = 0; mode_index < temp_controller->modes.size(); mode_index++)
+            {
+                if((temp_controller->modes[mode_index].name             == load_controller->modes[mode_index].name          )
+                 &&(temp_controller->modes[mode_index].value            == load_controller->modes[mode_index].value         )
+                 &&(temp_controller->modes[mode_index].flags            == load_controller->modes[mode_index].flags         )
+                 &&(temp_controller->modes[mode_index].speed_min        == load_controller->modes[mode_index].speed_min     )
+                 &&(temp_controller->modes[mode_index].speed_max        == load_controller->modes[mode_index].speed_max     )
+               //&&(temp_controller->modes[mode_index].brightness_min   == load_controller->modes[mode_index].brightness_min)
+               //&&(temp_controller->modes[mode_index].brightness_max   == load_controller->modes[mode_index].brightness_max)
+                 &&(temp_controller->modes[mode_index].colors_min       == load_controller->modes[mode_index].colors_min    )
+                 &&(temp_controller->modes[mode_index].colors_max       == load_controller->modes[mode_index].colors_max   ))
+                {
+                    load_controller->modes[mode_index].speed            = temp_controller->modes[mode_index].speed;
+                    load_controller->modes[mode_index].brightness       = temp_controller->modes[mode_index].brightness;
+                    load_controller->modes[mode_index].direction        = temp_controller->modes[mode_index].direction;
+                    load_controller->modes[mode_index].color_mode       = temp_controller->modes[mode_index].color_mode;
+
+                    load_controller->modes[mode_index].colors.resize(temp_controller->modes[mode_index].colors.size());
+
+                    for(std::size_t mode_color_index = 0; mode_color_index < temp_controller->modes[mode_index].colors.size(); mode_color_index++)
+                    {
+                        load_controller->modes[mode_index].colors[mode_color_index] = temp_controller->modes[mode_index].colors[mode_color_index];
+                    }
+                }
+
+            }
+
+            load_controller->active_mode = temp_controller->active_mode;
+        }
+
+        /*---------------------------------------------------------*\
+        | Update all colors                                         |
+        \*---------------------------------------------------------*/
+        if(temp_controller->colors.size() == load_controller->colors.size())
+        {
+            for(std::size_t color_index = 0; color_index < temp_controller->colors.size(); color_index++)
+            {
+                load_controller->colors[color_index] = temp_controller->colors[color_index];
+            }
+        }
+    }
+}
+
 ProfileManager::ProfileManager(const filesystem::path& config_dir)
 {
     configuration_directory = config_dir;
@@ -19,7 +254,7 @@ ProfileManager::ProfileManager(const filesystem::path& config_dir)
 
 ProfileManager::~ProfileManager()
 {
-
+    ClearProfileCache();
 }
 
 bool ProfileManager::SaveProfile(std::string profile_name, bool sizes)
@@ -87,8 +322,9 @@ bool ProfileManager::SaveProfile(std::string profile_name, bool sizes)
         controller_file.close();
 
         /*---------------------------------------------------------*\
-        | Update the profile list                                   |
+        | Update the profile list and drop any stale cached copy    |
         \*---------------------------------------------------------*/
+        ClearProfileCache();
         UpdateProfileList();
 
         return(true);
@@ -102,6 +338,7 @@ bool ProfileManager::SaveProfile(std::string profile_name, bool sizes)
 void ProfileManager::SetConfigurationDirectory(const filesystem::path& directory)
 {
     configuration_directory = directory;
+    ClearProfileCache();
     UpdateProfileList();
 }
 
@@ -115,16 +352,12 @@ bool ProfileManager::LoadSizeFromProfile(std::string profile_name)
     return(LoadProfileWithOptions(profile_name, true, false));
 }
 
-std::vector<RGBController*> ProfileManager::LoadProfileToList
+filesystem::path ProfileManager::GetProfilePath
     (
     std::string     profile_name,
     bool            sizes
     )
 {
-    std::vector<RGBController*> temp_controllers;
-    unsigned int                controller_size;
-    unsigned int                controller_offset = 0;
-
     filesystem::path filename = configuration_directory / filesystem::u8path(profile_name);
 
     /*---------------------------------------------------------*\
@@ -142,204 +375,183 @@ std::vector<RGBController*> ProfileManager::LoadProfileToList
         }
     }
 
-    /*---------------------------------------------------------*\
-    | Open input file in binary mode                            |
-    \*---------------------------------------------------------*/
-    std::ifstream controller_file(filename, std::ios::in | std::ios::binary);
-
-    /*---------------------------------------------------------*\
-    | Read and verify file header                               |
-    \*---------------------------------------------------------*/
-    char            profile_string[16];
-    unsigned int    profile_version;
+    return(filename);
+}
 
-    controller_file.read(profile_string, 16);
-    controller_file.read((char *)&profile_version, sizeof(unsigned int));
+std::vector<RGBController*> ProfileManager::LoadProfileToList
+    (
+    std::string     profile_name,
+    bool            sizes
+    )
+{
+    std::vector<RGBController*> temp_controllers;
 
-    /*---------------------------------------------------------*\
-    | Profile version started at 1 and protocol version started |
-    | at 0.  Version 1 profiles should use protocol 0, but 2 or |
-    | greater should be synchronized                            |
-    \*---------------------------------------------------------*/
-    if(profile_version == 1)
-    {
-        profile_version = 0;
-    }
+    ReadProfileFile(GetProfilePath(profile_name, sizes), temp_controllers);
 
-    controller_offset += 16 + sizeof(unsigned int);
-    controller_file.seekg(controller_offset);
+    return(temp_controllers);
+}
 
-    if(strcmp(profile_string, OPENRGB_PROFILE_HEADER) == 0)
+bool ProfileManager::LoadDeviceFromListWithOptions
+    (
+    std::vector<RGBController*>&    temp_controllers,
+    std::vector<bool>&              temp_controller_used,
+    RGBController*                  load_controller,
+    bool                            load_size,
+    bool                            load_settings
+    )
+{
+    for(std::size_t temp_index = 0; temp_index < temp_controllers.size(); temp_index++)
     {
-        if(profile_version <= OPENRGB_PROFILE_VERSION)
+        RGBController *temp_controller = temp_controllers[temp_index];
+
+        if((temp_controller_used[temp_index] == false)
+         &&(ProfileControllerMatches(temp_controller, load_controller)))
         {
             /*---------------------------------------------------------*\
-            | Read controller data from file until EOF                  |
+            | Set used flag for this temp device                        |
             \*---------------------------------------------------------*/
-            while(!(controller_file.peek() == EOF))
-            {
-                controller_file.read((char *)&controller_size, sizeof(controller_size));
-
-                unsigned char *controller_data = new unsigned char[controller_size];
+            temp_controller_used[temp_index] = true;
 
-                controller_file.seekg(controller_offset);
+            ApplyProfileToController(temp_controller, load_controller, load_size, load_settings);
 
-                controller_file.read((char *)controller_data, controller_size);
+            return(true);
+        }
+    }
 
-                RGBController_Dummy *temp_controller = new RGBController_Dummy();
+    return(false);
+}
 
-                temp_controller->ReadDeviceDescription(controller_data, profile_version);
+ProfileCacheEntry* ProfileManager::GetCachedProfile(const filesystem::path& profile_path)
+{
+    std::error_code             ec;
+    filesystem::file_time_type  write_time  = filesystem::last_write_time(profile_path, ec);
+    std::uintmax_t              file_size   = ec ? 0 : filesystem::file_size(profile_path, ec);
 
-                temp_controllers.push_back(temp_controller);
+    std::map<filesystem::path, ProfileCacheEntry>::iterator it = ProfileCache.find(profile_path);
 
-                delete[] controller_data;
+    /*---------------------------------------------------------*\
+    | Drop the cached copy if the file is gone or has changed   |
+    \*---------------------------------------------------------*/
+    if(it != ProfileCache.end())
+    {
+        if(!ec && (it->second.write_time == write_time) && (it->second.file_size == file_size))
+        {
+            return(&it->second);
+        }
 
-                controller_offset += controller_size;
-                controller_file.seekg(controller_offset);
-            }
+        for(std::size_t controller_idx = 0; controller_idx < it->second.controllers.size(); controller_idx++)
+        {
+            delete it->second.controllers[controller_idx];
         }
+
+        ProfileCache.erase(it);
     }
 
-    return(temp_controllers);
+    if(ec)
+    {
+        return(nullptr);
+    }
+
+    /*---------------------------------------------------------*\
+    | Parse the file and index its controllers by identity      |
+    \*---------------------------------------------------------*/
+    ProfileCacheEntry& entry = ProfileCache[profile_path];
+
+    entry.write_time    = write_time;
+    entry.file_size     = file_size;
+
+    ReadProfileFile(profile_path, entry.controllers);
+
+    for(unsigned int temp_index = 0; temp_index < entry.controllers.size(); temp_index++)
+    {
+        entry.index[ProfileIdentityHash(entry.controllers[temp_index])].push_back(temp_index);
+    }
+
+    return(&entry);
 }
 
-bool ProfileManager::LoadDeviceFromListWithOptions
+void ProfileManager::BuildApplyPlan
     (
-    std::vector<RGBController*>&    temp_controllers,
-    std::vector<bool>&              temp_controller_used,
-    RGBController*                  load_controller,
-    bool                            load_size,
-    bool                            load_settings
+    ProfileCacheEntry*              entry,
+    std::vector<RGBController*>&    controllers
     )
 {
-    for(std::size_t temp_index = 0; temp_index < temp_controllers.size(); temp_index++)
+    std::vector<bool> temp_controller_used(entry->controllers.size(), false);
+
+    entry->plan.resize(controllers.size());
+
+    /*---------------------------------------------------------*\
+    | For each controller, only compare against saved entries   |
+    | with the same identity hash.  Entries are kept in file    |
+    | order so the first unused match wins as before.           |
+    \*---------------------------------------------------------*/
+    for(std::size_t controller_index = 0; controller_index < controllers.size(); controller_index++)
     {
-        RGBController *temp_controller = temp_controllers[temp_index];
+        ProfileApplyStep& step  = entry->plan[controller_index];
 
-        /*---------------------------------------------------------*\
-        | Do not compare location string for HID devices, as the    |
-        | location string may change between runs as devices are    |
-        | connected and disconnected. Also do not compare the I2C   |
-        | bus number, since it is not persistent across reboots     |
-        | on Linux - strip the I2C number and compare only address. |
-        \*---------------------------------------------------------*/
-        bool location_check;
+        step.controller         = controllers[controller_index];
+        step.controller_id      = controllers[controller_index]->GetID();
+        step.stored_index       = -1;
 
-        if(load_controller->location.find("HID: ") == 0)
-        {
-            location_check = true;
-        } 
-        else if(load_controller->location.find("I2C: ") == 0)
-        {
-            std::string i2c_address = load_controller->location.substr(load_controller->location.find_last_of(", ") + 2);
-            location_check = temp_controller->location.find(i2c_address) != std::string::npos;
-        }
-        else
+        std::unordered_map<std::size_t, std::vector<unsigned int>>::iterator it = entry->index.find(ProfileIdentityHash(controllers[controller_index]));
+
+        if(it == entry->index.end())
         {
-            location_check = temp_controller->location == load_controller->location;
+            continue;
         }
 
-        /*---------------------------------------------------------*\
-        | Test if saved controller data matches this controller     |
-        \*---------------------------------------------------------*/
-        if((temp_controller_used[temp_index]    == false                       )
-         &&(temp_controller->type               == load_controller->type       )
-         &&(temp_controller->name               == load_controller->name       )
-         &&(temp_controller->description        == load_controller->description)
-         &&(temp_controller->version            == load_controller->version    )
-         &&(temp_controller->serial             == load_controller->serial     )
-         &&(location_check                      == true                        ))
+        for(std::size_t candidate_idx = 0; candidate_idx < it->second.size(); candidate_idx++)
         {
-            /*---------------------------------------------------------*\
-            | Set used flag for this temp device                        |
-            \*---------------------------------------------------------*/
-            temp_controller_used[temp_index] = true;
+            unsigned int temp_index = it->second[candidate_idx];
 
-            /*---------------------------------------------------------*\
-            | Update zone sizes if requested                            |
-            \*---------------------------------------------------------*/
-            if(load_size)
+            if((temp_controller_used[temp_index] == false)
+             &&(ProfileControllerMatches(entry->controllers[temp_index], controllers[controller_index])))
             {
-                if(temp_controller->zones.size() == load_controller->zones.size())
-                {
-                    for(std::size_t zone_idx = 0; zone_idx < temp_controller->zones.size(); zone_idx++)
-                    {
-                        if((temp_controller->zones[zone_idx].name       == load_controller->zones[zone_idx].name      )
-                         &&(temp_controller->zones[zone_idx].type       == load_controller->zones[zone_idx].type      )
-                         &&(temp_controller->zones[zone_idx].leds_min   == load_controller->zones[zone_idx].leds_min  )
-                         &&(temp_controller->zones[zone_idx].leds_max   == load_controller->zones[zone_idx].leds_max  ))
-                        {
-                            if (temp_controller->zones[zone_idx].leds_count != load_controller->zones[zone_idx].leds_count)
-                            {
-                                load_controller->ResizeZone(zone_idx, temp_controller->zones[zone_idx].leds_count);
-                            }
-
-                            for(std::size_t segment_idx = 0; segment_idx < temp_controller->zones[zone_idx].segments.size(); segment_idx++)
-                            {
-                                load_controller->zones[zone_idx].segments.push_back(temp_controller->zones[zone_idx].segments[segment_idx]);
-                            }
-                        }
-                    }
-                }
+                temp_controller_used[temp_index] = true;
+                step.stored_index = temp_index;
+                break;
             }
+        }
+    }
+}
 
-            /*---------------------------------------------------------*\
-            | Update settings if requested                              |
-            \*---------------------------------------------------------*/
-            if(load_settings)
-            {
-                /*---------------------------------------------------------*\
-                | Update all modes                                          |
-                \*---------------------------------------------------------*/
-                if(temp_controller->modes.size() == load_controller->modes.size())
-                {
-                    for(std::size_t mode_index = 0; mode_index < temp_controller->modes.size(); mode_index++)
-                    {
-                        if((temp_controller->modes[mode_index].name             == load_controller->modes[mode_index].name          )
-                         &&(temp_controller->modes[mode_index].value            == load_controller->modes[mode_index].value         )
-                         &&(temp_controller->modes[mode_index].flags            == load_controller->modes[mode_index].flags         )
-                         &&(temp_controller->modes[mode_index].speed_min        == load_controller->modes[mode_index].speed_min     )
-                         &&(temp_controller->modes[mode_index].speed_max        == load_controller->modes[mode_index].speed_max     )
-                       //&&(temp_controller->modes[mode_index].brightness_min   == load_controller->modes[mode_index].brightness_min)
-                       //&&(temp_controller->modes[mode_index].brightness_max   == load_controller->modes[mode_index].brightness_max)
-                         &&(temp_controller->modes[mode_index].colors_min       == load_controller->modes[mode_index].colors_min    )
-                         &&(temp_controller->modes[mode_index].colors_max       == load_controller->modes[mode_index].colors_max   ))
-                        {
-                            load_controller->modes[mode_index].speed            = temp_controller->modes[mode_index].speed;
-                            load_controller->modes[mode_index].brightness       = temp_controller->modes[mode_index].brightness;
-                            load_controller->modes[mode_index].direction        = temp_controller->modes[mode_index].direction;
-                            load_controller->modes[mode_index].color_mode       = temp_controller->modes[mode_index].color_mode;
-
-                            load_controller->modes[mode_index].colors.resize(temp_controller->modes[mode_index].colors.size());
-
-                            for(std::size_t mode_color_index = 0; mode_color_index < temp_controller->modes[mode_index].colors.size(); mode_color_index++)
-                            {
-                                load_controller->modes[mode_index].colors[mode_color_index] = temp_controller->modes[mode_index].colors[mode_color_index];
-                            }
-                        }
+void ProfileManager::ClearProfileCache()
+{
+    std::lock_guard<std::mutex> lock(ProfileCacheMutex);
 
-                    }
+    for(std::map<filesystem::path, ProfileCacheEntry>::iterator it = ProfileCache.begin(); it != ProfileCache.end(); it++)
+    {
+        for(std::size_t controller_idx = 0; controller_idx < it->second.controllers.size(); controller_idx++)
+        {
+            delete it->second.controllers[controller_idx];
+        }
+    }
 
-                    load_controller->active_mode = temp_controller->active_mode;
-                }
+    ProfileCache.clear();
+}
 
-                /*---------------------------------------------------------*\
-                | Update all colors                                         |
-                \*---------------------------------------------------------*/
-                if(temp_controller->colors.size() == load_controller->colors.size())
-                {
-                    for(std::size_t color_index = 0; color_index < temp_controller->colors.size(); color_index++)
-                    {
-                        load_controller->colors[color_index] = temp_controller->colors[color_index];
-                    }
-                }
-            }
+bool ProfileManager::LoadLastProfileForControllers(std::vector<RGBController*>& controllers)
+{
+    std::string profile_name;
 
-            return(true);
-        }
+    {
+        std::lock_guard<std::mutex> lock(ProfileCacheMutex);
+
+        profile_name = last_profile_name;
     }
 
-    return(false);
+    if(profile_name.empty() || controllers.empty())
+    {
+        return(false);
+    }
+
+    /*---------------------------------------------------------*    | Build the plan for the whole controller list, so entries  |
+    | already matched to earlier devices count as used and the  |
+    | cached plan stays valid for the next full load            |
+    \*---------------------------------------------------------*/
+    std::vector<RGBController *> all_controllers = ResourceManager::get()->GetRGBControllers();
+
+    return(LoadProfileToControllers(profile_name, all_controllers, false, true, &controllers));
 }
 
 bool ProfileManager::LoadProfileWithOptions
@@ -349,47 +561,137 @@ bool ProfileManager::LoadProfileWithOptions
     bool            load_settings
     )
 {
-    std::vector<RGBController*> temp_controllers;
-    std::vector<bool>           temp_controller_used;
-    bool                        ret_val = false;
-
     /*---------------------------------------------------------*\
     | Get the list of controllers from the resource manager     |
     \*---------------------------------------------------------*/
     std::vector<RGBController *> controllers = ResourceManager::get()->GetRGBControllers();
 
+    return(LoadProfileToControllers(profile_name, controllers, load_size, load_settings));
+}
+
+bool ProfileManager::LoadProfileToControllers
+    (
+    std::string                     profile_name,
+    std::vector<RGBController*>&    controllers,
+    bool                            load_size,
+    bool                            load_settings,
+    const std::vector<RGBController*>* apply_controllers
+    )
+{
+    bool                        ret_val = false;
+
+    std::lock_guard<std::mutex> lock(ProfileCacheMutex);
+
+    /*---------------------------------------------------------*\
+    | Get the parsed profile, reading the file only if it has   |
+    | not been loaded yet or has changed since                  |
+    \*---------------------------------------------------------*/
+    ProfileCacheEntry* entry = GetCachedProfile(GetProfilePath(profile_name, false));
+
+    if(entry == nullptr)
+    {
+        LOG_WARNING("Profile loading: %s could not be read", profile_name.c_str());
+        return(false);
+    }
+
     /*---------------------------------------------------------*\
-    | Open input file in binary mode                            |
+    | Remember the profile so devices that are detected later   |
+    | can be given their saved settings too                     |
     \*---------------------------------------------------------*/
-    temp_controllers = LoadProfileToList(profile_name);
+    if(load_settings)
+    {
+        last_profile_name = profile_name;
+    }
 
     /*---------------------------------------------------------*\
-    | Set up used flag vector                                   |
+    | The apply plan stays valid as long as the controller list |
+    | is the same.  IDs are never reused, so a controller that  |
+    | was removed and re-created forces a rebuild.              |
     \*---------------------------------------------------------*/
-    temp_controller_used.resize(temp_controllers.size());
+    bool plan_valid = (entry->plan.size() == controllers.size());
 
-    for(unsigned int controller_idx = 0; controller_idx < temp_controller_used.size(); controller_idx++)
+    for(std::size_t controller_index = 0; plan_valid && controller_index < controllers.size(); controller_index++)
     {
-        temp_controller_used[controller_idx] = false;
+        plan_valid = (entry->plan[controller_index].controller    == controllers[controller_index])
+                  && (entry->plan[controller_index].controller_id == controllers[controller_index]->GetID());
+    }
+
+    if(!plan_valid)
+    {
+        BuildApplyPlan(entry, controllers);
+    }
+
+    /*---------------------------------------------------------*    | If only some of the controllers are to be loaded, skip    |
+    | the steps for the others                                  |
+    \*---------------------------------------------------------*/
+    std::vector<bool> apply_step(entry->plan.size(), true);
+
+    if(apply_controllers != nullptr)
+    {
+        for(std::size_t controller_index = 0; controller_index < entry->plan.size(); controller_index++)
+        {
+            apply_step[controller_index] = (std::find(apply_controllers->begin(), apply_controllers->end(), entry->plan[controller_index].controller) != apply_controllers->end());
+        }
     }
 
     /*---------------------------------------------------------*\
-    | Loop through all controllers.  For each controller, search|
-    | all saved controllers until a match is found              |
+    | When loading settings, hold device updates on the matched |
+    | controllers so they all change at the same time instead   |
+    | of one after another                                      |
     \*---------------------------------------------------------*/
-    for(std::size_t controller_index = 0; controller_index < controllers.size(); controller_index++)
+    std::vector<RGBController*> update_controllers;
+
+    if(load_settings)
     {
-        ret_val = LoadDeviceFromListWithOptions(temp_controllers, temp_controller_used, controllers[controller_index], load_size, load_settings);
-        std::string current_name = controllers[controller_index]->name + " @ " + controllers[controller_index]->location;
-        LOG_INFO("Profile loading: %s for %s", ( ret_val ? "Succeeded" : "FAILED!" ), current_name.c_str());
+        for(std::size_t controller_index = 0; controller_index < entry->plan.size(); controller_index++)
+        {
+            if(apply_step[controller_index] && (entry->plan[controller_index].stored_index >= 0))
+            {
+                update_controllers.push_back(entry->plan[controller_index].controller);
+            }
+        }
+
+        ResourceManager::get()->BeginUpdateTransaction(update_controllers);
     }
 
     /*---------------------------------------------------------*\
-    | Delete all temporary controllers                          |
+    | Apply the saved settings to each matched controller       |
     \*---------------------------------------------------------*/
-    for(unsigned int controller_idx = 0; controller_idx < temp_controllers.size(); controller_idx++)
+    for(std::size_t controller_index = 0; controller_index < entry->plan.size(); controller_index++)
+    {
+        if(!apply_step[controller_index])
+        {
+            continue;
+        }
+
+        ProfileApplyStep& step = entry->plan[controller_index];
+
+        ret_val = (step.stored_index >= 0);
+
+        if(ret_val)
+        {
+            ApplyProfileToController(entry->controllers[step.stored_index], step.controller, load_size, load_settings);
+
+            if(load_settings)
+            {
+                step.controller->UpdateMode();
+
+                if((step.controller->active_mode >= 0)
+                 &&((std::size_t)step.controller->active_mode < step.controller->modes.size())
+                 &&(step.controller->modes[step.controller->active_mode].color_mode == MODE_COLORS_PER_LED))
+                {
+                    step.controller->UpdateLEDs();
+                }
+            }
+        }
+
+        std::string current_name = step.controller->name + " @ " + step.controller->location;
+        LOG_INFO("Profile loading: %s for %s", ( ret_val ? "Succeeded" : "FAILED!" ), current_name.c_str());
+    }
+
+    if(load_settings)
     {
-        delete temp_controllers[controller_idx];
+        ResourceManager::get()->CommitUpdateTransaction(update_controllers);
     }
 
     return(ret_val);
@@ -402,6 +704,7 @@ void ProfileManager::DeleteProfile(std::string profile_name)
 
     filesystem::remove(filename);
 
+    ClearProfileCache();
     UpdateProfileList();
 }
 
@@ -4,6 +4,10 @@
 
 #include "filesystem.h"
 
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
 class ProfileManagerInterface
 {
 public:
@@ -39,6 +43,31 @@ protected:
     virtual ~ProfileManagerInterface() {};
 };
 
+/*---------------------------------------------------------*\
+| Maps one live controller to its stored entry in a cached  |
+| profile.  stored_index is -1 if the profile has no entry  |
+| for this controller.                                      |
+\*---------------------------------------------------------*/
+struct ProfileApplyStep
+{
+    RGBController*                  controller;
+    unsigned int                    controller_id;
+    int                             stored_index;
+};
+
+/*---------------------------------------------------------*\
+| A profile file parsed once and kept in memory until the   |
+| file changes on disk                                      |
+\*---------------------------------------------------------*/
+struct ProfileCacheEntry
+{
+    filesystem::file_time_type      write_time;
+    std::uintmax_t                  file_size;
+    std::vector<RGBController*>     controllers;
+    std::unordered_map<std::size_t, std::vector<unsigned int>> index;
+    std::vector<ProfileApplyStep>   plan;
+};
+
 class ProfileManager: public ProfileManagerInterface
 {
 public:
@@ -72,16 +101,49 @@ public:
         bool            sizes = false
         );
 
+    /*-----------------------------------------------------*\
+    | Applies the last profile loaded with LoadProfile to   |
+    | controllers that were detected after it was loaded.   |
+    | They are matched against the whole controller list,   |
+    | so saved entries of earlier devices are not reused.   |
+    \*-----------------------------------------------------*/
+    bool LoadLastProfileForControllers(std::vector<RGBController*>& controllers);
+
     void SetConfigurationDirectory(const filesystem::path& directory);
 
 private:
     filesystem::path configuration_directory;
 
+    std::mutex                                  ProfileCacheMutex;
+    std::map<filesystem::path, ProfileCacheEntry> ProfileCache;
+    std::string                                 last_profile_name;
+
     void UpdateProfileList();
+    void ClearProfileCache();
+
+    filesystem::path GetProfilePath
+            (
+            std::string     profile_name,
+            bool            sizes
+            );
+    ProfileCacheEntry* GetCachedProfile(const filesystem::path& profile_path);
+    void BuildApplyPlan
+            (
+            ProfileCacheEntry*              entry,
+            std::vector<RGBController*>&    controllers
+            );
     bool LoadProfileWithOptions
             (
             std::string     profile_name,
             bool            load_size,
             bool            load_settings
             );
+    bool LoadProfileToControllers
+            (
+            std::string                     profile_name,
+            std::vector<RGBController*>&    controllers,
+            bool                            load_size,
+            bool                            load_settings,
+            const std::vector<RGBController*>* apply_controllers = nullptr
+            );
 };
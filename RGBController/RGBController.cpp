@@ -1,8 +1,73 @@
 #include "RGBController.h"
+#include "LogManager.h"
 #include <cstring>
+#include <algorithm>
 
 using namespace std::chrono_literals;
 
+/*---------------------------------------------------------*\
+| Source of controller IDs, starting at 1                   |
+\*---------------------------------------------------------*/
+static std::atomic<unsigned int> next_controller_id(1);
+
+/*---------------------------------------------------------*\
+| Element counts and the zone matrix size are 16-bit in     |
+| descriptions before protocol 8 and 32-bit from protocol 8 |
+| on.  Counts are limited to 65535 for older protocols.     |
+\*---------------------------------------------------------*/
+static unsigned int DescriptionCountSize(unsigned int protocol_version)
+{
+    return((protocol_version >= 8) ? sizeof(unsigned int) : sizeof(unsigned short));
+}
+
+static unsigned int ClampDescriptionCount(unsigned int count, unsigned int protocol_version)
+{
+    if((protocol_version < 8) && (count > 0xFFFF))
+    {
+        return(0xFFFF);
+    }
+
+    return(count);
+}
+
+static void WriteDescriptionCount(unsigned char* data_buf, unsigned int& data_ptr, unsigned int count, unsigned int protocol_version)
+{
+    if(protocol_version >= 8)
+    {
+        memcpy(&data_buf[data_ptr], &count, sizeof(unsigned int));
+        data_ptr += sizeof(unsigned int);
+    }
+    else
+    {
+        unsigned short short_count = count;
+
+        memcpy(&data_buf[data_ptr], &short_count, sizeof(unsigned short));
+        data_ptr += sizeof(unsigned short);
+    }
+}
+
+static unsigned int ReadDescriptionCount(unsigned char* data_buf, unsigned int& data_ptr, unsigned int protocol_version)
+{
+    if(protocol_version >= 8)
+    {
+        unsigned int count;
+
+        memcpy(&count, &data_buf[data_ptr], sizeof(unsigned int));
+        data_ptr += sizeof(unsigned int);
+
+        return(count);
+    }
+    else
+    {
+        unsigned short short_count;
+
+        memcpy(&short_count, &data_buf[data_ptr], sizeof(unsigned short));
+        data_ptr += sizeof(unsigned short);
+
+        return(short_count);
+    }
+}
+
 mode::mode()
 {
     name           = "";
@@ -27,13 +92,28 @@ mode::~mode()
 
 RGBController::RGBController()
 {
+    CallFlag_UpdateLEDs    = false;
+    CallFlag_UpdateMode    = false;
+    UpdateInterval         = std::chrono::microseconds(0);
+    PartialUpdates         = false;
+    UpdateHoldCount        = 0;
+    RevisionPending        = false;
+    UpdateCallbackNextCall = 0;
+    ID                     = next_controller_id++;
+    Revision               = 0;
+    DescriptionRevision    = 0;
+
     DeviceThreadRunning = true;
     DeviceCallThread = new std::thread(&RGBController::DeviceCallThreadFunction, this);
 }
 
 RGBController::~RGBController()
 {
+    CallFlagMutex.lock();
     DeviceThreadRunning = false;
+    CallFlagMutex.unlock();
+
+    CallFlagCV.notify_one();
     DeviceCallThread->join();
     delete DeviceCallThread;
 
@@ -44,6 +124,77 @@ RGBController::~RGBController()
 }
 
 unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_version)
+{
+    std::shared_ptr<const std::vector<unsigned char>> description = GetDeviceDescriptionData(protocol_version);
+
+    unsigned int    num_colors  = colors.size();
+    unsigned int    data_ptr    = 0;
+    unsigned int    data_size   = 0;
+
+    if(protocol_version < 8)
+    {
+        num_colors = ClampDescriptionCount(num_colors, protocol_version);
+    }
+
+    data_size = sizeof(data_size) + description->size() + DescriptionCountSize(protocol_version) + (num_colors * sizeof(RGBColor));
+
+    unsigned char * data_buf    = new unsigned char[data_size];
+
+    /*---------------------------------------------------------*\
+    | Copy in data size                                         |
+    \*---------------------------------------------------------*/
+    memcpy(&data_buf[data_ptr], &data_size, sizeof(data_size));
+    data_ptr += sizeof(data_size);
+
+    /*---------------------------------------------------------*\
+    | Copy in the cached description                            |
+    \*---------------------------------------------------------*/
+    memcpy(&data_buf[data_ptr], description->data(), description->size());
+    data_ptr += description->size();
+
+    /*---------------------------------------------------------*\
+    | Copy in number of colors (data)                           |
+    \*---------------------------------------------------------*/
+    WriteDescriptionCount(data_buf, data_ptr, num_colors, protocol_version);
+
+    /*---------------------------------------------------------*\
+    | Copy in colors                                            |
+    \*---------------------------------------------------------*/
+    if(num_colors > 0)
+    {
+        memcpy(&data_buf[data_ptr], &colors[0], num_colors * sizeof(RGBColor));
+    }
+
+    return(data_buf);
+}
+
+std::shared_ptr<const std::vector<unsigned char>> RGBController::GetDeviceDescriptionData(unsigned int protocol_version)
+{
+    std::lock_guard<std::mutex> lock(DescriptionMutex);
+
+    /*---------------------------------------------------------*\
+    | Drop the cached descriptions if the controller has        |
+    | changed since they were built                             |
+    \*---------------------------------------------------------*/
+    unsigned int revision = Revision;
+
+    if(revision != DescriptionRevision)
+    {
+        DescriptionCache.clear();
+        DescriptionRevision = revision;
+    }
+
+    std::shared_ptr<const std::vector<unsigned char>>& description = DescriptionCache[protocol_version];
+
+    if(!description)
+    {
+        description = std::make_shared<const std::vector<unsigned char>>(BuildDeviceDescriptionData(protocol_version));
+    }
+
+    return(description);
+}
+
+std::vector<unsigned char> RGBController::BuildDeviceDescriptionData(unsigned int protocol_version)
 {
     unsigned int data_ptr = 0;
     unsigned int data_size = 0;
@@ -57,19 +208,25 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
     unsigned short version_len      = strlen(version.c_str())       + 1;
     unsigned short serial_len       = strlen(serial.c_str())        + 1;
     unsigned short location_len     = strlen(location.c_str())      + 1;
-    unsigned short num_modes        = modes.size();
-    unsigned short num_zones        = zones.size();
-    unsigned short num_leds         = leds.size();
-    unsigned short num_colors       = colors.size();
+    unsigned int   num_modes        = modes.size();
+    unsigned int   num_zones        = zones.size();
+    unsigned int   num_leds         = leds.size();
+    unsigned int   count_size       = DescriptionCountSize(protocol_version);
+
+    if(protocol_version < 8)
+    {
+        num_modes   = ClampDescriptionCount(num_modes, protocol_version);
+        num_zones   = ClampDescriptionCount(num_zones, protocol_version);
+        num_leds    = ClampDescriptionCount(num_leds, protocol_version);
+    }
 
     unsigned short *mode_name_len   = new unsigned short[num_modes];
     unsigned short *zone_name_len   = new unsigned short[num_zones];
     unsigned short *led_name_len    = new unsigned short[num_leds];
 
-    unsigned short *zone_matrix_len = new unsigned short[num_zones];
-    unsigned short *mode_num_colors = new unsigned short[num_modes];
+    unsigned int   *zone_matrix_len = new unsigned int[num_zones];
+    unsigned int   *mode_num_colors = new unsigned int[num_modes];
 
-    data_size += sizeof(data_size);
     data_size += sizeof(device_type);
     data_size += name_len           + sizeof(name_len);
 
@@ -83,10 +240,10 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
     data_size += serial_len         + sizeof(serial_len);
     data_size += location_len       + sizeof(location_len);
 
-    data_size += sizeof(num_modes);
+    data_size += count_size;
     data_size += sizeof(active_mode);
 
-    for(int mode_index = 0; mode_index < num_modes; mode_index++)
+    for(unsigned int mode_index = 0; mode_index < num_modes; mode_index++)
     {
         mode_name_len[mode_index]   = strlen(modes[mode_index].name.c_str()) + 1;
         mode_num_colors[mode_index] = modes[mode_index].colors.size();
@@ -110,13 +267,13 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
         }
         data_size += sizeof(modes[mode_index].direction);
         data_size += sizeof(modes[mode_index].color_mode);
-        data_size += sizeof(mode_num_colors[mode_index]);
+        data_size += count_size;
         data_size += (mode_num_colors[mode_index] * sizeof(RGBColor));
     }
 
-    data_size += sizeof(num_zones);
+    data_size += count_size;
 
-    for(int zone_index = 0; zone_index < num_zones; zone_index++)
+    for(unsigned int zone_index = 0; zone_index < num_zones; zone_index++)
     {
         zone_name_len[zone_index]   = strlen(zones[zone_index].name.c_str()) + 1;
         
@@ -135,7 +292,16 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
             zone_matrix_len[zone_index] = (2 * sizeof(unsigned int)) + (zones[zone_index].matrix_map->height * zones[zone_index].matrix_map->width * sizeof(unsigned int));
         }
 
-        data_size += sizeof(zone_matrix_len[zone_index]);
+        /*---------------------------------------------------------*\
+        | Older protocols can't describe matrices this large, so    |
+        | leave the matrix out rather than send a truncated size    |
+        \*---------------------------------------------------------*/
+        if((protocol_version < 8) && (zone_matrix_len[zone_index] > 0xFFFF))
+        {
+            zone_matrix_len[zone_index] = 0;
+        }
+
+        data_size += count_size;
         data_size += zone_matrix_len[zone_index];
 
         if(protocol_version >= 4)
@@ -143,7 +309,7 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
             /*---------------------------------------------------------*\
             | Number of segments in zone                                |
             \*---------------------------------------------------------*/
-            data_size += sizeof(unsigned short);
+            data_size += count_size;
 
             for(int segment_index = 0; segment_index < zones[zone_index].segments.size(); segment_index++)
             {
@@ -164,9 +330,9 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
         }
     }
 
-    data_size += sizeof(num_leds);
+    data_size += count_size;
 
-    for(int led_index = 0; led_index < num_leds; led_index++)
+    for(unsigned int led_index = 0; led_index < num_leds; led_index++)
     {
         led_name_len[led_index] = strlen(leds[led_index].name.c_str()) + 1;
 
@@ -175,19 +341,11 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
         data_size += sizeof(leds[led_index].value);
     }
 
-    data_size += sizeof(num_colors);
-    data_size += num_colors * sizeof(RGBColor);
-
     /*---------------------------------------------------------*\
     | Create data buffer                                        |
     \*---------------------------------------------------------*/
-    unsigned char *data_buf = new unsigned char[data_size];
-
-    /*---------------------------------------------------------*\
-    | Copy in data size                                         |
-    \*---------------------------------------------------------*/
-    memcpy(&data_buf[data_ptr], &data_size, sizeof(data_size));
-    data_ptr += sizeof(data_size);
+    std::vector<unsigned char> data(data_size);
+    unsigned char *data_buf = data.data();
 
     /*---------------------------------------------------------*\
     | Copy in type                                              |
@@ -255,8 +413,7 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
     /*---------------------------------------------------------*\
     | Copy in number of modes (data)                            |
     \*---------------------------------------------------------*/
-    memcpy(&data_buf[data_ptr], &num_modes, sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    WriteDescriptionCount(data_buf, data_ptr, num_modes, protocol_version);
 
     /*---------------------------------------------------------*\
     | Copy in active mode (data)                                |
@@ -267,7 +424,7 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
     /*---------------------------------------------------------*\
     | Copy in modes                                             |
     \*---------------------------------------------------------*/
-    for(int mode_index = 0; mode_index < num_modes; mode_index++)
+    for(unsigned int mode_index = 0; mode_index < num_modes; mode_index++)
     {
         /*---------------------------------------------------------*\
         | Copy in mode name (size+data)                             |
@@ -357,13 +514,12 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
         /*---------------------------------------------------------*\
         | Copy in mode number of colors                             |
         \*---------------------------------------------------------*/
-        memcpy(&data_buf[data_ptr], &mode_num_colors[mode_index], sizeof(unsigned short));
-        data_ptr += sizeof(unsigned short);
+        WriteDescriptionCount(data_buf, data_ptr, mode_num_colors[mode_index], protocol_version);
 
         /*---------------------------------------------------------*\
         | Copy in mode mode colors                                  |
         \*---------------------------------------------------------*/
-        for(int color_index = 0; color_index < mode_num_colors[mode_index]; color_index++)
+        for(unsigned int color_index = 0; color_index < mode_num_colors[mode_index]; color_index++)
         {
             /*---------------------------------------------------------*\
             | Copy in color (data)                                      |
@@ -376,14 +532,25 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
     /*---------------------------------------------------------*\
     | Copy in number of zones (data)                            |
     \*---------------------------------------------------------*/
-    memcpy(&data_buf[data_ptr], &num_zones, sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    WriteDescriptionCount(data_buf, data_ptr, num_zones, protocol_version);
 
     /*---------------------------------------------------------*\
-    | Copy in zones                                             |
+    | Copy in zones.  Older protocols only get the first 65535  |
+    | LEDs, so zone sizes are cut down to fit in that many.     |
     \*---------------------------------------------------------*/
-    for(int zone_index = 0; zone_index < num_zones; zone_index++)
+    unsigned int zone_leds_total = 0;
+
+    for(unsigned int zone_index = 0; zone_index < num_zones; zone_index++)
     {
+        unsigned int zone_leds_count = zones[zone_index].leds_count;
+
+        if(protocol_version < 8)
+        {
+            zone_leds_count = std::min(zone_leds_count, num_leds - zone_leds_total);
+        }
+
+        zone_leds_total += zone_leds_count;
+
         /*---------------------------------------------------------*\
         | Copy in zone name (size+data)                             |
         \*---------------------------------------------------------*/
@@ -414,14 +581,13 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
         /*---------------------------------------------------------*\
         | Copy in zone LED count (data)                             |
         \*---------------------------------------------------------*/
-        memcpy(&data_buf[data_ptr], &zones[zone_index].leds_count, sizeof(zones[zone_index].leds_count));
-        data_ptr += sizeof(zones[zone_index].leds_count);
+        memcpy(&data_buf[data_ptr], &zone_leds_count, sizeof(zone_leds_count));
+        data_ptr += sizeof(zone_leds_count);
 
         /*---------------------------------------------------------*\
         | Copy in size of zone matrix                               |
         \*---------------------------------------------------------*/
-        memcpy(&data_buf[data_ptr], &zone_matrix_len[zone_index], sizeof(zone_matrix_len[zone_index]));
-        data_ptr += sizeof(zone_matrix_len[zone_index]);
+        WriteDescriptionCount(data_buf, data_ptr, zone_matrix_len[zone_index], protocol_version);
 
         /*---------------------------------------------------------*\
         | Copy in matrix data if size is nonzero                    |
@@ -455,15 +621,19 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
         \*---------------------------------------------------------*/
         if(protocol_version >= 4)
         {
-            unsigned short num_segments = zones[zone_index].segments.size();
+            unsigned int num_segments = zones[zone_index].segments.size();
+
+            if(protocol_version < 8)
+            {
+                num_segments = ClampDescriptionCount(num_segments, protocol_version);
+            }
 
             /*---------------------------------------------------------*\
             | Number of segments in zone                                |
             \*---------------------------------------------------------*/
-            memcpy(&data_buf[data_ptr], &num_segments, sizeof(num_segments));
-            data_ptr += sizeof(num_segments);
+            WriteDescriptionCount(data_buf, data_ptr, num_segments, protocol_version);
 
-            for(int segment_index = 0; segment_index < num_segments; segment_index++)
+            for(unsigned int segment_index = 0; segment_index < num_segments; segment_index++)
             {
                 /*---------------------------------------------------------*\
                 | Length of segment name string                             |
@@ -503,13 +673,12 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
     /*---------------------------------------------------------*\
     | Copy in number of LEDs (data)                             |
     \*---------------------------------------------------------*/
-    memcpy(&data_buf[data_ptr], &num_leds, sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    WriteDescriptionCount(data_buf, data_ptr, num_leds, protocol_version);
 
     /*---------------------------------------------------------*\
     | Copy in LEDs                                              |
     \*---------------------------------------------------------*/
-    for(int led_index = 0; led_index < num_leds; led_index++)
+    for(unsigned int led_index = 0; led_index < num_leds; led_index++)
     {
         /*---------------------------------------------------------*\
         | Copy in LED name (size+data)                              |
@@ -528,24 +697,6 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
         data_ptr += sizeof(leds[led_index].value);
     }
 
-    /*---------------------------------------------------------*\
-    | Copy in number of colors (data)                           |
-    \*---------------------------------------------------------*/
-    memcpy(&data_buf[data_ptr], &num_colors, sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
-
-    /*---------------------------------------------------------*\
-    | Copy in colors                                            |
-    \*---------------------------------------------------------*/
-    for(int color_index = 0; color_index < num_colors; color_index++)
-    {
-        /*---------------------------------------------------------*\
-        | Copy in color (data)                                      |
-        \*---------------------------------------------------------*/
-        memcpy(&data_buf[data_ptr], &colors[color_index], sizeof(colors[color_index]));
-        data_ptr += sizeof(colors[color_index]);
-    }
-
     delete[] mode_name_len;
     delete[] zone_name_len;
     delete[] led_name_len;
@@ -553,7 +704,7 @@ unsigned char * RGBController::GetDeviceDescription(unsigned int protocol_versio
     delete[] zone_matrix_len;
     delete[] mode_num_colors;
 
-    return(data_buf);
+    return(data);
 }
 
 void RGBController::ReadDeviceDescription(unsigned char* data_buf, unsigned int protocol_version)
@@ -634,9 +785,7 @@ void RGBController::ReadDeviceDescription(unsigned char* data_buf, unsigned int
     /*---------------------------------------------------------*\
     | Copy in number of modes (data)                            |
     \*---------------------------------------------------------*/
-    unsigned short num_modes;
-    memcpy(&num_modes, &data_buf[data_ptr], sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    unsigned int num_modes = ReadDescriptionCount(data_buf, data_ptr, protocol_version);
 
     /*---------------------------------------------------------*\
     | Copy in active mode (data)                                |
@@ -647,7 +796,7 @@ void RGBController::ReadDeviceDescription(unsigned char* data_buf, unsigned int
     /*---------------------------------------------------------*\
     | Copy in modes                                             |
     \*---------------------------------------------------------*/
-    for(int mode_index = 0; mode_index < num_modes; mode_index++)
+    for(unsigned int mode_index = 0; mode_index < num_modes; mode_index++)
     {
         mode new_mode;
 
@@ -740,14 +889,12 @@ void RGBController::ReadDeviceDescription(unsigned char* data_buf, unsigned int
         /*---------------------------------------------------------*\
         | Copy in mode number of colors                             |
         \*---------------------------------------------------------*/
-        unsigned short mode_num_colors;
-        memcpy(&mode_num_colors, &data_buf[data_ptr], sizeof(unsigned short));
-        data_ptr += sizeof(unsigned short);
+        unsigned int mode_num_colors = ReadDescriptionCount(data_buf, data_ptr, protocol_version);
 
         /*---------------------------------------------------------*\
         | Copy in mode mode colors                                  |
         \*---------------------------------------------------------*/
-        for(int color_index = 0; color_index < mode_num_colors; color_index++)
+        for(unsigned int color_index = 0; color_index < mode_num_colors; color_index++)
         {
             /*---------------------------------------------------------*\
             | Copy in color (data)                                      |
@@ -765,14 +912,12 @@ void RGBController::ReadDeviceDescription(unsigned char* data_buf, unsigned int
     /*---------------------------------------------------------*\
     | Copy in number of zones (data)                            |
     \*---------------------------------------------------------*/
-    unsigned short num_zones;
-    memcpy(&num_zones, &data_buf[data_ptr], sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    unsigned int num_zones = ReadDescriptionCount(data_buf, data_ptr, protocol_version);
 
     /*---------------------------------------------------------*\
     | Copy in zones                                             |
     \*---------------------------------------------------------*/
-    for(int zone_index = 0; zone_index < num_zones; zone_index++)
+    for(unsigned int zone_index = 0; zone_index < num_zones; zone_index++)
     {
         zone new_zone;
 
@@ -813,9 +958,7 @@ void RGBController::ReadDeviceDescription(unsigned char* data_buf, unsigned int
         /*---------------------------------------------------------*\
         | Copy in size of zone matrix                               |
         \*---------------------------------------------------------*/
-        unsigned short zone_matrix_len;
-        memcpy(&zone_matrix_len, &data_buf[data_ptr], sizeof(zone_matrix_len));
-        data_ptr += sizeof(zone_matrix_len);
+        unsigned int zone_matrix_len = ReadDescriptionCount(data_buf, data_ptr, protocol_version);
 
         /*---------------------------------------------------------*\
         | Copy in matrix data if size is nonzero                    |
@@ -863,15 +1006,12 @@ void RGBController::ReadDeviceDescription(unsigned char* data_buf, unsigned int
         \*---------------------------------------------------------*/
         if(protocol_version >= 4)
         {
-            unsigned short num_segments = 0;
-
             /*---------------------------------------------------------*\
             | Number of segments in zone                                |
             \*---------------------------------------------------------*/
-            memcpy(&num_segments, &data_buf[data_ptr], sizeof(num_segments));
-            data_ptr += sizeof(num_segments);
+            unsigned int num_segments = ReadDescriptionCount(data_buf, data_ptr, protocol_version);
 
-            for(int segment_index = 0; segment_index < num_segments; segment_index++)
+            for(unsigned int segment_index = 0; segment_index < num_segments; segment_index++)
             {
                 segment new_segment;
 
@@ -912,14 +1052,12 @@ void RGBController::ReadDeviceDescription(unsigned char* data_buf, unsigned int
     /*---------------------------------------------------------*\
     | Copy in number of LEDs (data)                             |
     \*---------------------------------------------------------*/
-    unsigned short num_leds;
-    memcpy(&num_leds, &data_buf[data_ptr], sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    unsigned int num_leds = ReadDescriptionCount(data_buf, data_ptr, protocol_version);
 
     /*---------------------------------------------------------*\
     | Copy in LEDs                                              |
     \*---------------------------------------------------------*/
-    for(int led_index = 0; led_index < num_leds; led_index++)
+    for(unsigned int led_index = 0; led_index < num_leds; led_index++)
     {
         led new_led;
 
@@ -945,14 +1083,12 @@ void RGBController::ReadDeviceDescription(unsigned char* data_buf, unsigned int
     /*---------------------------------------------------------*\
     | Copy in number of colors (data)                           |
     \*---------------------------------------------------------*/
-    unsigned short num_colors;
-    memcpy(&num_colors, &data_buf[data_ptr], sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    unsigned int num_colors = ReadDescriptionCount(data_buf, data_ptr, protocol_version);
 
     /*---------------------------------------------------------*\
     | Copy in colors                                            |
     \*---------------------------------------------------------*/
-    for(int color_index = 0; color_index < num_colors; color_index++)
+    for(unsigned int color_index = 0; color_index < num_colors; color_index++)
     {
         RGBColor new_color;
 
@@ -977,7 +1113,7 @@ unsigned char * RGBController::GetModeDescription(int mode, unsigned int protoco
     unsigned int data_size = 0;
 
     unsigned short mode_name_len;
-    unsigned short mode_num_colors;
+    unsigned int   mode_num_colors;
 
     /*---------------------------------------------------------*\
     | Calculate data size                                       |
@@ -985,6 +1121,11 @@ unsigned char * RGBController::GetModeDescription(int mode, unsigned int protoco
     mode_name_len   = strlen(modes[mode].name.c_str()) + 1;
     mode_num_colors = modes[mode].colors.size();
 
+    if(protocol_version < 8)
+    {
+        mode_num_colors = ClampDescriptionCount(mode_num_colors, protocol_version);
+    }
+
     data_size += sizeof(data_size);
     data_size += sizeof(mode);
     data_size += sizeof(mode_name_len);
@@ -1007,7 +1148,7 @@ unsigned char * RGBController::GetModeDescription(int mode, unsigned int protoco
     }
     data_size += sizeof(modes[mode].direction);
     data_size += sizeof(modes[mode].color_mode);
-    data_size += sizeof(mode_num_colors);
+    data_size += DescriptionCountSize(protocol_version);
     data_size += (mode_num_colors * sizeof(RGBColor));
 
     /*---------------------------------------------------------*\
@@ -1115,13 +1256,12 @@ unsigned char * RGBController::GetModeDescription(int mode, unsigned int protoco
     /*---------------------------------------------------------*\
     | Copy in mode number of colors                             |
     \*---------------------------------------------------------*/
-    memcpy(&data_buf[data_ptr], &mode_num_colors, sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    WriteDescriptionCount(data_buf, data_ptr, mode_num_colors, protocol_version);
 
     /*---------------------------------------------------------*\
     | Copy in mode mode colors                                  |
     \*---------------------------------------------------------*/
-    for(int color_index = 0; color_index < mode_num_colors; color_index++)
+    for(unsigned int color_index = 0; color_index < mode_num_colors; color_index++)
     {
         /*---------------------------------------------------------*\
         | Copy in color (data)                                      |
@@ -1133,11 +1273,16 @@ unsigned char * RGBController::GetModeDescription(int mode, unsigned int protoco
     return(data_buf);
 }
 
-void RGBController::SetModeDescription(unsigned char* data_buf, unsigned int protocol_version)
+void RGBController::SetModeDescription(unsigned char* data_buf, unsigned int protocol_version, unsigned int data_size)
 {
     int mode_idx;
     unsigned int data_ptr = sizeof(unsigned int);
 
+    if(data_size < (data_ptr + sizeof(int) + sizeof(unsigned short)))
+    {
+        return;
+    }
+
     /*---------------------------------------------------------*\
     | Copy in mode index                                        |
     \*---------------------------------------------------------*/
@@ -1147,16 +1292,50 @@ void RGBController::SetModeDescription(unsigned char* data_buf, unsigned int pro
     /*---------------------------------------------------------*\
     | Check if we aren't reading beyond the list of modes.      |
     \*---------------------------------------------------------*/
-    if(((size_t) mode_idx) >  modes.size())
+    if((mode_idx < 0) || (((size_t) mode_idx) >= modes.size()))
     {
         return;
     }
 
     /*---------------------------------------------------------*\
-    | Get pointer to target mode                                |
+    | Check that the whole description fits in the buffer       |
+    | before changing anything                                  |
     \*---------------------------------------------------------*/
-    mode * new_mode = &modes[mode_idx];
-    
+    unsigned short modename_len;
+    memcpy(&modename_len, &data_buf[data_ptr], sizeof(unsigned short));
+
+    mode *       new_mode   = &modes[mode_idx];
+    unsigned int fixed_size = sizeof(new_mode->value)
+                            + sizeof(new_mode->flags)
+                            + sizeof(new_mode->speed_min)
+                            + sizeof(new_mode->speed_max)
+                            + sizeof(new_mode->colors_min)
+                            + sizeof(new_mode->colors_max)
+                            + sizeof(new_mode->speed)
+                            + sizeof(new_mode->direction)
+                            + sizeof(new_mode->color_mode);
+
+    if(protocol_version >= 3)
+    {
+        fixed_size += sizeof(new_mode->brightness_min)
+                    + sizeof(new_mode->brightness_max)
+                    + sizeof(new_mode->brightness);
+    }
+
+    unsigned int count_ptr  = data_ptr + sizeof(unsigned short) + modename_len + fixed_size;
+
+    if(data_size < (count_ptr + DescriptionCountSize(protocol_version)))
+    {
+        return;
+    }
+
+    unsigned int check_num_colors = ReadDescriptionCount(data_buf, count_ptr, protocol_version);
+
+    if((((size_t) check_num_colors) * sizeof(RGBColor)) > (data_size - count_ptr))
+    {
+        return;
+    }
+
     /*---------------------------------------------------------*\
     | Set active mode to the new mode                           |
     \*---------------------------------------------------------*/
@@ -1165,11 +1344,9 @@ void RGBController::SetModeDescription(unsigned char* data_buf, unsigned int pro
     /*---------------------------------------------------------*\
     | Copy in mode name (size+data)                             |
     \*---------------------------------------------------------*/
-    unsigned short modename_len;
-    memcpy(&modename_len, &data_buf[data_ptr], sizeof(unsigned short));
     data_ptr += sizeof(unsigned short);
 
-    new_mode->name = (char *)&data_buf[data_ptr];
+    new_mode->name = std::string((char *)&data_buf[data_ptr], strnlen((char *)&data_buf[data_ptr], modename_len));
     data_ptr += modename_len;
 
     /*---------------------------------------------------------*\
@@ -1251,15 +1428,13 @@ void RGBController::SetModeDescription(unsigned char* data_buf, unsigned int pro
     /*---------------------------------------------------------*\
     | Copy in mode number of colors                             |
     \*---------------------------------------------------------*/
-    unsigned short mode_num_colors;
-    memcpy(&mode_num_colors, &data_buf[data_ptr], sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    unsigned int mode_num_colors = ReadDescriptionCount(data_buf, data_ptr, protocol_version);
 
     /*---------------------------------------------------------*\
     | Copy in mode mode colors                                  |
     \*---------------------------------------------------------*/
     new_mode->colors.clear();
-    for(int color_index = 0; color_index < mode_num_colors; color_index++)
+    for(unsigned int color_index = 0; color_index < mode_num_colors; color_index++)
     {
         /*---------------------------------------------------------*\
         | Copy in color (data)                                      |
@@ -1270,20 +1445,27 @@ void RGBController::SetModeDescription(unsigned char* data_buf, unsigned int pro
 
         new_mode->colors.push_back(new_color);
     }
+
+    IncrementRevision();
 }
 
-unsigned char * RGBController::GetColorDescription()
+unsigned char * RGBController::GetColorDescription(unsigned int protocol_version)
 {
     unsigned int data_ptr = 0;
     unsigned int data_size = 0;
 
-    unsigned short num_colors = colors.size();
+    unsigned int num_colors = colors.size();
+
+    if(protocol_version < 8)
+    {
+        num_colors = ClampDescriptionCount(num_colors, protocol_version);
+    }
 
     /*---------------------------------------------------------*\
     | Calculate data size                                       |
     \*---------------------------------------------------------*/
     data_size += sizeof(data_size);
-    data_size += sizeof(num_colors);
+    data_size += DescriptionCountSize(protocol_version);
     data_size += num_colors * sizeof(RGBColor);
 
     /*---------------------------------------------------------*\
@@ -1300,13 +1482,12 @@ unsigned char * RGBController::GetColorDescription()
     /*---------------------------------------------------------*\
     | Copy in number of colors (data)                           |
     \*---------------------------------------------------------*/
-    memcpy(&data_buf[data_ptr], &num_colors, sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    WriteDescriptionCount(data_buf, data_ptr, num_colors, protocol_version);
 
     /*---------------------------------------------------------*\
     | Copy in colors                                            |
     \*---------------------------------------------------------*/
-    for(int color_index = 0; color_index < num_colors; color_index++)
+    for(unsigned int color_index = 0; color_index < num_colors; color_index++)
     {
         /*---------------------------------------------------------*\
         | Copy in color (data)                                      |
@@ -1318,21 +1499,26 @@ unsigned char * RGBController::GetColorDescription()
     return(data_buf);
 }
 
-void RGBController::SetColorDescription(unsigned char* data_buf)
+void RGBController::SetColorDescription(unsigned char* data_buf, unsigned int protocol_version, unsigned int data_size)
 {
     unsigned int data_ptr = sizeof(unsigned int);
 
+    if(data_size < (data_ptr + DescriptionCountSize(protocol_version)))
+    {
+        return;
+    }
+
     /*---------------------------------------------------------*\
     | Copy in number of colors (data)                           |
     \*---------------------------------------------------------*/
-    unsigned short num_colors;
-    memcpy(&num_colors, &data_buf[data_ptr], sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    unsigned int num_colors = ReadDescriptionCount(data_buf, data_ptr, protocol_version);
 
     /*---------------------------------------------------------*\
-    | Check if we aren't reading beyond the list of colors.     |
+    | Check if we aren't reading beyond the list of colors or   |
+    | the end of the buffer.                                    |
     \*---------------------------------------------------------*/
-    if(((size_t) num_colors) > colors.size())
+    if((((size_t) num_colors) > colors.size())
+    || ((((size_t) num_colors) * sizeof(RGBColor)) > (data_size - data_ptr)))
     {
         return;
     }
@@ -1340,7 +1526,7 @@ void RGBController::SetColorDescription(unsigned char* data_buf)
     /*---------------------------------------------------------*\
     | Copy in colors                                            |
     \*---------------------------------------------------------*/
-    for(int color_index = 0; color_index < num_colors; color_index++)
+    for(unsigned int color_index = 0; color_index < num_colors; color_index++)
     {
         RGBColor new_color;
 
@@ -1354,19 +1540,24 @@ void RGBController::SetColorDescription(unsigned char* data_buf)
     }
 }
 
-unsigned char * RGBController::GetZoneColorDescription(int zone)
+unsigned char * RGBController::GetZoneColorDescription(int zone, unsigned int protocol_version)
 {
     unsigned int data_ptr = 0;
     unsigned int data_size = 0;
 
-    unsigned short num_colors = zones[zone].leds_count;
+    unsigned int num_colors = zones[zone].leds_count;
+
+    if(protocol_version < 8)
+    {
+        num_colors = ClampDescriptionCount(num_colors, protocol_version);
+    }
 
     /*---------------------------------------------------------*\
     | Calculate data size                                       |
     \*---------------------------------------------------------*/
     data_size += sizeof(data_size);
     data_size += sizeof(zone);
-    data_size += sizeof(num_colors);
+    data_size += DescriptionCountSize(protocol_version);
     data_size += num_colors * sizeof(RGBColor);
 
     /*---------------------------------------------------------*\
@@ -1389,13 +1580,12 @@ unsigned char * RGBController::GetZoneColorDescription(int zone)
     /*---------------------------------------------------------*\
     | Copy in number of colors (data)                           |
     \*---------------------------------------------------------*/
-    memcpy(&data_buf[data_ptr], &num_colors, sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    WriteDescriptionCount(data_buf, data_ptr, num_colors, protocol_version);
 
     /*---------------------------------------------------------*\
     | Copy in colors                                            |
     \*---------------------------------------------------------*/
-    for(int color_index = 0; color_index < num_colors; color_index++)
+    for(unsigned int color_index = 0; color_index < num_colors; color_index++)
     {
         /*---------------------------------------------------------*\
         | Copy in color (data)                                      |
@@ -1407,11 +1597,16 @@ unsigned char * RGBController::GetZoneColorDescription(int zone)
     return(data_buf);
 }
 
-void RGBController::SetZoneColorDescription(unsigned char* data_buf)
+void RGBController::SetZoneColorDescription(unsigned char* data_buf, unsigned int protocol_version, unsigned int data_size)
 {
     unsigned int data_ptr = sizeof(unsigned int);
     unsigned int zone_idx;
 
+    if(data_size < (data_ptr + sizeof(zone_idx) + DescriptionCountSize(protocol_version)))
+    {
+        return;
+    }
+
     /*---------------------------------------------------------*\
     | Copy in zone index                                        |
     \*---------------------------------------------------------*/
@@ -1421,7 +1616,7 @@ void RGBController::SetZoneColorDescription(unsigned char* data_buf)
     /*---------------------------------------------------------*\
     | Check if we aren't reading beyond the list of zones.      |
     \*---------------------------------------------------------*/
-    if(((size_t) zone_idx) > zones.size())
+    if(((size_t) zone_idx) >= zones.size())
     {
         return;
     }
@@ -1429,14 +1624,22 @@ void RGBController::SetZoneColorDescription(unsigned char* data_buf)
     /*---------------------------------------------------------*\
     | Copy in number of colors (data)                           |
     \*---------------------------------------------------------*/
-    unsigned short num_colors;
-    memcpy(&num_colors, &data_buf[data_ptr], sizeof(unsigned short));
-    data_ptr += sizeof(unsigned short);
+    unsigned int num_colors = ReadDescriptionCount(data_buf, data_ptr, protocol_version);
+
+    /*---------------------------------------------------------*\
+    | Check if we aren't writing beyond the zone's colors or    |
+    | reading beyond the end of the buffer.                     |
+    \*---------------------------------------------------------*/
+    if((num_colors > zones[zone_idx].leds_count)
+    || ((((size_t) num_colors) * sizeof(RGBColor)) > (data_size - data_ptr)))
+    {
+        return;
+    }
 
     /*---------------------------------------------------------*\
     | Copy in colors                                            |
     \*---------------------------------------------------------*/
-    for(int color_index = 0; color_index < num_colors; color_index++)
+    for(unsigned int color_index = 0; color_index < num_colors; color_index++)
     {
         RGBColor new_color;
 
@@ -1549,6 +1752,11 @@ void RGBController::SetupColors()
 
         total_led_count += zones[zone_idx].leds_count;
     }
+
+    /*---------------------------------------------------------*\
+    | The zone layout may have changed                          |
+    \*---------------------------------------------------------*/
+    IncrementRevision();
 }
 
 RGBColor RGBController::GetLED(unsigned int led)
@@ -1601,12 +1809,16 @@ void RGBController::SetMode(int mode)
 
 void RGBController::RegisterUpdateCallback(RGBControllerCallback new_callback, void * new_callback_arg)
 {
+    UpdateMutex.lock();
     UpdateCallbacks.push_back(new_callback);
     UpdateCallbackArgs.push_back(new_callback_arg);
+    UpdateMutex.unlock();
 }
 
 void RGBController::UnregisterUpdateCallback(void * callback_arg)
 {
+    std::unique_lock<std::mutex> lock(UpdateMutex);
+
     for(unsigned int callback_idx = 0; callback_idx < UpdateCallbackArgs.size(); callback_idx++ )
     {
         if(UpdateCallbackArgs[callback_idx] == callback_arg)
@@ -1617,38 +1829,139 @@ void RGBController::UnregisterUpdateCallback(void * callback_arg)
             break;
         }
     }
+
+    WaitForUpdateCallbacks(lock);
 }
 
 void RGBController::ClearCallbacks()
 {
+    std::unique_lock<std::mutex> lock(UpdateMutex);
+
     UpdateCallbacks.clear();
     UpdateCallbackArgs.clear();
+
+    WaitForUpdateCallbacks(lock);
+}
+
+void RGBController::WaitForUpdateCallbacks(std::unique_lock<std::mutex>& lock)
+{
+    /*-------------------------------------------------*\
+    | Callbacks run outside the lock, so wait for the   |
+    | calls that may still use a removed callback to    |
+    | finish before the caller frees its argument.      |
+    | Calls started after the removal do not have it.   |
+    \*-------------------------------------------------*/
+    unsigned long long  removed_at  = UpdateCallbackNextCall;
+    std::thread::id     this_thread = std::this_thread::get_id();
+
+    /*-------------------------------------------------*\
+    | A callback removing itself or another callback    |
+    | does not wait, as calls on other threads may be   |
+    | waiting on this one in turn                       |
+    \*-------------------------------------------------*/
+    for(std::map<unsigned long long, std::thread::id>::iterator it = UpdateCallbackCalls.begin(); it != UpdateCallbackCalls.end(); it++)
+    {
+        if(it->second == this_thread)
+        {
+            return;
+        }
+    }
+
+    UpdateCallbackCV.wait(lock, [this, removed_at]
+    {
+        return(UpdateCallbackCalls.empty() || (UpdateCallbackCalls.begin()->first >= removed_at));
+    });
 }
 
 void RGBController::SignalUpdate()
 {
+    /*-------------------------------------------------*\
+    | Take a copy of the callback list and call it with |
+    | the lock released, so a slow callback does not    |
+    | block other threads signalling this controller    |
+    \*-------------------------------------------------*/
     UpdateMutex.lock();
 
+    if(UpdateCallbacks.empty())
+    {
+        UpdateMutex.unlock();
+        return;
+    }
+
+    std::vector<RGBControllerCallback>  callbacks       = UpdateCallbacks;
+    std::vector<void *>                 callback_args   = UpdateCallbackArgs;
+    unsigned long long                  call            = UpdateCallbackNextCall++;
+
+    UpdateCallbackCalls[call] = std::this_thread::get_id();
+    UpdateMutex.unlock();
+
     /*-------------------------------------------------*\
     | Client info has changed, call the callbacks       |
     \*-------------------------------------------------*/
-    for(unsigned int callback_idx = 0; callback_idx < UpdateCallbacks.size(); callback_idx++)
+    for(unsigned int callback_idx = 0; callback_idx < callbacks.size(); callback_idx++)
     {
-        UpdateCallbacks[callback_idx](UpdateCallbackArgs[callback_idx]);
+        callbacks[callback_idx](callback_args[callback_idx]);
     }
 
+    UpdateMutex.lock();
+    UpdateCallbackCalls.erase(call);
     UpdateMutex.unlock();
+
+    UpdateCallbackCV.notify_all();
 }
+
 void RGBController::UpdateLEDs()
 {
+    CallFlagMutex.lock();
+
+    /*-------------------------------------------------*\
+    | Only the first request of a burst sets the time,  |
+    | later requests coalesce into the same update      |
+    \*-------------------------------------------------*/
+    if(!CallFlag_UpdateLEDs)
+    {
+        UpdateRequestTime = std::chrono::steady_clock::now();
+    }
+
     CallFlag_UpdateLEDs = true;
 
+    CallFlagMutex.unlock();
+    CallFlagCV.notify_one();
+
     SignalUpdate();
 }
 
 void RGBController::UpdateMode()
 {
+    CallFlagMutex.lock();
     CallFlag_UpdateMode = true;
+
+    /*-------------------------------------------------*\
+    | A mode change may reset the device's colors, so   |
+    | force the next LED update to be a full update     |
+    \*-------------------------------------------------*/
+    FlushedColors.clear();
+
+    /*-------------------------------------------------*\
+    | While updates are held, bump the revision once    |
+    | when they are released rather than for every      |
+    | mode update in between                            |
+    \*-------------------------------------------------*/
+    bool held = (UpdateHoldCount > 0);
+
+    if(held)
+    {
+        RevisionPending = true;
+    }
+
+    CallFlagMutex.unlock();
+
+    CallFlagCV.notify_one();
+
+    if(!held)
+    {
+        IncrementRevision();
+    }
 }
 
 void RGBController::SaveMode()
@@ -1688,6 +2001,7 @@ void RGBController::SetCustomMode()
              || (modes[mode_idx].color_mode == MODE_COLORS_MODE_SPECIFIC)))
             {
                 active_mode = mode_idx;
+                IncrementRevision();
                 return;
             }
         }
@@ -1701,26 +2015,264 @@ void RGBController::DeviceUpdateMode()
 
 void RGBController::DeviceCallThreadFunction()
 {
-    CallFlag_UpdateLEDs = false;
-    CallFlag_UpdateMode = false;
+    std::unique_lock<std::mutex> lock(CallFlagMutex);
 
     while(DeviceThreadRunning.load() == true)
     {
+        /*-------------------------------------------------*\
+        | Sleep until an update is requested or the         |
+        | controller is being destroyed                     |
+        \*-------------------------------------------------*/
+        CallFlagCV.wait(lock, [this]
+        {
+            return(!DeviceThreadRunning.load() || ((UpdateHoldCount == 0) && (CallFlag_UpdateMode.load() || CallFlag_UpdateLEDs.load())));
+        });
+
+        if(DeviceThreadRunning.load() == false)
+        {
+            break;
+        }
+
+        /*-------------------------------------------------*\
+        | If released from a hold, wait for the common      |
+        | release time.  Going back to sleep on a new hold  |
+        | keeps the queued flags for the next release.      |
+        \*-------------------------------------------------*/
+        if(UpdateReleaseTime > std::chrono::steady_clock::now())
+        {
+            CallFlagCV.wait_until(lock, UpdateReleaseTime, [this]
+            {
+                return(!DeviceThreadRunning.load() || (UpdateHoldCount > 0));
+            });
+
+            if(DeviceThreadRunning.load() == false)
+            {
+                break;
+            }
+
+            if(UpdateHoldCount > 0)
+            {
+                continue;
+            }
+        }
+
+        /*-------------------------------------------------*\
+        | Flags are cleared before calling into the device  |
+        | so that requests made during the call are not     |
+        | lost                                              |
+        \*-------------------------------------------------*/
         if(CallFlag_UpdateMode.load() == true)
         {
-            DeviceUpdateMode();
             CallFlag_UpdateMode = false;
+
+            lock.unlock();
+            DeviceUpdateMode();
+            lock.lock();
         }
+
         if(CallFlag_UpdateLEDs.load() == true)
         {
-            DeviceUpdateLEDs();
+            /*---------------------------------------------*\
+            | If a rate limit is set, hold off until the    |
+            | frame interval has elapsed.  Requests that    |
+            | arrive meanwhile coalesce into this update.   |
+            \*---------------------------------------------*/
+            if(UpdateInterval.count() > 0)
+            {
+                CallFlagCV.wait_until(lock, LastUpdateTime + UpdateInterval, [this]
+                {
+                    return(!DeviceThreadRunning.load());
+                });
+
+                if(DeviceThreadRunning.load() == false)
+                {
+                    break;
+                }
+            }
+
             CallFlag_UpdateLEDs = false;
+
+            LastUpdateTime      = std::chrono::steady_clock::now();
+
+            LOG_TRACE("[%s] Update latency %lld us", name.c_str(), (long long)std::chrono::duration_cast<std::chrono::microseconds>(LastUpdateTime - UpdateRequestTime).count());
+
+            lock.unlock();
+            FlushLEDs();
+            lock.lock();
         }
-        else
+    }
+}
+
+void RGBController::FlushLEDs()
+{
+    std::size_t     changed_count   = 0;
+    std::size_t     changed_led     = 0;
+    int             changed_zone    = -1;
+    bool            multiple_zones  = false;
+    bool            full_update     = false;
+
+    CallFlagMutex.lock();
+
+    if(!PartialUpdates || (FlushedColors.size() != colors.size()))
+    {
+        /*-------------------------------------------------*\
+        | No previous frame to compare against, do a full   |
+        | update                                            |
+        \*-------------------------------------------------*/
+        if(PartialUpdates)
         {
-           std::this_thread::sleep_for(1ms);
+            FlushedColors = colors;
         }
+
+        full_update = true;
+    }
+    else
+    {
+        /*-------------------------------------------------*\
+        | Find the changed LEDs and the zone(s) they are in |
+        \*-------------------------------------------------*/
+        for(std::size_t zone_idx = 0; zone_idx < zones.size(); zone_idx++)
+        {
+            unsigned int start  = zones[zone_idx].start_idx;
+            unsigned int end    = start + zones[zone_idx].leds_count;
+
+            for(std::size_t led_idx = start; (led_idx < end) && (led_idx < colors.size()); led_idx++)
+            {
+                if(colors[led_idx] != FlushedColors[led_idx])
+                {
+                    FlushedColors[led_idx] = colors[led_idx];
+
+                    if((changed_zone != -1) && (changed_zone != (int)zone_idx))
+                    {
+                        multiple_zones = true;
+                    }
+
+                    changed_zone = zone_idx;
+                    changed_led  = led_idx;
+                    changed_count++;
+                }
+            }
+        }
+    }
+
+    CallFlagMutex.unlock();
+
+    /*-------------------------------------------------*\
+    | Route the flush to the smallest update covering   |
+    | all of the changes                                |
+    \*-------------------------------------------------*/
+    if(full_update)
+    {
+        DeviceUpdateLEDs();
+    }
+    else if(changed_count == 0)
+    {
+        return;
+    }
+    else if(changed_count == 1)
+    {
+        UpdateSingleLED(changed_led);
+    }
+    else if(!multiple_zones && (zones.size() > 1))
+    {
+        UpdateZoneLEDs(changed_zone);
+    }
+    else
+    {
+        DeviceUpdateLEDs();
+    }
+}
+
+void RGBController::SetPartialUpdates(bool enable)
+{
+    CallFlagMutex.lock();
+    PartialUpdates = enable;
+    FlushedColors.clear();
+    CallFlagMutex.unlock();
+}
+
+void RGBController::HoldUpdates()
+{
+    CallFlagMutex.lock();
+    UpdateHoldCount++;
+    CallFlagMutex.unlock();
+}
+
+void RGBController::ReleaseUpdates(std::chrono::steady_clock::time_point release_time)
+{
+    CallFlagMutex.lock();
+
+    if(UpdateHoldCount > 0)
+    {
+        UpdateHoldCount--;
+    }
+
+    /*-------------------------------------------------*\
+    | With overlapping holds, flush at the latest of    |
+    | the requested release times                       |
+    \*-------------------------------------------------*/
+    if(release_time > UpdateReleaseTime)
+    {
+        UpdateReleaseTime = release_time;
+    }
+
+    bool revision_pending = (UpdateHoldCount == 0) && RevisionPending;
+
+    if(revision_pending)
+    {
+        RevisionPending = false;
+    }
+
+    CallFlagMutex.unlock();
+    CallFlagCV.notify_one();
+
+    if(revision_pending)
+    {
+        IncrementRevision();
+    }
+}
+
+unsigned int RGBController::GetID()
+{
+    return(ID);
+}
+
+unsigned int RGBController::GetRevision()
+{
+    return(Revision);
+}
+
+void RGBController::IncrementRevision()
+{
+    Revision++;
+}
+
+void RGBController::SetUpdateRateLimit(unsigned int max_fps)
+{
+    CallFlagMutex.lock();
+
+    if(max_fps == 0)
+    {
+        UpdateInterval = std::chrono::microseconds(0);
     }
+    else
+    {
+        UpdateInterval = std::chrono::microseconds(1000000 / max_fps);
+    }
+
+    CallFlagMutex.unlock();
+}
+
+unsigned int RGBController::GetUpdateRateLimit()
+{
+    std::lock_guard<std::mutex> lock(CallFlagMutex);
+
+    if(UpdateInterval.count() == 0)
+    {
+        return(0);
+    }
+
+    return(1000000 / UpdateInterval.count());
 }
 
 void RGBController::DeviceSaveMode()
@@ -10,11 +10,14 @@
 #pragma once
 
 #include <atomic>
+#include <map>
+#include <memory>
 #include <vector>
 #include <string>
 #include <thread>
 #include <chrono>
 #include <mutex>
+#include <condition_variable>
 
 /*------------------------------------------------------------------*\
 | RGB Color Type and Conversion Macros                               |
@@ -219,13 +222,13 @@ public:
     virtual void            ReadDeviceDescription(unsigned char* data_buf, unsigned int protocol_version)       = 0;
 
     virtual unsigned char * GetModeDescription(int mode, unsigned int protocol_version)                         = 0;
-    virtual void            SetModeDescription(unsigned char* data_buf, unsigned int protocol_version)          = 0;
+    virtual void            SetModeDescription(unsigned char* data_buf, unsigned int protocol_version, unsigned int data_size)      = 0;
 
-    virtual unsigned char * GetColorDescription()                                                               = 0;
-    virtual void            SetColorDescription(unsigned char* data_buf)                                        = 0;
+    virtual unsigned char * GetColorDescription(unsigned int protocol_version)                                  = 0;
+    virtual void            SetColorDescription(unsigned char* data_buf, unsigned int protocol_version, unsigned int data_size)     = 0;
 
-    virtual unsigned char * GetZoneColorDescription(int zone)                                                   = 0;
-    virtual void            SetZoneColorDescription(unsigned char* data_buf)                                    = 0;
+    virtual unsigned char * GetZoneColorDescription(int zone, unsigned int protocol_version)                    = 0;
+    virtual void            SetZoneColorDescription(unsigned char* data_buf, unsigned int protocol_version, unsigned int data_size) = 0;
 
     virtual unsigned char * GetSingleLEDColorDescription(int led)                                               = 0;
     virtual void            SetSingleLEDColorDescription(unsigned char* data_buf)                               = 0;
@@ -299,18 +302,32 @@ public:
     unsigned char *         GetDeviceDescription(unsigned int protocol_version);
     void                    ReadDeviceDescription(unsigned char* data_buf, unsigned int protocol_version);
 
+    /*---------------------------------------------------------*\
+    | Device description without the leading data size and the  |
+    | trailing colors.  It is built once per protocol version   |
+    | and revision, and the returned buffer is shared between   |
+    | callers, so it must not be modified.                      |
+    \*---------------------------------------------------------*/
+    std::shared_ptr<const std::vector<unsigned char>> GetDeviceDescriptionData(unsigned int protocol_version);
+
     unsigned char *         GetModeDescription(int mode, unsigned int protocol_version);
-    void                    SetModeDescription(unsigned char* data_buf, unsigned int protocol_version);
+    void                    SetModeDescription(unsigned char* data_buf, unsigned int protocol_version, unsigned int data_size);
 
-    unsigned char *         GetColorDescription();
-    void                    SetColorDescription(unsigned char* data_buf);
+    unsigned char *         GetColorDescription(unsigned int protocol_version);
+    void                    SetColorDescription(unsigned char* data_buf, unsigned int protocol_version, unsigned int data_size);
 
-    unsigned char *         GetZoneColorDescription(int zone);
-    void                    SetZoneColorDescription(unsigned char* data_buf);
+    unsigned char *         GetZoneColorDescription(int zone, unsigned int protocol_version);
+    void                    SetZoneColorDescription(unsigned char* data_buf, unsigned int protocol_version, unsigned int data_size);
 
     unsigned char *         GetSingleLEDColorDescription(int led);
     void                    SetSingleLEDColorDescription(unsigned char* data_buf);
 
+    /*---------------------------------------------------------*\
+    | Update callbacks are called outside of the callback lock. |
+    | UnregisterUpdateCallback and ClearCallbacks wait for any  |
+    | callbacks in progress, so they must not be called from   |
+    | inside an update callback.                                |
+    \*---------------------------------------------------------*/
     void                    RegisterUpdateCallback(RGBControllerCallback new_callback, void * new_callback_arg);
     void                    UnregisterUpdateCallback(void * callback_arg);
     void                    ClearCallbacks();
@@ -325,6 +342,40 @@ public:
 
     void                    DeviceCallThreadFunction();
 
+    /*---------------------------------------------------------*\
+    | Device update pacing and statistics                       |
+    \*---------------------------------------------------------*/
+    void                    SetUpdateRateLimit(unsigned int max_fps);
+    unsigned int            GetUpdateRateLimit();
+
+    /*---------------------------------------------------------*\
+    | Partial updates - when enabled, the device thread diffs   |
+    | the color buffer against the last flushed frame and calls |
+    | UpdateSingleLED/UpdateZoneLEDs if only a subset changed.  |
+    | Only enable for controllers whose partial update          |
+    | functions are cheaper than a full DeviceUpdateLEDs.       |
+    \*---------------------------------------------------------*/
+    void                    SetPartialUpdates(bool enable);
+
+    /*---------------------------------------------------------*\
+    | Update holds - while held, UpdateLEDs and UpdateMode only |
+    | queue their flags.  On release the device thread waits    |
+    | for release_time before flushing, so several controllers  |
+    | released with the same time flush together.  Holds nest.  |
+    \*---------------------------------------------------------*/
+    void                    HoldUpdates();
+    void                    ReleaseUpdates(std::chrono::steady_clock::time_point release_time);
+
+    /*---------------------------------------------------------*\
+    | Controller ID and description revision.  The ID is unique |
+    | for the lifetime of the process.  The revision changes    |
+    | when the zones or the active mode change, so SDK clients  |
+    | can tell which descriptions they need to download again.  |
+    \*---------------------------------------------------------*/
+    unsigned int            GetID();
+    unsigned int            GetRevision();
+    void                    IncrementRevision();
+
     /*---------------------------------------------------------*\
     | Functions to be implemented in device implementation      |
     \*---------------------------------------------------------*/
@@ -346,11 +397,49 @@ private:
     std::atomic<bool>       CallFlag_UpdateLEDs;
     std::atomic<bool>       CallFlag_UpdateMode;
     std::atomic<bool>       DeviceThreadRunning;
+
+    /*---------------------------------------------------------*\
+    | The device thread sleeps on CallFlagCV until one of the   |
+    | call flags is set, so idle controllers cost no wakeups.   |
+    | Flags are only changed while holding CallFlagMutex.       |
+    \*---------------------------------------------------------*/
+    std::mutex                              CallFlagMutex;
+    std::condition_variable                 CallFlagCV;
+    std::chrono::microseconds               UpdateInterval;
+    std::chrono::steady_clock::time_point   UpdateRequestTime;
+    std::chrono::steady_clock::time_point   LastUpdateTime;
+    unsigned int                            UpdateHoldCount;
+    std::chrono::steady_clock::time_point   UpdateReleaseTime;
+    bool                                    RevisionPending;
+
+    bool                                    PartialUpdates;
+    std::vector<RGBColor>                   FlushedColors;
+
+    unsigned int                            ID;
+    std::atomic<unsigned int>               Revision;
+
+    std::mutex                              DescriptionMutex;
+    unsigned int                            DescriptionRevision;
+    std::map<unsigned int, std::shared_ptr<const std::vector<unsigned char>>> DescriptionCache;
+
+    std::vector<unsigned char>              BuildDeviceDescriptionData(unsigned int protocol_version);
+
+    void                                    FlushLEDs();
     //bool                    CallFlag_UpdateZoneLEDs                     = false;
     //bool                    CallFlag_UpdateSingleLED                    = false;
     //bool                    CallFlag_UpdateMode                         = false;
 
+    /*---------------------------------------------------------*\
+    | Each SignalUpdate call is numbered and tracked while its  |
+    | callbacks run, so removing a callback only waits for the  |
+    | calls that were already running, on other threads         |
+    \*---------------------------------------------------------*/
     std::mutex                          UpdateMutex;
+    std::condition_variable             UpdateCallbackCV;
+    unsigned long long                  UpdateCallbackNextCall;
+    std::map<unsigned long long, std::thread::id> UpdateCallbackCalls;
     std::vector<RGBControllerCallback>  UpdateCallbacks;
     std::vector<void *>                 UpdateCallbackArgs;
+
+    void                                WaitForUpdateCallbacks(std::unique_lock<std::mutex>& lock);
 };
@@ -12,10 +12,44 @@
 
 RGBController_Network::RGBController_Network(NetworkClient * client_ptr, unsigned int dev_idx_val)
 {
-    client  = client_ptr;
+    client    = client_ptr;
+    dev_idx   = dev_idx_val;
+    server_id = 0;
+}
+
+/*---------------------------------------------------------*\
+| The device index changes when controllers before this one |
+| are added to or removed from the server's list            |
+\*---------------------------------------------------------*/
+unsigned int RGBController_Network::GetDeviceIndex()
+{
+    return(dev_idx);
+}
+
+void RGBController_Network::SetDeviceIndex(unsigned int dev_idx_val)
+{
     dev_idx = dev_idx_val;
 }
 
+void RGBController_Network::SetServerID(unsigned int server_id_val)
+{
+    server_id = server_id_val;
+}
+
+/*---------------------------------------------------------*| From protocol 7, requests address the controller by its   |
+| ID on the server, so they cannot reach another controller |
+| if the server's list changes before they arrive           |
+\*---------------------------------------------------------*/
+unsigned int RGBController_Network::GetDeviceAddress()
+{
+    if(client->GetProtocolVersion() >= 7)
+    {
+        return(server_id);
+    }
+
+    return(dev_idx);
+}
+
 void RGBController_Network::SetupZones()
 {
     //Don't send anything, this function should only process on host
@@ -23,32 +57,42 @@ void RGBController_Network::SetupZones()
 
 void RGBController_Network::ResizeZone(int zone, int new_size)
 {
-    client->SendRequest_RGBController_ResizeZone(dev_idx, zone, new_size);
+    client->SendRequest_RGBController_ResizeZone(GetDeviceAddress(), zone, new_size);
 
-    client->SendRequest_ControllerData(dev_idx);
+    client->SendRequest_ControllerData(GetDeviceAddress());
     client->WaitOnControllerData();
 }
 
 void RGBController_Network::DeviceUpdateLEDs()
 {
-    unsigned char * data = GetColorDescription();
+    /*---------------------------------------------------------*\
+    | Protocol 6 servers accept delta encoded frames, which     |
+    | only carry the LEDs that changed since the last frame     |
+    \*---------------------------------------------------------*/
+    if(client->GetDeltaUpdates())
+    {
+        client->SendRequest_RGBController_UpdateLEDsDelta(GetDeviceAddress(), colors);
+        return;
+    }
+
+    unsigned char * data = GetColorDescription(client->GetProtocolVersion());
     unsigned int size;
 
     memcpy(&size, &data[0], sizeof(unsigned int));
 
-    client->SendRequest_RGBController_UpdateLEDs(dev_idx, data, size);
+    client->SendRequest_RGBController_UpdateLEDs(GetDeviceAddress(), data, size);
 
     delete[] data;
 }
 
 void RGBController_Network::UpdateZoneLEDs(int zone)
 {
-    unsigned char * data = GetZoneColorDescription(zone);
+    unsigned char * data = GetZoneColorDescription(zone, client->GetProtocolVersion());
     unsigned int size;
 
     memcpy(&size, &data[0], sizeof(unsigned int));
 
-    client->SendRequest_RGBController_UpdateZoneLEDs(dev_idx, data, size);
+    client->SendRequest_RGBController_UpdateZoneLEDs(GetDeviceAddress(), data, size);
 
     delete[] data;
 }
@@ -57,16 +101,16 @@ void RGBController_Network::UpdateSingleLED(int led)
 {
     unsigned char * data = GetSingleLEDColorDescription(led);
 
-    client->SendRequest_RGBController_UpdateSingleLED(dev_idx, data, sizeof(int) + sizeof(RGBColor));
+    client->SendRequest_RGBController_UpdateSingleLED(GetDeviceAddress(), data, sizeof(int) + sizeof(RGBColor));
 
     delete[] data;
 }
 
 void RGBController_Network::SetCustomMode()
 {
-    client->SendRequest_RGBController_SetCustomMode(dev_idx);
+    client->SendRequest_RGBController_SetCustomMode(GetDeviceAddress());
 
-    client->SendRequest_ControllerData(dev_idx);
+    client->SendRequest_ControllerData(GetDeviceAddress());
     client->WaitOnControllerData();
 }
 
@@ -77,7 +121,7 @@ void RGBController_Network::DeviceUpdateMode()
 
     memcpy(&size, &data[0], sizeof(unsigned int));
 
-    client->SendRequest_RGBController_UpdateMode(dev_idx, data, size);
+    client->SendRequest_RGBController_UpdateMode(GetDeviceAddress(), data, size);
 
     delete[] data;
 }
@@ -89,7 +133,7 @@ void RGBController_Network::DeviceSaveMode()
 
     memcpy(&size, &data[0], sizeof(unsigned int));
 
-    client->SendRequest_RGBController_SaveMode(dev_idx, data, size);
+    client->SendRequest_RGBController_SaveMode(GetDeviceAddress(), data, size);
 
     delete[] data;
 }
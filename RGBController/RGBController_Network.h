@@ -30,7 +30,13 @@ public:
 
     void        UpdateLEDs();
 
+    unsigned int GetDeviceIndex();
+    void        SetDeviceIndex(unsigned int dev_idx_val);
+    void        SetServerID(unsigned int server_id_val);
+    unsigned int GetDeviceAddress();
+
 private:
     NetworkClient *     client;
     unsigned int        dev_idx;
+    unsigned int        server_id;
 };
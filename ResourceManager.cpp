@@ -19,6 +19,9 @@
 #include <locale>
 #endif
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <stdlib.h>
 #include <string>
 #include <hidapi/hidapi.h>
@@ -40,6 +43,47 @@ ResourceManager* ResourceManager::instance;
 
 using namespace std::chrono_literals;
 
+/*---------------------------------------------------------*\
+| Detection lanes.  Controllers registered from a lane are  |
+| sorted by lane, then registration order, once detection   |
+| finishes.                                                 |
+\*---------------------------------------------------------*/
+enum
+{
+    DETECTION_LANE_I2C,
+    DETECTION_LANE_HID,
+    DETECTION_LANE_OTHER,
+    DETECTION_LANE_COUNT,
+    DETECTION_LANE_NONE         = -1
+};
+
+/*---------------------------------------------------------*\
+| Detection passes.  With a valid detection cache, the      |
+| detectors that found devices last time run first and the  |
+| rest run afterwards, either as a fallback or in the       |
+| background.                                               |
+\*---------------------------------------------------------*/
+enum
+{
+    DETECTION_PASS_ALL,
+    DETECTION_PASS_CACHED,
+    DETECTION_PASS_UNCACHED
+};
+
+#define DETECTION_CACHE_FILENAME    "DetectionCache.json"
+#define DETECTION_CACHE_VERSION     1
+
+/*---------------------------------------------------------*\
+| Time between committing an update transaction and the     |
+| common flush time, so every device thread has woken up    |
+| before the release time arrives                           |
+\*---------------------------------------------------------*/
+#define UPDATE_TRANSACTION_LEAD_US  2000
+
+static thread_local int         detection_lane      = DETECTION_LANE_NONE;
+static thread_local const char* detection_detector  = nullptr;
+static thread_local const char* detection_hid_path  = nullptr;
+
 ResourceManager *ResourceManager::get()
 {
     if(!instance)
@@ -59,6 +103,8 @@ ResourceManager::ResourceManager()
     detection_percent           = 100;
     detection_string            = "";
     detection_is_required       = false;
+    detection_background        = false;
+    detection_pass              = DETECTION_PASS_ALL;
     DetectDevicesThread         = nullptr;
     dynamic_detectors_processed = false;
 
@@ -98,6 +144,24 @@ ResourceManager::ResourceManager()
         server              = new NetworkServer(rgb_controllers_hw);
     }
 
+    /*-------------------------------------------------------------------------*\
+    | Configure the server event loop and client limit                          |
+    \*-------------------------------------------------------------------------*/
+    if(server_settings.contains("event_loop"))
+    {
+        server->SetEventLoop(server_settings["event_loop"]);
+    }
+
+    if(server_settings.contains("event_threads"))
+    {
+        server->SetEventThreads(server_settings["event_threads"]);
+    }
+
+    if(server_settings.contains("max_clients"))
+    {
+        server->SetMaxClients(server_settings["max_clients"]);
+    }
+
     /*-------------------------------------------------------------------------*\
     | Initialize Saved Client Connections                                       |
     \*-------------------------------------------------------------------------*/
@@ -119,6 +183,11 @@ ResourceManager::ResourceManager()
             client->SetName(titleString.c_str());
             client->SetPort(client_port);
 
+            if(client_settings.contains("delta_updates"))
+            {
+                client->SetDeltaUpdates(client_settings["delta_updates"]);
+            }
+
             client->StartClient();
 
             for(int timeout = 0; timeout < 100; timeout++)
@@ -144,6 +213,10 @@ ResourceManager::ResourceManager()
 
 ResourceManager::~ResourceManager()
 {
+#ifdef __linux__
+    hid_hotplug.stop();
+#endif
+
     Cleanup();
 }
 
@@ -160,9 +233,44 @@ std::vector<i2c_smbus_interface*> & ResourceManager::GetI2CBusses()
 
 void ResourceManager::RegisterRGBController(RGBController *rgb_controller)
 {
+    std::unique_lock<std::mutex> register_lock(DetectionRegisterMutex);
+
     LOG_INFO("[%s] Registering RGB controller", rgb_controller->name.c_str());
     rgb_controllers_hw.push_back(rgb_controller);
 
+    ApplyUpdateRateLimit(rgb_controller);
+
+    /*-------------------------------------------------*\
+    | Track controllers registered by a detection lane  |
+    | so they can be put in order when detection ends   |
+    \*-------------------------------------------------*/
+    if((detection_lane != DETECTION_LANE_NONE) && (detection_lane < (int)detection_lane_controllers.size()))
+    {
+        detection_lane_controllers[detection_lane].push_back(rgb_controller);
+    }
+
+    /*-------------------------------------------------*\
+    | Remember which detector registered the controller |
+    | for the detection cache.  HID detectors only run  |
+    | for devices that are present, so they are not     |
+    | cached.                                           |
+    \*-------------------------------------------------*/
+    if(((detection_lane == DETECTION_LANE_I2C) || (detection_lane == DETECTION_LANE_OTHER))
+    && (detection_detector != nullptr) && (detection_detector[0] != '\0'))
+    {
+        detection_controller_detectors[rgb_controller] = detection_detector;
+    }
+
+    /*-------------------------------------------------*\
+    | Remember the HID device path the controller was   |
+    | created for, so it can be found on unplug even if |
+    | its location does not name the device node        |
+    \*-------------------------------------------------*/
+    if(detection_hid_path != nullptr)
+    {
+        detection_controller_hid_paths[rgb_controller] = detection_hid_path;
+    }
+
     /*-------------------------------------------------*\
     | If the device list size has changed, call the     |
     | device list changed callbacks                     |
@@ -181,16 +289,55 @@ void ResourceManager::RegisterRGBController(RGBController *rgb_controller)
         {
             profile_manager->LoadDeviceFromListWithOptions(rgb_controllers_sizes, detection_size_entry_used, rgb_controllers_hw[controller_size_idx], true, false);
         }
-
-        UpdateDeviceList();
     }
     detection_prev_size = rgb_controllers_hw.size();
 
+    /*-------------------------------------------------*\
+    | Run the device list callbacks without holding the |
+    | register lock, so other detection lanes can keep  |
+    | registering controllers meanwhile                 |
+    \*-------------------------------------------------*/
+    register_lock.unlock();
+
     UpdateDeviceList();
 }
 
+void ResourceManager::ApplyUpdateRateLimit(RGBController* rgb_controller)
+{
+    /*-------------------------------------------------*\
+    | Devices can be limited to a maximum update rate,  |
+    | either all at once with max_fps or by device name |
+    | in the devices list.  0 means no limit.  Entries  |
+    | that are not unsigned numbers are ignored         |
+    \*-------------------------------------------------*/
+    json            rate_settings   = settings_manager->GetSettings("UpdateRateLimits");
+    unsigned int    max_fps         = 0;
+
+    if(rate_settings.contains("max_fps") && rate_settings["max_fps"].is_number_unsigned())
+    {
+        max_fps = rate_settings["max_fps"];
+    }
+
+    if(rate_settings.contains("devices")
+    && rate_settings["devices"].is_object()
+    && rate_settings["devices"].contains(rgb_controller->name)
+    && rate_settings["devices"][rgb_controller->name].is_number_unsigned())
+    {
+        max_fps = rate_settings["devices"][rgb_controller->name];
+    }
+
+    rgb_controller->SetUpdateRateLimit(max_fps);
+
+    if(rgb_controller->GetUpdateRateLimit() > 0)
+    {
+        LOG_INFO("[%s] Limiting updates to %u FPS", rgb_controller->name.c_str(), rgb_controller->GetUpdateRateLimit());
+    }
+}
+
 void ResourceManager::UnregisterRGBController(RGBController* rgb_controller)
 {
+    std::unique_lock<std::mutex> register_lock(DetectionRegisterMutex);
+
     LOG_INFO("[%s] Unregistering RGB controller", rgb_controller->name.c_str());
 
     /*-------------------------------------------------------------------------*\
@@ -208,9 +355,16 @@ void ResourceManager::UnregisterRGBController(RGBController* rgb_controller)
         rgb_controllers_hw.erase(hw_it);
     }
 
+    detection_controller_detectors.erase(rgb_controller);
+    detection_controller_hid_paths.erase(rgb_controller);
+
+    register_lock.unlock();
+
     /*-------------------------------------------------------------------------*\
     | Find the controller to remove and remove it from the master list          |
     \*-------------------------------------------------------------------------*/
+    DeviceListChangeMutex.lock();
+
     std::vector<RGBController*>::iterator rgb_it = std::find(rgb_controllers.begin(), rgb_controllers.end(), rgb_controller);
 
     if (rgb_it != rgb_controllers.end())
@@ -218,6 +372,8 @@ void ResourceManager::UnregisterRGBController(RGBController* rgb_controller)
         rgb_controllers.erase(rgb_it);
     }
 
+    DeviceListChangeMutex.unlock();
+
     UpdateDeviceList();
 }
 
@@ -226,6 +382,24 @@ std::vector<RGBController*> & ResourceManager::GetRGBControllers()
     return rgb_controllers;
 }
 
+void ResourceManager::BeginUpdateTransaction(std::vector<RGBController*> & controllers)
+{
+    for(std::size_t controller_idx = 0; controller_idx < controllers.size(); controller_idx++)
+    {
+        controllers[controller_idx]->HoldUpdates();
+    }
+}
+
+void ResourceManager::CommitUpdateTransaction(std::vector<RGBController*> & controllers)
+{
+    std::chrono::steady_clock::time_point release_time = std::chrono::steady_clock::now() + std::chrono::microseconds(UPDATE_TRANSACTION_LEAD_US);
+
+    for(std::size_t controller_idx = 0; controller_idx < controllers.size(); controller_idx++)
+    {
+        controllers[controller_idx]->ReleaseUpdates(release_time);
+    }
+}
+
 void ResourceManager::RegisterI2CBusDetector(I2CBusDetectorFunction detector)
 {
     i2c_bus_detectors.push_back(detector);
@@ -411,10 +585,18 @@ void ResourceManager::UpdateDeviceList()
 {
     DeviceListChangeMutex.lock();
 
+    /*-------------------------------------------------*\
+    | Detection lanes may be registering controllers,   |
+    | work from a copy of the hardware controller list  |
+    \*-------------------------------------------------*/
+    DetectionRegisterMutex.lock();
+    std::vector<RGBController*> controllers_hw = rgb_controllers_hw;
+    DetectionRegisterMutex.unlock();
+
     /*-------------------------------------------------*\
     | Insert hardware controllers into controller list  |
     \*-------------------------------------------------*/
-    for(unsigned int hw_controller_idx = 0; hw_controller_idx < rgb_controllers_hw.size(); hw_controller_idx++)
+    for(unsigned int hw_controller_idx = 0; hw_controller_idx < controllers_hw.size(); hw_controller_idx++)
     {
         /*-------------------------------------------------*\
         | Check if the controller is already in the list    |
@@ -422,7 +604,7 @@ void ResourceManager::UpdateDeviceList()
         \*-------------------------------------------------*/
         if(hw_controller_idx < rgb_controllers.size())
         {
-            if(rgb_controllers[hw_controller_idx] == rgb_controllers_hw[hw_controller_idx])
+            if(rgb_controllers[hw_controller_idx] == controllers_hw[hw_controller_idx])
             {
                 continue;
             }
@@ -432,12 +614,15 @@ void ResourceManager::UpdateDeviceList()
         | If not, check if the controller is already in the |
         | list at a different index                         |
         \*-------------------------------------------------*/
+        bool found = false;
+
         for(unsigned int controller_idx = 0; controller_idx < rgb_controllers.size(); controller_idx++)
         {
-            if(rgb_controllers[controller_idx] == rgb_controllers_hw[hw_controller_idx])
+            if(rgb_controllers[controller_idx] == controllers_hw[hw_controller_idx])
             {
                 rgb_controllers.erase(rgb_controllers.begin() + controller_idx);
-                rgb_controllers.insert(rgb_controllers.begin() + hw_controller_idx, rgb_controllers_hw[hw_controller_idx]);
+                rgb_controllers.insert(rgb_controllers.begin() + hw_controller_idx, controllers_hw[hw_controller_idx]);
+                found = true;
                 break;
             }
         }
@@ -445,7 +630,10 @@ void ResourceManager::UpdateDeviceList()
         /*-------------------------------------------------*\
         | If it still hasn't been found, add it to the list |
         \*-------------------------------------------------*/
-        rgb_controllers.insert(rgb_controllers.begin() + hw_controller_idx, rgb_controllers_hw[hw_controller_idx]);
+        if(!found)
+        {
+            rgb_controllers.insert(rgb_controllers.begin() + hw_controller_idx, controllers_hw[hw_controller_idx]);
+        }
     }
 
     /*-------------------------------------------------*\
@@ -651,6 +839,19 @@ void ResourceManager::Cleanup()
 {
     ResourceManager::get()->WaitForDeviceDetection();
 
+    /*-------------------------------------------------*\
+    | Stop a background detection pass, if running, and |
+    | wait for the detection thread to exit             |
+    \*-------------------------------------------------*/
+    if(DetectDevicesThread)
+    {
+        detection_is_required = false;
+
+        DetectDevicesThread->join();
+        delete DetectDevicesThread;
+        DetectDevicesThread = nullptr;
+    }
+
     std::vector<RGBController *> rgb_controllers_hw_copy = rgb_controllers_hw;
 
     for(unsigned int hw_controller_idx = 0; hw_controller_idx < rgb_controllers_hw.size(); hw_controller_idx++)
@@ -670,6 +871,8 @@ void ResourceManager::Cleanup()
     | previous hardware controllers list size to zero   |
     \*-------------------------------------------------*/
     rgb_controllers_hw.clear();
+    detection_controller_detectors.clear();
+    detection_controller_hid_paths.clear();
     detection_prev_size = 0;
 
     for(RGBController* rgb_controller : rgb_controllers_hw_copy)
@@ -692,13 +895,6 @@ void ResourceManager::Cleanup()
     int hid_status = hid_exit();
 
     LOG_DEBUG("Closing HID interfaces: %s", ((hid_status == 0) ? "Success" : "Failed"));
-
-    if(DetectDevicesThread)
-    {
-        DetectDevicesThread->join();
-        delete DetectDevicesThread;
-        DetectDevicesThread = nullptr;
-    }
 }
 
 void ResourceManager::ProcessPreDetectionHooks()
@@ -752,9 +948,10 @@ void ResourceManager::DetectDevices()
     if(detection_enabled)
     {
         /*-------------------------------------------------*\
-        | Do nothing is it is already detecting devices     |
+        | Do nothing is it is already detecting devices.  A |
+        | background pass is stopped by Cleanup instead.    |
         \*-------------------------------------------------*/
-        if(detection_is_required.load())
+        if(detection_is_required.load() && !detection_background.load())
         {
             return;
         }
@@ -768,6 +965,12 @@ void ResourceManager::DetectDevices()
 
         DetectionProgressChanged();
 
+        /*-------------------------------------------------*\
+        | Hold off hotplug events while the controller list |
+        | is torn down and detection is started             |
+        \*-------------------------------------------------*/
+        HIDHotplugMutex.lock();
+
         Cleanup();
 
         UpdateDeviceList();
@@ -778,6 +981,27 @@ void ResourceManager::DetectDevices()
         detection_is_required = true;
         DetectDevicesThread = new std::thread(&ResourceManager::DetectDevicesThreadFunction, this);
 
+        HIDHotplugMutex.unlock();
+
+#ifdef __linux__
+        /*-------------------------------------------------*\
+        | Start watching for HID devices being plugged in   |
+        | or removed, unless disabled in the settings       |
+        \*-------------------------------------------------*/
+        json detector_settings  = settings_manager->GetSettings("Detectors");
+        bool hid_hotplug_enable = true;
+
+        if(detector_settings.contains("hid_hotplug"))
+        {
+            hid_hotplug_enable = detector_settings["hid_hotplug"];
+        }
+
+        if(hid_hotplug_enable && !hid_hotplug.is_running())
+        {
+            hid_hotplug.start([this](int event, const std::string & node) { HIDHotplugEvent(event, node); });
+        }
+#endif
+
         /*-------------------------------------------------*\
         | Release the current thread to allow detection     |
         | thread to start                                   |
@@ -845,188 +1069,840 @@ const char* wchar_to_char(const wchar_t* pwchar)
     return filePathC;
 }
 
-void ResourceManager::DetectDevicesThreadFunction()
+/*---------------------------------------------------------*\
+| Check a HID detector's interface, usage page, and usage   |
+| against an enumerated device.  The VID/PID has already    |
+| been matched through the detector index.                  |
+\*---------------------------------------------------------*/
+template<typename T>
+static bool HIDDetectorMatches(const T& block, hid_device_info* info, bool check_usage)
 {
-    DetectDeviceMutex.lock();
+    if(check_usage)
+    {
+        if((block.usage_page != HID_USAGE_PAGE_ANY) && (block.usage_page != info->usage_page))
+        {
+            return false;
+        }
 
-    hid_device_info*    current_hid_device;
-    float               percent             = 0.0f;
-    float               percent_denominator = 0.0f;
-    json                detector_settings;
-    unsigned int        hid_device_count    = 0;
-    hid_device_info*    hid_devices         = NULL;
-    bool                hid_safe_mode       = false;
+        if((block.usage != HID_USAGE_ANY) && (block.usage != info->usage))
+        {
+            return false;
+        }
+    }
 
-    LOG_INFO("------------------------------------------------------");
-    LOG_INFO("|               Start device detection               |");
-    LOG_INFO("------------------------------------------------------");
+    return((block.interface == HID_INTERFACE_ANY) || (block.interface == info->interface_number));
+}
 
-    /*-------------------------------------------------*\
-    | Reset the size entry used flags vector            |
-    \*-------------------------------------------------*/
-    detection_size_entry_used.resize(rgb_controllers_sizes.size());
+static bool HIDDetectorIndexLess(const HIDDetectorIndexEntry& a, const HIDDetectorIndexEntry& b)
+{
+    return(a.address < b.address);
+}
 
-    for(unsigned int size_idx = 0; size_idx < detection_size_entry_used.size(); size_idx++)
+static bool IsDetectorEnabled(const json & detector_settings, const std::string & name)
+{
+    if(detector_settings.contains("detectors") && detector_settings["detectors"].contains(name))
     {
-        detection_size_entry_used[size_idx] = false;
+        return(detector_settings["detectors"][name]);
     }
 
-    /*-------------------------------------------------*\
-    | Open device disable list and read in disabled     |
-    | device strings                                    |
-    \*-------------------------------------------------*/
-    detector_settings = settings_manager->GetSettings("Detectors");
-
-    /*-------------------------------------------------*\
-    | Initialize HID interface for detection            |
-    \*-------------------------------------------------*/
-    int hid_status = hid_init();
-
-    LOG_INFO("Initializing HID interfaces: %s", ((hid_status == 0) ? "Success" : "Failed"));
+    return(true);
+}
 
+void ResourceManager::DetectionStepDone()
+{
     /*-------------------------------------------------*\
-    | Check HID safe mode setting                       |
+    | The background pass does not report progress      |
     \*-------------------------------------------------*/
-    if(detector_settings.contains("hid_safe_mode"))
+    if(detection_background.load())
     {
-        hid_safe_mode = detector_settings["hid_safe_mode"];
+        return;
     }
 
-    /*-------------------------------------------------*\
-    | Calculate the percentage denominator by adding    |
-    | the number of I2C and miscellaneous detectors and |
-    | the number of enumerated HID devices              |
-    |                                                   |
-    | Start by iterating through all HID devices in     |
-    | list to get a total count                         |
-    \*-------------------------------------------------*/
-    if(!hid_safe_mode)
+    float percent = (detection_steps_done.fetch_add(1) + 1.0f) / detection_steps_total;
+
+    if(percent > 1.0f)
     {
-        hid_devices = hid_enumerate(0, 0);
+        percent = 1.0f;
     }
 
-    current_hid_device = hid_devices;
+    detection_percent = percent * 100.0f;
+}
 
-    while(current_hid_device)
-    {
-        hid_device_count++;
+/*---------------------------------------------------------*\
+| Record the time spent in a detection phase and start      |
+| timing the next one                                       |
+\*---------------------------------------------------------*/
+void ResourceManager::EndDetectionPhase(const char* phase, std::chrono::steady_clock::time_point & phase_start)
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
 
-        current_hid_device = current_hid_device->next;
-    }
+    DetectionPhaseMutex.lock();
+    detection_phase_times.push_back(std::make_pair(phase, now - phase_start));
+    DetectionPhaseMutex.unlock();
 
-    percent_denominator = i2c_device_detectors.size() + i2c_pci_device_detectors.size() + device_detectors.size() + hid_device_count;
+    phase_start = now;
+}
 
-    /*-------------------------------------------------*\
-    | Start at 0% detection progress                    |
-    \*-------------------------------------------------*/
-    detection_percent = 0;
+void ResourceManager::SortDetectedControllers()
+{
+    std::unique_lock<std::mutex>    register_lock(DetectionRegisterMutex);
+    std::vector<RGBController*>     sorted_controllers;
 
     /*-------------------------------------------------*\
-    | Detect i2c interfaces                             |
+    | Controllers not registered from a detection lane  |
+    | keep their order at the front of the list         |
     \*-------------------------------------------------*/
-    LOG_INFO("------------------------------------------------------");
-    LOG_INFO("|             Detecting I2C interfaces               |");
-    LOG_INFO("------------------------------------------------------");
-
-    bool i2c_interface_fail = false;
-
-    for(unsigned int i2c_bus_detector_idx = 0; i2c_bus_detector_idx < i2c_bus_detectors.size() && detection_is_required.load(); i2c_bus_detector_idx++)
+    for(unsigned int hw_controller_idx = 0; hw_controller_idx < rgb_controllers_hw.size(); hw_controller_idx++)
     {
-        if(i2c_bus_detectors[i2c_bus_detector_idx]() == false)
+        bool in_lane = false;
+
+        for(unsigned int lane_idx = 0; lane_idx < detection_lane_controllers.size(); lane_idx++)
         {
-            i2c_interface_fail = true;
+            if(std::find(detection_lane_controllers[lane_idx].begin(), detection_lane_controllers[lane_idx].end(), rgb_controllers_hw[hw_controller_idx]) != detection_lane_controllers[lane_idx].end())
+            {
+                in_lane = true;
+                break;
+            }
         }
 
-        I2CBusListChanged();
+        if(!in_lane)
+        {
+            sorted_controllers.push_back(rgb_controllers_hw[hw_controller_idx]);
+        }
     }
 
     /*-------------------------------------------------*\
-    | Detect i2c devices                                |
+    | Then add each lane's controllers in the order     |
+    | they were registered, skipping any that have been |
+    | unregistered since                                |
     \*-------------------------------------------------*/
-    LOG_INFO("------------------------------------------------------");
-    LOG_INFO("|               Detecting I2C devices                |");
-    LOG_INFO("------------------------------------------------------");
-    for(unsigned int i2c_detector_idx = 0; i2c_detector_idx < i2c_device_detectors.size() && detection_is_required.load(); i2c_detector_idx++)
+    for(unsigned int lane_idx = 0; lane_idx < detection_lane_controllers.size(); lane_idx++)
     {
-        detection_string = i2c_device_detector_strings[i2c_detector_idx].c_str();
-
-        /*-------------------------------------------------*\
-        | Check if this detector is enabled                 |
-        \*-------------------------------------------------*/
-        bool this_device_enabled = true;
-        if(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detection_string))
+        for(unsigned int lane_controller_idx = 0; lane_controller_idx < detection_lane_controllers[lane_idx].size(); lane_controller_idx++)
         {
-            this_device_enabled = detector_settings["detectors"][detection_string];
-        }
-
-        LOG_DEBUG("[%s] is %s", detection_string, ((this_device_enabled == true) ? "enabled" : "disabled"));
-        if(this_device_enabled)
-        {
-            DetectionProgressChanged();
+            RGBController* controller = detection_lane_controllers[lane_idx][lane_controller_idx];
 
-            i2c_device_detectors[i2c_detector_idx](busses);
-        }
-
-        /*-------------------------------------------------*\
-        | If the device list size has changed, call the     |
-        | device list changed callbacks                     |
-        \*-------------------------------------------------*/
-        if(rgb_controllers_hw.size() != detection_prev_size)
-        {
-            /*-------------------------------------------------*\
-            | First, load sizes for the new controllers         |
-            \*-------------------------------------------------*/
-            for(unsigned int controller_size_idx = detection_prev_size; controller_size_idx < rgb_controllers_hw.size(); controller_size_idx++)
+            if(std::find(rgb_controllers_hw.begin(), rgb_controllers_hw.end(), controller) != rgb_controllers_hw.end())
             {
-                profile_manager->LoadDeviceFromListWithOptions(rgb_controllers_sizes, detection_size_entry_used, rgb_controllers_hw[controller_size_idx], true, false);
+                sorted_controllers.push_back(controller);
             }
-
-            UpdateDeviceList();
-        }
-        else
-        {
-            LOG_DEBUG("[%s] no devices found", detection_string);
         }
-        detection_prev_size = rgb_controllers_hw.size();
 
-        LOG_TRACE("[%s] detection end", detection_string);
+        detection_lane_controllers[lane_idx].clear();
+    }
 
-        /*-------------------------------------------------*\
-        | Update detection percent                          |
-        \*-------------------------------------------------*/
-        percent = (i2c_detector_idx + 1.0f) / percent_denominator;
+    if(sorted_controllers != rgb_controllers_hw)
+    {
+        rgb_controllers_hw = sorted_controllers;
 
-        detection_percent = percent * 100.0f;
+        register_lock.unlock();
+
+        UpdateDeviceList();
     }
+}
 
-    /*-------------------------------------------------*\
-    | Detect i2c PCI devices                            |
-    \*-------------------------------------------------*/
-    LOG_INFO("------------------------------------------------------");
-    LOG_INFO("|               Detecting I2C PCI devices            |");
-    LOG_INFO("------------------------------------------------------");
-    for(unsigned int i2c_detector_idx = 0; i2c_detector_idx < i2c_pci_device_detectors.size() && detection_is_required.load(); i2c_detector_idx++)
+bool ResourceManager::DetectorInPass(const char* name)
+{
+    switch(detection_pass)
     {
-        detection_string = i2c_pci_device_detectors[i2c_detector_idx].name.c_str();
+        case DETECTION_PASS_CACHED:
+            return(detection_cache_detectors.count(name) > 0);
 
-        /*-------------------------------------------------*\
-        | Check if this detector is enabled                 |
-        \*-------------------------------------------------*/
-        bool this_device_enabled = true;
-        if(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detection_string))
-        {
-            this_device_enabled = detector_settings["detectors"][detection_string];
-        }
+        case DETECTION_PASS_UNCACHED:
+            return(detection_cache_detectors.count(name) == 0);
 
-        LOG_DEBUG("[%s] is %s", detection_string, ((this_device_enabled == true) ? "enabled" : "disabled"));
-        if(this_device_enabled)
-        {
-            DetectionProgressChanged();
+        default:
+            return(true);
+    }
+}
 
-            for(unsigned int bus = 0; bus < busses.size(); bus++)
-            {
-                if(busses[bus]->pci_vendor           == i2c_pci_device_detectors[i2c_detector_idx].ven_id    &&
-                   busses[bus]->pci_device           == i2c_pci_device_detectors[i2c_detector_idx].dev_id    &&
+/*---------------------------------------------------------*\
+| Describe the I2C busses so a cache written on different   |
+| hardware, or before a driver change, is not used          |
+\*---------------------------------------------------------*/
+static json DescribeI2CBusses(const std::vector<i2c_smbus_interface*> & busses)
+{
+    json bus_list = json::array();
+
+    for(unsigned int bus_idx = 0; bus_idx < busses.size(); bus_idx++)
+    {
+        json bus;
+
+        bus["name"]                 = busses[bus_idx]->device_name;
+        bus["port_id"]              = busses[bus_idx]->port_id;
+        bus["pci_vendor"]           = busses[bus_idx]->pci_vendor;
+        bus["pci_device"]           = busses[bus_idx]->pci_device;
+        bus["pci_subsystem_vendor"] = busses[bus_idx]->pci_subsystem_vendor;
+        bus["pci_subsystem_device"] = busses[bus_idx]->pci_subsystem_device;
+
+        bus_list.push_back(bus);
+    }
+
+    return(bus_list);
+}
+
+static bool DetectionCacheEntryMatches(const json & entry, const std::string & detector, RGBController* controller)
+{
+    return((entry["detector"] == detector)
+        && (entry["location"] == controller->location)
+        && (entry["serial"]   == controller->serial));
+}
+
+bool ResourceManager::LoadDetectionCache()
+{
+    detection_cache.clear();
+    detection_cache_detectors.clear();
+
+    std::ifstream cache_file(config_dir / DETECTION_CACHE_FILENAME, std::ios::in | std::ios::binary);
+
+    if(!cache_file)
+    {
+        return(false);
+    }
+
+    try
+    {
+        cache_file >> detection_cache;
+    }
+    catch(const std::exception& e)
+    {
+        LOG_ERROR("[ResourceManager] Detection cache parsing failed: %s", e.what());
+
+        detection_cache.clear();
+        return(false);
+    }
+
+    if(!detection_cache.contains("version") || (detection_cache["version"] != DETECTION_CACHE_VERSION)
+    || !detection_cache.contains("busses")  || !detection_cache.contains("controllers"))
+    {
+        LOG_INFO("Detection cache is out of date, ignoring it");
+
+        detection_cache.clear();
+        return(false);
+    }
+
+    if(detection_cache["busses"] != DescribeI2CBusses(busses))
+    {
+        LOG_INFO("Detection cache: I2C busses changed, ignoring it");
+
+        detection_cache.clear();
+        return(false);
+    }
+
+    for(unsigned int entry_idx = 0; entry_idx < detection_cache["controllers"].size(); entry_idx++)
+    {
+        detection_cache_detectors.insert(detection_cache["controllers"][entry_idx]["detector"].get<std::string>());
+    }
+
+    return(true);
+}
+
+/*---------------------------------------------------------*\
+| Check that every cached controller was detected again.    |
+| Returns the number of cached controllers not found.       |
+\*---------------------------------------------------------*/
+unsigned int ResourceManager::ValidateDetectionCache()
+{
+    std::lock_guard<std::mutex> register_lock(DetectionRegisterMutex);
+    unsigned int                misses = 0;
+
+    for(unsigned int entry_idx = 0; entry_idx < detection_cache["controllers"].size(); entry_idx++)
+    {
+        const json &    entry = detection_cache["controllers"][entry_idx];
+        bool            found = false;
+
+        for(std::map<RGBController*, std::string>::iterator it = detection_controller_detectors.begin(); it != detection_controller_detectors.end(); it++)
+        {
+            if(DetectionCacheEntryMatches(entry, it->second, it->first))
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if(!found)
+        {
+            LOG_DEBUG("Detection cache: [%s] at %s not found", entry["name"].get<std::string>().c_str(), entry["location"].get<std::string>().c_str());
+            misses++;
+        }
+    }
+
+    return(misses);
+}
+
+void ResourceManager::SaveDetectionCache()
+{
+    json cache;
+
+    cache["version"]        = DETECTION_CACHE_VERSION;
+    cache["busses"]         = DescribeI2CBusses(busses);
+    cache["controllers"]    = json::array();
+
+    DetectionRegisterMutex.lock();
+
+    for(unsigned int hw_controller_idx = 0; hw_controller_idx < rgb_controllers_hw.size(); hw_controller_idx++)
+    {
+        RGBController*                                  controller  = rgb_controllers_hw[hw_controller_idx];
+        std::map<RGBController*, std::string>::iterator it          = detection_controller_detectors.find(controller);
+
+        if(it == detection_controller_detectors.end())
+        {
+            continue;
+        }
+
+        json entry;
+
+        entry["detector"]   = it->second;
+        entry["name"]       = controller->name;
+        entry["location"]   = controller->location;
+        entry["serial"]     = controller->serial;
+        entry["zones"]      = json::array();
+
+        for(unsigned int zone_idx = 0; zone_idx < controller->zones.size(); zone_idx++)
+        {
+            entry["zones"].push_back(controller->zones[zone_idx].leds_count);
+        }
+
+        cache["controllers"].push_back(entry);
+    }
+
+    DetectionRegisterMutex.unlock();
+
+    /*-------------------------------------------------*\
+    | Only write the file when the contents change      |
+    \*-------------------------------------------------*/
+    if(cache == detection_cache)
+    {
+        return;
+    }
+
+    /*-------------------------------------------------*\
+    | Write to a temporary file and move it over the    |
+    | old cache, so an interrupted write never leaves a |
+    | truncated cache behind                            |
+    \*-------------------------------------------------*/
+    filesystem::path cache_path = config_dir / DETECTION_CACHE_FILENAME;
+    filesystem::path temp_path  = cache_path;
+    temp_path.concat(".tmp");
+
+    std::ofstream cache_file(temp_path, std::ios::out | std::ios::binary);
+    bool          written       = false;
+
+    if(cache_file)
+    {
+        try
+        {
+            cache_file << cache.dump(4);
+            written = cache_file.good();
+        }
+        catch(const std::exception& e)
+        {
+            LOG_ERROR("[ResourceManager] Cannot write detection cache: %s", e.what());
+        }
+
+        cache_file.close();
+        written = written && !cache_file.fail();
+    }
+
+    if(written)
+    {
+        std::error_code ec;
+
+        filesystem::rename(temp_path, cache_path, ec);
+
+        if(ec)
+        {
+            LOG_ERROR("[ResourceManager] Cannot replace detection cache: %s", ec.message().c_str());
+            written = false;
+        }
+    }
+
+    if(!written)
+    {
+        std::error_code ec;
+
+        filesystem::remove(temp_path, ec);
+    }
+
+    detection_cache = cache;
+
+    detection_cache_detectors.clear();
+
+    for(unsigned int entry_idx = 0; entry_idx < detection_cache["controllers"].size(); entry_idx++)
+    {
+        detection_cache_detectors.insert(detection_cache["controllers"][entry_idx]["detector"].get<std::string>());
+    }
+}
+
+void ResourceManager::BuildHIDDetectorIndex(json & detector_settings)
+{
+    /*-------------------------------------------------*\
+    | Sort detectors by VID/PID.  The sort is stable so |
+    | detectors for the same VID/PID keep their         |
+    | registration order.                               |
+    \*-------------------------------------------------*/
+    hid_device_detector_index.resize(hid_device_detectors.size());
+    hid_device_detector_enabled.resize(hid_device_detectors.size());
+
+    for(unsigned int hid_detector_idx = 0; hid_detector_idx < hid_device_detectors.size(); hid_detector_idx++)
+    {
+        hid_device_detector_index[hid_detector_idx].address      = hid_device_detectors[hid_detector_idx].address;
+        hid_device_detector_index[hid_detector_idx].detector_idx = hid_detector_idx;
+        hid_device_detector_enabled[hid_detector_idx]            = IsDetectorEnabled(detector_settings, hid_device_detectors[hid_detector_idx].name);
+    }
+
+    std::stable_sort(hid_device_detector_index.begin(), hid_device_detector_index.end(), HIDDetectorIndexLess);
+
+    hid_wrapped_device_detector_index.resize(hid_wrapped_device_detectors.size());
+    hid_wrapped_device_detector_enabled.resize(hid_wrapped_device_detectors.size());
+
+    for(unsigned int hid_detector_idx = 0; hid_detector_idx < hid_wrapped_device_detectors.size(); hid_detector_idx++)
+    {
+        hid_wrapped_device_detector_index[hid_detector_idx].address      = hid_wrapped_device_detectors[hid_detector_idx].address;
+        hid_wrapped_device_detector_index[hid_detector_idx].detector_idx = hid_detector_idx;
+        hid_wrapped_device_detector_enabled[hid_detector_idx]            = IsDetectorEnabled(detector_settings, hid_wrapped_device_detectors[hid_detector_idx].name);
+    }
+
+    std::stable_sort(hid_wrapped_device_detector_index.begin(), hid_wrapped_device_detector_index.end(), HIDDetectorIndexLess);
+}
+
+void ResourceManager::DetectDevicesThreadFunction()
+{
+    DetectDeviceMutex.lock();
+
+    hid_device_info*    current_hid_device;
+    json                detector_settings;
+    unsigned int        hid_device_count            = 0;
+    hid_device_info*    hid_devices                 = NULL;
+    bool                hid_safe_mode               = false;
+    bool                parallel_detection          = true;
+    bool                detection_cache_enabled     = true;
+    bool                detection_cache_background  = true;
+
+    std::chrono::steady_clock::time_point   detection_start = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point   phase_start     = detection_start;
+
+    LOG_INFO("------------------------------------------------------");
+    LOG_INFO("|               Start device detection               |");
+    LOG_INFO("------------------------------------------------------");
+
+    /*-------------------------------------------------*\
+    | Reset the size entry used flags vector            |
+    \*-------------------------------------------------*/
+    detection_size_entry_used.resize(rgb_controllers_sizes.size());
+
+    for(unsigned int size_idx = 0; size_idx < detection_size_entry_used.size(); size_idx++)
+    {
+        detection_size_entry_used[size_idx] = false;
+    }
+
+    /*-------------------------------------------------*\
+    | Open device disable list and read in disabled     |
+    | device strings                                    |
+    \*-------------------------------------------------*/
+    detector_settings = settings_manager->GetSettings("Detectors");
+
+    /*-------------------------------------------------*\
+    | Index the HID detectors by VID/PID and resolve    |
+    | their enable flags                                |
+    \*-------------------------------------------------*/
+    BuildHIDDetectorIndex(detector_settings);
+
+    /*-------------------------------------------------*\
+    | Initialize HID interface for detection            |
+    \*-------------------------------------------------*/
+    int hid_status = hid_init();
+
+    LOG_INFO("Initializing HID interfaces: %s", ((hid_status == 0) ? "Success" : "Failed"));
+
+    /*-------------------------------------------------*\
+    | Check HID safe mode, parallel detection, and      |
+    | detection cache settings                          |
+    \*-------------------------------------------------*/
+    if(detector_settings.contains("hid_safe_mode"))
+    {
+        hid_safe_mode = detector_settings["hid_safe_mode"];
+    }
+
+    if(detector_settings.contains("parallel_detection"))
+    {
+        parallel_detection = detector_settings["parallel_detection"];
+    }
+
+    if(detector_settings.contains("detection_cache"))
+    {
+        detection_cache_enabled = detector_settings["detection_cache"];
+    }
+
+    if(detector_settings.contains("detection_cache_background_scan"))
+    {
+        detection_cache_background = detector_settings["detection_cache_background_scan"];
+    }
+
+    /*-------------------------------------------------*\
+    | Calculate the percentage denominator by adding    |
+    | the number of I2C and miscellaneous detectors and |
+    | the number of enumerated HID devices              |
+    |                                                   |
+    | Start by iterating through all HID devices in     |
+    | list to get a total count                         |
+    \*-------------------------------------------------*/
+    if(!hid_safe_mode)
+    {
+        hid_devices = hid_enumerate(0, 0);
+    }
+
+    current_hid_device = hid_devices;
+
+    while(current_hid_device)
+    {
+        hid_device_count++;
+
+        current_hid_device = current_hid_device->next;
+    }
+
+    detection_steps_total = i2c_device_detectors.size() + i2c_pci_device_detectors.size() + device_detectors.size() + hid_device_count;
+
+    /*-------------------------------------------------*\
+    | Start at 0% detection progress                    |
+    \*-------------------------------------------------*/
+    detection_steps_done = 0;
+    detection_percent    = 0;
+
+    /*-------------------------------------------------*\
+    | Clear the per-lane lists of detected controllers  |
+    \*-------------------------------------------------*/
+    DetectionRegisterMutex.lock();
+    detection_lane_controllers.assign(DETECTION_LANE_COUNT, std::vector<RGBController*>());
+    DetectionRegisterMutex.unlock();
+
+    EndDetectionPhase("Setup", phase_start);
+
+    /*-------------------------------------------------*\
+    | Detect i2c interfaces                             |
+    \*-------------------------------------------------*/
+    LOG_INFO("------------------------------------------------------");
+    LOG_INFO("|             Detecting I2C interfaces               |");
+    LOG_INFO("------------------------------------------------------");
+
+    bool i2c_interface_fail = false;
+
+    for(unsigned int i2c_bus_detector_idx = 0; i2c_bus_detector_idx < i2c_bus_detectors.size() && detection_is_required.load(); i2c_bus_detector_idx++)
+    {
+        if(i2c_bus_detectors[i2c_bus_detector_idx]() == false)
+        {
+            i2c_interface_fail = true;
+        }
+
+        I2CBusListChanged();
+    }
+
+    EndDetectionPhase("I2C interfaces", phase_start);
+
+    /*-------------------------------------------------*\
+    | If the detection cache matches the I2C busses     |
+    | found above, only run the detectors that found    |
+    | devices last time                                 |
+    \*-------------------------------------------------*/
+    bool use_cache = detection_cache_enabled && LoadDetectionCache();
+
+    if(use_cache)
+    {
+        LOG_INFO("Detection cache loaded, running %d cached detectors first", (int)detection_cache_detectors.size());
+        detection_pass = DETECTION_PASS_CACHED;
+    }
+    else
+    {
+        detection_pass = DETECTION_PASS_ALL;
+    }
+
+    RunDetectionLanes(detector_settings, hid_safe_mode, hid_devices, parallel_detection);
+
+    /*-------------------------------------------------*\
+    | If any cached device was not found, fall back to  |
+    | running the remaining detectors now               |
+    \*-------------------------------------------------*/
+    if(use_cache && detection_is_required.load())
+    {
+        unsigned int cache_misses = ValidateDetectionCache();
+
+        if(cache_misses > 0)
+        {
+            LOG_INFO("Detection cache: %d cached devices not found, running remaining detectors", cache_misses);
+
+            detection_pass          = DETECTION_PASS_UNCACHED;
+            detection_steps_total   = i2c_device_detectors.size() + i2c_pci_device_detectors.size() + device_detectors.size();
+            detection_steps_done    = 0;
+
+            RunDetectionLanes(detector_settings, hid_safe_mode, NULL, parallel_detection);
+
+            use_cache               = false;
+        }
+    }
+
+    if(detection_is_required.load())
+    {
+        SaveDetectionCache();
+    }
+
+    phase_start = std::chrono::steady_clock::now();
+
+    /*-------------------------------------------------*\
+    | Run the remaining detectors in the background     |
+    | once the cached devices are up, if enabled        |
+    \*-------------------------------------------------*/
+    bool run_background = use_cache && detection_cache_background && detection_is_required.load();
+
+    /*-------------------------------------------------*\
+    | Make sure that when the detection is done,        |
+    | progress bar is set to 100%                       |
+    \*-------------------------------------------------*/
+    detection_background  = run_background;
+    detection_is_required = run_background;
+    detection_percent = 100;
+    detection_string = "";
+
+    DetectionProgressChanged();
+
+    DetectDeviceMutex.unlock();
+
+#ifdef __linux__
+    /*-----------------------------------------------------*\
+    | Handle devices plugged in or removed during detection |
+    \*-----------------------------------------------------*/
+    ReplayHIDHotplugEvents();
+#endif
+
+    /*-----------------------------------------------------*\
+    | Call detection end callbacks                          |
+    \*-----------------------------------------------------*/
+    for(unsigned int callback_idx = 0; callback_idx < DetectionEndCallbacks.size(); callback_idx++)
+    {
+        DetectionEndCallbacks[callback_idx](DetectionEndCallbackArgs[callback_idx]);
+    }
+
+    LOG_INFO("------------------------------------------------------");
+    LOG_INFO("|                Detection completed                 |");
+    LOG_INFO("------------------------------------------------------");
+
+    LogDetectionTimes(phase_start - detection_start);
+
+    /*-------------------------------------------------*\
+    | If any i2c interfaces failed to detect due to an  |
+    | error condition, show a dialog                    |
+    \*-------------------------------------------------*/
+    if(i2c_interface_fail)
+    {
+        const char* i2c_message =   "<h2>WARNING:</h2>"
+                                    "<p>One or more I2C/SMBus interfaces failed to initialize.</p>"
+                                    "<p>RGB DRAM modules and some motherboards' onboard RGB lighting will not be available without I2C/SMBus.</p>"
+#ifdef _WIN32
+                                    "<p>On Windows, this is usually caused by a failure to load the WinRing0 driver.  "
+                                    "You must run OpenRGB as administrator at least once to allow WinRing0 to set up.</p>"
+#endif
+#ifdef __linux__
+                                    "<p>On Linux, this is usually because the i2c-dev module is not loaded.  "
+                                    "You must load the i2c-dev module along with the correct i2c driver for your motherboard.  "
+                                    "This is usually i2c-piix4 for AMD systems and i2c-i801 for Intel systems.</p>"
+#endif
+                                    "<p>See <a href='https://help.openrgb.org/'>help.openrgb.org</a> for additional troubleshooting steps if you keep seeing this message.<br></p>";
+
+        LOG_DIALOG("%s", i2c_message);
+    }
+
+    /*-------------------------------------------------*\
+    | Background pass.  Devices found here are added to |
+    | the end of the list and saved to the cache.       |
+    \*-------------------------------------------------*/
+    if(run_background)
+    {
+        LOG_INFO("------------------------------------------------------");
+        LOG_INFO("|     Detecting remaining devices in background      |");
+        LOG_INFO("------------------------------------------------------");
+
+        std::chrono::steady_clock::time_point background_start = std::chrono::steady_clock::now();
+
+        detection_pass = DETECTION_PASS_UNCACHED;
+
+        DetectionRegisterMutex.lock();
+        std::vector<RGBController*> cached_controllers = rgb_controllers_hw;
+        DetectionRegisterMutex.unlock();
+
+        RunDetectionLanes(detector_settings, hid_safe_mode, NULL, parallel_detection);
+
+        /*-------------------------------------------------*\
+        | A profile may have been loaded once the cached    |
+        | devices were up, apply it to the devices found    |
+        | in the background as well                         |
+        \*-------------------------------------------------*/
+        std::vector<RGBController*> background_controllers;
+
+        DetectionRegisterMutex.lock();
+
+        for(std::size_t controller_idx = 0; controller_idx < rgb_controllers_hw.size(); controller_idx++)
+        {
+            if(std::find(cached_controllers.begin(), cached_controllers.end(), rgb_controllers_hw[controller_idx]) == cached_controllers.end())
+            {
+                background_controllers.push_back(rgb_controllers_hw[controller_idx]);
+            }
+        }
+
+        DetectionRegisterMutex.unlock();
+
+        profile_manager->LoadLastProfileForControllers(background_controllers);
+
+        if(detection_is_required.load())
+        {
+            SaveDetectionCache();
+        }
+
+        detection_is_required = false;
+        detection_background  = false;
+        detection_string      = "";
+
+        LogDetectionTimes(std::chrono::steady_clock::now() - background_start);
+    }
+}
+
+/*---------------------------------------------------------*\
+| Run the I2C, HID, and other detectors for the current     |
+| pass.  I2C detection runs in parallel with the HID and    |
+| other detectors unless disabled in the settings.          |
+| Detectors within a group still run in order.              |
+\*---------------------------------------------------------*/
+void ResourceManager::RunDetectionLanes(const json & detector_settings, bool hid_safe_mode, hid_device_info* hid_devices, bool parallel_detection)
+{
+    /*-------------------------------------------------*\
+    | HID detectors only run for enumerated devices, so |
+    | they all run in the first pass                    |
+    \*-------------------------------------------------*/
+    bool run_hid = (detection_pass != DETECTION_PASS_UNCACHED);
+
+    /*-------------------------------------------------*\
+    | Many of the other detectors open USB devices      |
+    | through hidapi or libusb as well, so they run     |
+    | after the HID detectors on the same thread.  Only |
+    | I2C detection runs alongside them.                |
+    \*-------------------------------------------------*/
+    if(parallel_detection)
+    {
+        std::thread i2c_thread(&ResourceManager::DetectI2CDevices, this, std::cref(detector_settings));
+
+        if(run_hid)
+        {
+            DetectHIDDevices(hid_safe_mode, hid_devices);
+        }
+
+        DetectOtherDevices(detector_settings);
+
+        i2c_thread.join();
+    }
+    else
+    {
+        DetectI2CDevices(detector_settings);
+
+        if(run_hid)
+        {
+            DetectHIDDevices(hid_safe_mode, hid_devices);
+        }
+
+        DetectOtherDevices(detector_settings);
+    }
+
+    /*-------------------------------------------------*\
+    | Put the detected controllers in a fixed order     |
+    | regardless of which group finished first          |
+    \*-------------------------------------------------*/
+    SortDetectedControllers();
+}
+
+/*---------------------------------------------------------*\
+| Report the time spent in each detection phase             |
+\*---------------------------------------------------------*/
+void ResourceManager::LogDetectionTimes(std::chrono::steady_clock::duration total)
+{
+    DetectionPhaseMutex.lock();
+
+    for(unsigned int phase_idx = 0; phase_idx < detection_phase_times.size(); phase_idx++)
+    {
+        LOG_INFO("Detection time %-20s %8.1f ms", detection_phase_times[phase_idx].first, std::chrono::duration<double, std::milli>(detection_phase_times[phase_idx].second).count());
+    }
+
+    detection_phase_times.clear();
+
+    DetectionPhaseMutex.unlock();
+
+    LOG_INFO("Detection time %-20s %8.1f ms", "Total", std::chrono::duration<double, std::milli>(total).count());
+}
+
+void ResourceManager::DetectI2CDevices(const json & detector_settings)
+{
+    const char*                             detector_name   = "";
+    std::chrono::steady_clock::time_point   phase_start     = std::chrono::steady_clock::now();
+
+    detection_lane = DETECTION_LANE_I2C;
+
+    /*-------------------------------------------------*\
+    | Detect i2c devices                                |
+    \*-------------------------------------------------*/
+    LOG_INFO("------------------------------------------------------");
+    LOG_INFO("|               Detecting I2C devices                |");
+    LOG_INFO("------------------------------------------------------");
+    for(unsigned int i2c_detector_idx = 0; i2c_detector_idx < i2c_device_detectors.size() && detection_is_required.load(); i2c_detector_idx++)
+    {
+        detector_name      = i2c_device_detector_strings[i2c_detector_idx].c_str();
+        detection_string   = detector_name;
+        detection_detector = detector_name;
+
+        /*-------------------------------------------------*\
+        | Check if this detector is enabled                 |
+        \*-------------------------------------------------*/
+        bool this_device_enabled = IsDetectorEnabled(detector_settings, detector_name);
+
+        LOG_DEBUG("[%s] is %s", detector_name, ((this_device_enabled == true) ? "enabled" : "disabled"));
+        if(this_device_enabled && DetectorInPass(detector_name))
+        {
+            DetectionProgressChanged();
+
+            i2c_device_detectors[i2c_detector_idx](busses);
+        }
+
+        LOG_TRACE("[%s] detection end", detector_name);
+
+        /*-------------------------------------------------*\
+        | Update detection percent                          |
+        \*-------------------------------------------------*/
+        DetectionStepDone();
+    }
+
+    EndDetectionPhase("I2C devices", phase_start);
+
+    /*-------------------------------------------------*\
+    | Detect i2c PCI devices                            |
+    \*-------------------------------------------------*/
+    LOG_INFO("------------------------------------------------------");
+    LOG_INFO("|               Detecting I2C PCI devices            |");
+    LOG_INFO("------------------------------------------------------");
+    for(unsigned int i2c_detector_idx = 0; i2c_detector_idx < i2c_pci_device_detectors.size() && detection_is_required.load(); i2c_detector_idx++)
+    {
+        detector_name      = i2c_pci_device_detectors[i2c_detector_idx].name.c_str();
+        detection_string   = detector_name;
+        detection_detector = detector_name;
+
+        /*-------------------------------------------------*\
+        | Check if this detector is enabled                 |
+        \*-------------------------------------------------*/
+        bool this_device_enabled = IsDetectorEnabled(detector_settings, detector_name);
+
+        LOG_DEBUG("[%s] is %s", detector_name, ((this_device_enabled == true) ? "enabled" : "disabled"));
+        if(this_device_enabled && DetectorInPass(detector_name))
+        {
+            DetectionProgressChanged();
+
+            for(unsigned int bus = 0; bus < busses.size(); bus++)
+            {
+                if(busses[bus]->pci_vendor           == i2c_pci_device_detectors[i2c_detector_idx].ven_id    &&
+                   busses[bus]->pci_device           == i2c_pci_device_detectors[i2c_detector_idx].dev_id    &&
                    busses[bus]->pci_subsystem_vendor == i2c_pci_device_detectors[i2c_detector_idx].subven_id &&
                    busses[bus]->pci_subsystem_device == i2c_pci_device_detectors[i2c_detector_idx].subdev_id)
                 {
@@ -1035,15 +1911,258 @@ void ResourceManager::DetectDevicesThreadFunction()
             }
         }
 
-        LOG_TRACE("[%s] detection end", detection_string);
+        LOG_TRACE("[%s] detection end", detector_name);
 
         /*-------------------------------------------------*\
         | Update detection percent                          |
         \*-------------------------------------------------*/
-        percent = (i2c_device_detectors.size() + i2c_detector_idx + 1.0f) / percent_denominator;
+        DetectionStepDone();
+    }
+
+    EndDetectionPhase("I2C PCI devices", phase_start);
+
+    detection_lane      = DETECTION_LANE_NONE;
+    detection_detector  = nullptr;
+}
+
+/*---------------------------------------------------------*\
+| Run the HID detectors registered for a device's VID/PID   |
+| whose interface and usage information also match          |
+\*---------------------------------------------------------*/
+void ResourceManager::RunHIDDetectors(hid_device_info* hid_device)
+{
+    const char* detector_name = "";
+
+    unsigned int addr = (hid_device->vendor_id << 16) | hid_device->product_id;
+
+    HIDDetectorIndexEntry key;
+    key.address = addr;
+
+    detection_hid_path = hid_device->path;
+
+    /*-----------------------------------------------------------------------------*\
+    | Look up the detectors registered for this VID/PID.  If the interface and      |
+    | usage information also matches, run the detector                              |
+    \*-----------------------------------------------------------------------------*/
+    std::pair<std::vector<HIDDetectorIndexEntry>::iterator, std::vector<HIDDetectorIndexEntry>::iterator> range;
+
+    range = std::equal_range(hid_device_detector_index.begin(), hid_device_detector_index.end(), key, HIDDetectorIndexLess);
+
+    for(std::vector<HIDDetectorIndexEntry>::iterator it = range.first; it != range.second; it++)
+    {
+        unsigned int hid_detector_idx = it->detector_idx;
+
+#ifdef USE_HID_USAGE
+        if(HIDDetectorMatches(hid_device_detectors[hid_detector_idx], hid_device, true))
+#else
+        if(HIDDetectorMatches(hid_device_detectors[hid_detector_idx], hid_device, false))
+#endif
+        {
+            detector_name      = hid_device_detectors[hid_detector_idx].name.c_str();
+            detection_string   = detector_name;
+            detection_detector = detector_name;
+
+            bool this_device_enabled = hid_device_detector_enabled[hid_detector_idx];
+
+            LOG_DEBUG("[%s] is %s", detector_name, ((this_device_enabled == true) ? "enabled" : "disabled"));
+
+            if(this_device_enabled)
+            {
+                DetectionProgressChanged();
+
+                hid_device_detectors[hid_detector_idx].function(hid_device, hid_device_detectors[hid_detector_idx].name);
+            }
+        }
+    }
+
+    /*-----------------------------------------------------------------------------*\
+    | Look up the wrapped HID detectors registered for this VID/PID.  If the        |
+    | interface and usage information also matches, run the detector                |
+    \*-----------------------------------------------------------------------------*/
+    range = std::equal_range(hid_wrapped_device_detector_index.begin(), hid_wrapped_device_detector_index.end(), key, HIDDetectorIndexLess);
+
+    for(std::vector<HIDDetectorIndexEntry>::iterator it = range.first; it != range.second; it++)
+    {
+        unsigned int hid_detector_idx = it->detector_idx;
+
+#ifdef USE_HID_USAGE
+        if(HIDDetectorMatches(hid_wrapped_device_detectors[hid_detector_idx], hid_device, true))
+#else
+        if(HIDDetectorMatches(hid_wrapped_device_detectors[hid_detector_idx], hid_device, false))
+#endif
+        {
+            detector_name      = hid_wrapped_device_detectors[hid_detector_idx].name.c_str();
+            detection_string   = detector_name;
+            detection_detector = detector_name;
+
+            bool this_device_enabled = hid_wrapped_device_detector_enabled[hid_detector_idx];
+
+            LOG_DEBUG("[%s] is %s", detector_name, ((this_device_enabled == true) ? "enabled" : "disabled"));
+
+            if(this_device_enabled)
+            {
+                DetectionProgressChanged();
+
+                hid_wrapped_device_detectors[hid_detector_idx].function(default_wrapper, hid_device, hid_wrapped_device_detectors[hid_detector_idx].name);
+            }
+        }
+    }
+
+    detection_hid_path = nullptr;
+}
+
+#ifdef __linux__
+/*---------------------------------------------------------*\
+| Check whether a controller location refers to a device    |
+| node, without matching /dev/hidraw1 to /dev/hidraw10      |
+\*---------------------------------------------------------*/
+static bool LocationMatchesDeviceNode(const std::string & location, const std::string & node)
+{
+    std::string::size_type pos = location.find(node);
+
+    while(pos != std::string::npos)
+    {
+        std::string::size_type end = pos + node.size();
+
+        if((end == location.size()) || !isdigit((unsigned char)location[end]))
+        {
+            return(true);
+        }
+
+        pos = location.find(node, pos + 1);
+    }
+
+    return(false);
+}
+
+void ResourceManager::HIDHotplugEvent(int event, const std::string & node)
+{
+    std::lock_guard<std::mutex> hotplug_lock(HIDHotplugMutex);
+
+    /*-------------------------------------------------*\
+    | A full detection may already have enumerated HID  |
+    | devices, so queue the event until it ends.  Keep  |
+    | queueing until the queue has been replayed so     |
+    | events stay in order.  The background pass does   |
+    | not run HID detectors.                            |
+    \*-------------------------------------------------*/
+    if((detection_is_required.load() && !detection_background.load()) || !hid_hotplug_pending.empty())
+    {
+        LOG_DEBUG("[HID Hotplug] Queueing %s until detection ends", node.c_str());
+        hid_hotplug_pending.push_back(std::make_pair(event, node));
+        return;
+    }
+
+    HandleHIDHotplugEvent(event, node);
+}
+
+/*---------------------------------------------------------*\
+| Handle the hotplug events that arrived during detection,  |
+| in the order they were received                           |
+\*---------------------------------------------------------*/
+void ResourceManager::ReplayHIDHotplugEvents()
+{
+    std::lock_guard<std::mutex> hotplug_lock(HIDHotplugMutex);
+
+    while(!hid_hotplug_pending.empty())
+    {
+        std::pair<int, std::string> pending = hid_hotplug_pending.front();
+
+        hid_hotplug_pending.pop_front();
+
+        HandleHIDHotplugEvent(pending.first, pending.second);
+    }
+}
+
+/*---------------------------------------------------------*\
+| Handle a hidraw node being added or removed.  Only the    |
+| HID detectors for the new device are run, and only the    |
+| controllers using a removed node are unregistered, so     |
+| other devices are left untouched.  Called with the        |
+| hotplug lock held.                                        |
+\*---------------------------------------------------------*/
+void ResourceManager::HandleHIDHotplugEvent(int event, const std::string & node)
+{
+    std::vector<RGBController*> node_controllers;
+
+    DetectionRegisterMutex.lock();
+
+    for(unsigned int hw_controller_idx = 0; hw_controller_idx < rgb_controllers_hw.size(); hw_controller_idx++)
+    {
+        if(LocationMatchesDeviceNode(rgb_controllers_hw[hw_controller_idx]->location, node))
+        {
+            node_controllers.push_back(rgb_controllers_hw[hw_controller_idx]);
+        }
+    }
+
+    /*-------------------------------------------------*\
+    | Not every controller puts the device node in its  |
+    | location, fall back to the HID path it was        |
+    | detected on                                       |
+    \*-------------------------------------------------*/
+    if(node_controllers.empty())
+    {
+        for(std::map<RGBController*, std::string>::iterator it = detection_controller_hid_paths.begin(); it != detection_controller_hid_paths.end(); it++)
+        {
+            if(it->second == node)
+            {
+                node_controllers.push_back(it->first);
+            }
+        }
+    }
+
+    DetectionRegisterMutex.unlock();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    if(event == HID_HOTPLUG_ADDED)
+    {
+        /*-------------------------------------------------*\
+        | Skip nodes that already have a controller         |
+        \*-------------------------------------------------*/
+        if(!node_controllers.empty())
+        {
+            return;
+        }
 
-        detection_percent = percent * 100.0f;
+        hid_device_info* hid_devices = hid_enumerate(0, 0);
+
+        for(hid_device_info* hid_device = hid_devices; hid_device; hid_device = hid_device->next)
+        {
+            if((hid_device->path != NULL) && (node == hid_device->path))
+            {
+                RunHIDDetectors(hid_device);
+            }
+        }
+
+        hid_free_enumeration(hid_devices);
+
+        detection_string    = "";
+        detection_detector  = nullptr;
+
+        LOG_INFO("[HID Hotplug] %s added in %.1f ms", node.c_str(), std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    else if(event == HID_HOTPLUG_REMOVED)
+    {
+        for(unsigned int controller_idx = 0; controller_idx < node_controllers.size(); controller_idx++)
+        {
+            UnregisterRGBController(node_controllers[controller_idx]);
+
+            delete node_controllers[controller_idx];
+        }
+
+        LOG_INFO("[HID Hotplug] %s removed in %.1f ms", node.c_str(), std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
     }
+}
+#endif
+
+void ResourceManager::DetectHIDDevices(bool hid_safe_mode, hid_device_info* hid_devices)
+{
+    hid_device_info*                        current_hid_device;
+    const char*                             detector_name   = "";
+    std::chrono::steady_clock::time_point   phase_start     = std::chrono::steady_clock::now();
+
+    detection_lane = DETECTION_LANE_HID;
 
     /*-------------------------------------------------*\
     | Detect HID devices                                |
@@ -1089,19 +2208,13 @@ void ResourceManager::DetectDevicesThreadFunction()
 #endif
                 )
                 {
-                    detection_string = hid_device_detectors[hid_detector_idx].name.c_str();
-
-                    /*-------------------------------------------------*\
-                    | Check if this detector is enabled or needs to be  |
-                    | added to the settings list                        |
-                    \*-------------------------------------------------*/
-                    bool this_device_enabled = true;
-                    if(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detection_string))
-                    {
-                        this_device_enabled = detector_settings["detectors"][detection_string];
-                    }
+                    detector_name      = hid_device_detectors[hid_detector_idx].name.c_str();
+                    detection_string   = detector_name;
+                    detection_detector = detector_name;
 
-                    LOG_DEBUG("[%s] is %s", detection_string, ((this_device_enabled == true) ? "enabled" : "disabled"));
+                    bool this_device_enabled = hid_device_detector_enabled[hid_detector_idx];
+
+                    LOG_DEBUG("[%s] is %s", detector_name, ((this_device_enabled == true) ? "enabled" : "disabled"));
 
                     if(this_device_enabled)
                     {
@@ -1109,7 +2222,7 @@ void ResourceManager::DetectDevicesThreadFunction()
 
                         hid_device_detectors[hid_detector_idx].function(current_hid_device, hid_device_detectors[hid_detector_idx].name);
 
-                        LOG_TRACE("[%s] detection end", detection_string);
+                        LOG_TRACE("[%s] detection end", detector_name);
                     }
                 }
 
@@ -1125,9 +2238,7 @@ void ResourceManager::DetectDevicesThreadFunction()
         | Iterate through all devices in list and run       |
         | detectors                                         |
         \*-------------------------------------------------*/
-        hid_device_count = 0;
-
-        while(current_hid_device)
+        while(current_hid_device && detection_is_required.load())
         {
             if(LogManager::get()->getLoglevel() >= LL_DEBUG)
             {
@@ -1135,105 +2246,17 @@ void ResourceManager::DetectDevicesThreadFunction()
                 const char* prod_name = wchar_to_char(current_hid_device->product_string);
                 LOG_DEBUG("[%04X:%04X U=%04X P=0x%04X I=%d] %-25s - %s", current_hid_device->vendor_id, current_hid_device->product_id, current_hid_device->usage, current_hid_device->usage_page, current_hid_device->interface_number, manu_name, prod_name);
             }
-            detection_string = "";
+            detector_name      = "";
+            detection_string   = detector_name;
+            detection_detector = detector_name;
             DetectionProgressChanged();
 
-            unsigned int addr = (current_hid_device->vendor_id << 16) | current_hid_device->product_id;
-
-            /*-----------------------------------------------------------------------------*\
-            | Loop through all available detectors.  If all required information matches,   |
-            | run the detector                                                              |
-            \*-----------------------------------------------------------------------------*/
-            for(unsigned int hid_detector_idx = 0; hid_detector_idx < hid_device_detectors.size() && detection_is_required.load(); hid_detector_idx++)
-            {
-                if(( (     hid_device_detectors[hid_detector_idx].address    == addr                                 ) )
-#ifdef USE_HID_USAGE
-                && ( (     hid_device_detectors[hid_detector_idx].usage_page == HID_USAGE_PAGE_ANY                   )
-                  || (     hid_device_detectors[hid_detector_idx].usage_page == current_hid_device->usage_page       ) )
-                && ( (     hid_device_detectors[hid_detector_idx].usage      == HID_USAGE_ANY                        )
-                  || (     hid_device_detectors[hid_detector_idx].usage      == current_hid_device->usage            ) )
-                && ( (     hid_device_detectors[hid_detector_idx].interface  == HID_INTERFACE_ANY                    )
-                  || (     hid_device_detectors[hid_detector_idx].interface  == current_hid_device->interface_number ) )
-#else
-                && ( (     hid_device_detectors[hid_detector_idx].interface  == HID_INTERFACE_ANY                    )
-                  || (     hid_device_detectors[hid_detector_idx].interface  == current_hid_device->interface_number ) )
-#endif
-                )
-                {
-                    detection_string = hid_device_detectors[hid_detector_idx].name.c_str();
-
-                    /*-------------------------------------------------*\
-                    | Check if this detector is enabled or needs to be  |
-                    | added to the settings list                        |
-                    \*-------------------------------------------------*/
-                    bool this_device_enabled = true;
-                    if(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detection_string))
-                    {
-                        this_device_enabled = detector_settings["detectors"][detection_string];
-                    }
-
-                    LOG_DEBUG("[%s] is %s", detection_string, ((this_device_enabled == true) ? "enabled" : "disabled"));
-
-                    if(this_device_enabled)
-                    {
-                        DetectionProgressChanged();
-
-                        hid_device_detectors[hid_detector_idx].function(current_hid_device, hid_device_detectors[hid_detector_idx].name);
-                    }
-                }
-            }
-
-            /*-----------------------------------------------------------------------------*\
-            | Loop through all available wrapped HID detectors.  If all required            |
-            | information matches, run the detector                                         |
-            \*-----------------------------------------------------------------------------*/
-            for(unsigned int hid_detector_idx = 0; hid_detector_idx < hid_wrapped_device_detectors.size() && detection_is_required.load(); hid_detector_idx++)
-            {
-                if(( (     hid_wrapped_device_detectors[hid_detector_idx].address    == addr                                 ) )
-#ifdef USE_HID_USAGE
-                && ( (     hid_wrapped_device_detectors[hid_detector_idx].usage_page == HID_USAGE_PAGE_ANY                   )
-                  || (     hid_wrapped_device_detectors[hid_detector_idx].usage_page == current_hid_device->usage_page       ) )
-                && ( (     hid_wrapped_device_detectors[hid_detector_idx].usage      == HID_USAGE_ANY                        )
-                  || (     hid_wrapped_device_detectors[hid_detector_idx].usage      == current_hid_device->usage            ) )
-                && ( (     hid_wrapped_device_detectors[hid_detector_idx].interface  == HID_INTERFACE_ANY                    )
-                  || (     hid_wrapped_device_detectors[hid_detector_idx].interface  == current_hid_device->interface_number ) )
-#else
-                && ( (     hid_wrapped_device_detectors[hid_detector_idx].interface  == HID_INTERFACE_ANY                    )
-                  || (     hid_wrapped_device_detectors[hid_detector_idx].interface  == current_hid_device->interface_number ) )
-#endif
-                )
-                {
-                    detection_string = hid_wrapped_device_detectors[hid_detector_idx].name.c_str();
-
-                    /*-------------------------------------------------*\
-                    | Check if this detector is enabled or needs to be  |
-                    | added to the settings list                        |
-                    \*-------------------------------------------------*/
-                    bool this_device_enabled = true;
-                    if(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detection_string))
-                    {
-                        this_device_enabled = detector_settings["detectors"][detection_string];
-                    }
-
-                    LOG_DEBUG("[%s] is %s", detection_string, ((this_device_enabled == true) ? "enabled" : "disabled"));
-
-                    if(this_device_enabled)
-                    {
-                        DetectionProgressChanged();
-
-                        hid_wrapped_device_detectors[hid_detector_idx].function(default_wrapper, current_hid_device, hid_wrapped_device_detectors[hid_detector_idx].name);
-                    }
-                }
-            }
+            RunHIDDetectors(current_hid_device);
 
             /*-------------------------------------------------*\
             | Update detection percent                          |
             \*-------------------------------------------------*/
-            hid_device_count++;
-
-            percent = (i2c_device_detectors.size() + i2c_pci_device_detectors.size() + hid_device_count) / percent_denominator;
-
-            detection_percent = percent * 100.0f;
+            DetectionStepDone();
 
             /*-------------------------------------------------*\
             | Move on to the next HID device                    |
@@ -1247,6 +2270,8 @@ void ResourceManager::DetectDevicesThreadFunction()
         hid_free_enumeration(hid_devices);
     }
 
+    EndDetectionPhase("HID devices", phase_start);
+
     /*-------------------------------------------------*\
     | Detect HID devices                                |
     |                                                   |
@@ -1293,8 +2318,6 @@ void ResourceManager::DetectDevicesThreadFunction()
         | Iterate through all devices in list and run       |
         | detectors                                         |
         \*-------------------------------------------------*/
-        hid_device_count = 0;
-
         while(current_hid_device)
         {
             if(LogManager::get()->getLoglevel() >= LL_DEBUG)
@@ -1303,39 +2326,37 @@ void ResourceManager::DetectDevicesThreadFunction()
                 const char* prod_name = wchar_to_char(current_hid_device->product_string);
                 LOG_DEBUG("[%04X:%04X U=%04X P=0x%04X I=%d] %-25s - %s", current_hid_device->vendor_id, current_hid_device->product_id, current_hid_device->usage, current_hid_device->usage_page, current_hid_device->interface_number, manu_name, prod_name);
             }
-            detection_string = "";
+            detector_name      = "";
+            detection_string   = detector_name;
+            detection_detector = detector_name;
             DetectionProgressChanged();
 
             unsigned int addr = (current_hid_device->vendor_id << 16) | current_hid_device->product_id;
 
+            HIDDetectorIndexEntry key;
+            key.address = addr;
+
             /*-----------------------------------------------------------------------------*\
-            | Loop through all available wrapped HID detectors.  If all required            |
-            | information matches, run the detector                                         |
+            | Look up the wrapped HID detectors registered for this VID/PID.  If the        |
+            | interface and usage information also matches, run the detector                |
             \*-----------------------------------------------------------------------------*/
-            for(unsigned int hid_detector_idx = 0; hid_detector_idx < hid_wrapped_device_detectors.size() && detection_is_required.load(); hid_detector_idx++)
+            std::pair<std::vector<HIDDetectorIndexEntry>::iterator, std::vector<HIDDetectorIndexEntry>::iterator> range;
+
+            range = std::equal_range(hid_wrapped_device_detector_index.begin(), hid_wrapped_device_detector_index.end(), key, HIDDetectorIndexLess);
+
+            for(std::vector<HIDDetectorIndexEntry>::iterator it = range.first; it != range.second && detection_is_required.load(); it++)
             {
-                if(( (     hid_wrapped_device_detectors[hid_detector_idx].address    == addr                                 ) )
-                && ( (     hid_wrapped_device_detectors[hid_detector_idx].usage_page == HID_USAGE_PAGE_ANY                   )
-                    || (     hid_wrapped_device_detectors[hid_detector_idx].usage_page == current_hid_device->usage_page       ) )
-                && ( (     hid_wrapped_device_detectors[hid_detector_idx].usage      == HID_USAGE_ANY                        )
-                    || (     hid_wrapped_device_detectors[hid_detector_idx].usage      == current_hid_device->usage            ) )
-                && ( (     hid_wrapped_device_detectors[hid_detector_idx].interface  == HID_INTERFACE_ANY                    )
-                    || (     hid_wrapped_device_detectors[hid_detector_idx].interface  == current_hid_device->interface_number ) )
-                )
+                unsigned int hid_detector_idx = it->detector_idx;
+
+                if(HIDDetectorMatches(hid_wrapped_device_detectors[hid_detector_idx], current_hid_device, true))
                 {
-                    detection_string = hid_wrapped_device_detectors[hid_detector_idx].name.c_str();
-
-                    /*-------------------------------------------------*\
-                    | Check if this detector is enabled or needs to be  |
-                    | added to the settings list                        |
-                    \*-------------------------------------------------*/
-                    bool this_device_enabled = true;
-                    if(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detection_string))
-                    {
-                        this_device_enabled = detector_settings["detectors"][detection_string];
-                    }
+                    detector_name      = hid_wrapped_device_detectors[hid_detector_idx].name.c_str();
+                    detection_string   = detector_name;
+                    detection_detector = detector_name;
+
+                    bool this_device_enabled = hid_wrapped_device_detector_enabled[hid_detector_idx];
 
-                    LOG_DEBUG("[%s] is %s", detection_string, ((this_device_enabled == true) ? "enabled" : "disabled"));
+                    LOG_DEBUG("[%s] is %s", detector_name, ((this_device_enabled == true) ? "enabled" : "disabled"));
 
                     if(this_device_enabled)
                     {
@@ -1349,11 +2370,7 @@ void ResourceManager::DetectDevicesThreadFunction()
             /*-------------------------------------------------*\
             | Update detection percent                          |
             \*-------------------------------------------------*/
-            hid_device_count++;
-
-            percent = (i2c_device_detectors.size() + i2c_pci_device_detectors.size() + hid_device_count) / percent_denominator;
-
-            detection_percent = percent * 100.0f;
+            DetectionStepDone();
 
             /*-------------------------------------------------*\
             | Move on to the next HID device                    |
@@ -1366,8 +2383,21 @@ void ResourceManager::DetectDevicesThreadFunction()
         \*-------------------------------------------------*/
         wrapper.hid_free_enumeration(hid_devices);
     }
+
+    EndDetectionPhase("libusb HID devices", phase_start);
 #endif
 
+    detection_lane      = DETECTION_LANE_NONE;
+    detection_detector  = nullptr;
+}
+
+void ResourceManager::DetectOtherDevices(const json & detector_settings)
+{
+    const char*                             detector_name   = "";
+    std::chrono::steady_clock::time_point   phase_start     = std::chrono::steady_clock::now();
+
+    detection_lane = DETECTION_LANE_OTHER;
+
     /*-------------------------------------------------*\
     | Detect other devices                              |
     \*-------------------------------------------------*/
@@ -1377,82 +2407,36 @@ void ResourceManager::DetectDevicesThreadFunction()
 
     for(unsigned int detector_idx = 0; detector_idx < device_detectors.size() && detection_is_required.load(); detector_idx++)
     {
-        detection_string = device_detector_strings[detector_idx].c_str();
+        detector_name      = device_detector_strings[detector_idx].c_str();
+        detection_string   = detector_name;
+        detection_detector = detector_name;
 
         /*-------------------------------------------------*\
         | Check if this detector is enabled                 |
         \*-------------------------------------------------*/
-        bool this_device_enabled = true;
-        if(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detection_string))
-        {
-            this_device_enabled = detector_settings["detectors"][detection_string];
-        }
+        bool this_device_enabled = IsDetectorEnabled(detector_settings, detector_name);
 
-        LOG_DEBUG("[%s] is %s", detection_string, ((this_device_enabled == true) ? "enabled" : "disabled"));
+        LOG_DEBUG("[%s] is %s", detector_name, ((this_device_enabled == true) ? "enabled" : "disabled"));
 
-        if(this_device_enabled)
+        if(this_device_enabled && DetectorInPass(detector_name))
         {
             DetectionProgressChanged();
 
             device_detectors[detector_idx]();
         }
 
-        LOG_TRACE("[%s] detection end", detection_string);
+        LOG_TRACE("[%s] detection end", detector_name);
 
         /*-------------------------------------------------*\
         | Update detection percent                          |
         \*-------------------------------------------------*/
-        percent = (i2c_device_detectors.size() + hid_device_count + detector_idx + 1.0f) / percent_denominator;
-
-        detection_percent = percent * 100.0f;
-    }
-
-    /*-------------------------------------------------*\
-    | Make sure that when the detection is done,        |
-    | progress bar is set to 100%                       |
-    \*-------------------------------------------------*/
-    detection_is_required = false;
-    detection_percent = 100;
-    detection_string = "";
-
-    DetectionProgressChanged();
-
-    DetectDeviceMutex.unlock();
-
-    /*-----------------------------------------------------*\
-    | Call detection end callbacks                          |
-    \*-----------------------------------------------------*/
-    for(unsigned int callback_idx = 0; callback_idx < DetectionEndCallbacks.size(); callback_idx++)
-    {
-        DetectionEndCallbacks[callback_idx](DetectionEndCallbackArgs[callback_idx]);
+        DetectionStepDone();
     }
 
-    LOG_INFO("------------------------------------------------------");
-    LOG_INFO("|                Detection completed                 |");
-    LOG_INFO("------------------------------------------------------");
-
-    /*-------------------------------------------------*\
-    | If any i2c interfaces failed to detect due to an  |
-    | error condition, show a dialog                    |
-    \*-------------------------------------------------*/
-    if(i2c_interface_fail)
-    {
-        const char* i2c_message =   "<h2>WARNING:</h2>"
-                                    "<p>One or more I2C/SMBus interfaces failed to initialize.</p>"
-                                    "<p>RGB DRAM modules and some motherboards' onboard RGB lighting will not be available without I2C/SMBus.</p>"
-#ifdef _WIN32
-                                    "<p>On Windows, this is usually caused by a failure to load the WinRing0 driver.  "
-                                    "You must run OpenRGB as administrator at least once to allow WinRing0 to set up.</p>"
-#endif
-#ifdef __linux__
-                                    "<p>On Linux, this is usually because the i2c-dev module is not loaded.  "
-                                    "You must load the i2c-dev module along with the correct i2c driver for your motherboard.  "
-                                    "This is usually i2c-piix4 for AMD systems and i2c-i801 for Intel systems.</p>"
-#endif
-                                    "<p>See <a href='https://help.openrgb.org/'>help.openrgb.org</a> for additional troubleshooting steps if you keep seeing this message.<br></p>";
+    EndDetectionPhase("Other devices", phase_start);
 
-        LOG_DIALOG("%s", i2c_message);
-    }
+    detection_lane      = DETECTION_LANE_NONE;
+    detection_detector  = nullptr;
 }
 
 void ResourceManager::StopDeviceDetection()
@@ -1467,6 +2451,7 @@ void ResourceManager::UpdateDetectorSettings()
 {
     json                detector_settings;
     bool                save_settings       = false;
+    const char*         detector_name       = "";
 
     /*-------------------------------------------------*\
     | Open device disable list and read in disabled     |
@@ -1480,11 +2465,11 @@ void ResourceManager::UpdateDetectorSettings()
     \*-------------------------------------------------*/
     for(unsigned int i2c_detector_idx = 0; i2c_detector_idx < i2c_device_detectors.size(); i2c_detector_idx++)
     {
-        detection_string = i2c_device_detector_strings[i2c_detector_idx].c_str();
+        detector_name = i2c_device_detector_strings[i2c_detector_idx].c_str();
 
-        if(!(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detection_string)))
+        if(!(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detector_name)))
         {
-            detector_settings["detectors"][detection_string] = true;
+            detector_settings["detectors"][detector_name] = true;
             save_settings = true;
         }
     }
@@ -1495,11 +2480,11 @@ void ResourceManager::UpdateDetectorSettings()
     \*-------------------------------------------------*/
     for(unsigned int i2c_pci_detector_idx = 0; i2c_pci_detector_idx < i2c_pci_device_detectors.size(); i2c_pci_detector_idx++)
     {
-        detection_string = i2c_pci_device_detectors[i2c_pci_detector_idx].name.c_str();
+        detector_name = i2c_pci_device_detectors[i2c_pci_detector_idx].name.c_str();
 
-        if(!(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detection_string)))
+        if(!(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detector_name)))
         {
-            detector_settings["detectors"][detection_string] = true;
+            detector_settings["detectors"][detector_name] = true;
             save_settings = true;
         }
     }
@@ -1510,11 +2495,11 @@ void ResourceManager::UpdateDetectorSettings()
     \*-------------------------------------------------*/
     for(unsigned int hid_detector_idx = 0; hid_detector_idx < hid_device_detectors.size(); hid_detector_idx++)
     {
-        detection_string = hid_device_detectors[hid_detector_idx].name.c_str();
+        detector_name = hid_device_detectors[hid_detector_idx].name.c_str();
 
-        if(!(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detection_string)))
+        if(!(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detector_name)))
         {
-            detector_settings["detectors"][detection_string] = true;
+            detector_settings["detectors"][detector_name] = true;
             save_settings = true;
         }
     }
@@ -1525,21 +2510,21 @@ void ResourceManager::UpdateDetectorSettings()
     \*-------------------------------------------------*/
     for(unsigned int detector_idx = 0; detector_idx < device_detectors.size(); detector_idx++)
     {
-        detection_string = device_detector_strings[detector_idx].c_str();
+        detector_name = device_detector_strings[detector_idx].c_str();
 
-        if(!(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detection_string)))
+        if(!(detector_settings.contains("detectors") && detector_settings["detectors"].contains(detector_name)))
         {
             /*-------------------------------------------------*\
             | Default the OpenRazer detector to disabled, as it |
             | overrides RazerController when enabled            |
             \*-------------------------------------------------*/
-            if(strcmp(detection_string, "OpenRazer") == 0 || strcmp(detection_string, "OpenRazer-Win32") == 0)
+            if(strcmp(detector_name, "OpenRazer") == 0 || strcmp(detector_name, "OpenRazer-Win32") == 0)
             {
-                detector_settings["detectors"][detection_string] = false;
+                detector_settings["detectors"][detector_name] = false;
             }
             else
             {
-                detector_settings["detectors"][detection_string] = true;
+                detector_settings["detectors"][detector_name] = true;
             }
             save_settings = true;
         }
@@ -11,13 +11,22 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <set>
 #include <vector>
 #include <functional>
 #include <thread>
 #include <string>
 
 #include "hidapi_wrapper.h"
+#ifdef __linux__
+#include "hid_hotplug_monitor.h"
+#endif
 #include "i2c_smbus.h"
 #include "NetworkClient.h"
 #include "NetworkServer.h"
@@ -63,6 +72,12 @@ typedef struct
     int                                 usage;
 } HIDWrappedDeviceDetectorBlock;
 
+typedef struct
+{
+    unsigned int                        address;
+    unsigned int                        detector_idx;
+} HIDDetectorIndexEntry;
+
 typedef struct
 {
     std::string                     name;
@@ -135,6 +150,15 @@ public:
 
     std::vector<RGBController*> & GetRGBControllers();
 
+    /*-----------------------------------------------------*\
+    | Update transactions.  Between Begin and Commit, LED   |
+    | and mode updates on the given controllers are queued, |
+    | then all of them are released to flush at a common    |
+    | time.                                                 |
+    \*-----------------------------------------------------*/
+    void BeginUpdateTransaction(std::vector<RGBController*> & controllers);
+    void CommitUpdateTransaction(std::vector<RGBController*> & controllers);
+
     void RegisterI2CBusDetector         (I2CBusDetectorFunction     detector);
     void RegisterDeviceDetector         (std::string name, DeviceDetectorFunction     detector);
     void RegisterI2CDeviceDetector      (std::string name, I2CDeviceDetectorFunction  detector);
@@ -204,6 +228,26 @@ public:
 
 private:
     void DetectDevicesThreadFunction();
+    void DetectI2CDevices(const json & detector_settings);
+    void DetectHIDDevices(bool hid_safe_mode, hid_device_info* hid_devices);
+    void DetectOtherDevices(const json & detector_settings);
+    void RunDetectionLanes(const json & detector_settings, bool hid_safe_mode, hid_device_info* hid_devices, bool parallel_detection);
+    bool DetectorInPass(const char* name);
+    bool LoadDetectionCache();
+    unsigned int ValidateDetectionCache();
+    void SaveDetectionCache();
+    void LogDetectionTimes(std::chrono::steady_clock::duration total);
+    void DetectionStepDone();
+    void EndDetectionPhase(const char* phase, std::chrono::steady_clock::time_point & phase_start);
+    void SortDetectedControllers();
+    void BuildHIDDetectorIndex(json & detector_settings);
+    void ApplyUpdateRateLimit(RGBController* rgb_controller);
+    void RunHIDDetectors(hid_device_info* hid_device);
+#ifdef __linux__
+    void HIDHotplugEvent(int event, const std::string & node);
+    void HandleHIDHotplugEvent(int event, const std::string & node);
+    void ReplayHIDHotplugEvents();
+#endif
     void UpdateDetectorSettings();
     void SetupConfigurationDirectory();
 
@@ -266,6 +310,24 @@ private:
 
     bool                                        dynamic_detectors_processed;
 
+    /*-------------------------------------------------------------------------------------*\
+    | HID detector index, sorted by VID/PID, and detector enable flags resolved from the    |
+    | settings at the start of each detection run                                           |
+    \*-------------------------------------------------------------------------------------*/
+    std::vector<HIDDetectorIndexEntry>          hid_device_detector_index;
+    std::vector<HIDDetectorIndexEntry>          hid_wrapped_device_detector_index;
+    std::vector<bool>                           hid_device_detector_enabled;
+    std::vector<bool>                           hid_wrapped_device_detector_enabled;
+
+    /*-------------------------------------------------------------------------------------*\
+    | HID hotplug monitor                                                                   |
+    \*-------------------------------------------------------------------------------------*/
+    std::mutex                                  HIDHotplugMutex;
+#ifdef __linux__
+    hid_hotplug_monitor                         hid_hotplug;
+    std::deque<std::pair<int, std::string>>     hid_hotplug_pending;
+#endif
+
     /*-------------------------------------------------------------------------------------*\
     | Detection Thread and Detection State                                                  |
     \*-------------------------------------------------------------------------------------*/
@@ -276,8 +338,30 @@ private:
     std::atomic<unsigned int>                   detection_percent;
     std::atomic<unsigned int>                   detection_prev_size;
     std::vector<bool>                           detection_size_entry_used;
-    const char*                                 detection_string;
+    std::atomic<const char*>                    detection_string;
+    std::atomic<bool>                           detection_background;
+    std::atomic<unsigned int>                   detection_steps_done;
+    float                                       detection_steps_total;
+
+    /*-------------------------------------------------------------------------------------*\
+    | Detector groups run in parallel.  Controllers registered by each group are tracked    |
+    | so the final list order does not depend on which group finished first.                |
+    \*-------------------------------------------------------------------------------------*/
+    std::mutex                                  DetectionRegisterMutex;
+    std::vector<std::vector<RGBController*>>    detection_lane_controllers;
+
+    std::mutex                                  DetectionPhaseMutex;
+    std::vector<std::pair<const char*, std::chrono::steady_clock::duration>> detection_phase_times;
 
+    /*-------------------------------------------------------------------------------------*\
+    | Detection cache.  The detector that registered each controller is recorded so the     |
+    | next detection can run those detectors first and the rest afterwards.                 |
+    \*-------------------------------------------------------------------------------------*/
+    std::map<RGBController*, std::string>       detection_controller_detectors;
+    std::map<RGBController*, std::string>       detection_controller_hid_paths;
+    json                                        detection_cache;
+    std::set<std::string>                       detection_cache_detectors;
+    int                                         detection_pass;
 
     /*-------------------------------------------------------------------------------------*\
     | Device List Changed Callback                                                          |
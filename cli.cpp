@@ -752,32 +752,16 @@ bool OptionSize(std::vector<DeviceOptions>* current_devices, std::string argumen
     return true;
 }
 
-bool OptionProfile(std::string argument, std::vector<RGBController *>& rgb_controllers)
+bool OptionProfile(std::string argument, std::vector<RGBController *>& /*rgb_controllers*/)
 {
     ResourceManager::get()->WaitForDeviceDetection();
 
     /*---------------------------------------------------------*\
-    | Attempt to load profile                                   |
+    | Attempt to load profile.  LoadProfile queues the mode and |
+    | LED updates itself, so all devices change together        |
     \*---------------------------------------------------------*/
     if(ResourceManager::get()->GetProfileManager()->LoadProfile(argument))
     {
-        /*-----------------------------------------------------*\
-        | Change device mode if profile loading was successful  |
-        \*-----------------------------------------------------*/
-        for(std::size_t controller_idx = 0; controller_idx < rgb_controllers.size(); controller_idx++)
-        {
-            RGBController* device = rgb_controllers[controller_idx];
-
-            device->DeviceUpdateMode();
-            LOG_DEBUG("Updating mode for %s to %i", device->name.c_str(), device->active_mode);
-
-            if(device->modes[device->active_mode].color_mode == MODE_COLORS_PER_LED)
-            {
-                device->DeviceUpdateLEDs();
-                LOG_DEBUG("Mode uses per-LED color, also updating LEDs");
-            }
-        }
-
         std::cout << "Profile loaded successfully" << std::endl;
         return true;
     }
@@ -0,0 +1,49 @@
+/*-----------------------------------------*\
+|  hid_hotplug_monitor.h                    |
+|                                           |
+|  Watches the kernel uevent netlink socket |
+|  for hidraw nodes being added or removed  |
+|  (Linux only)                             |
+\*-----------------------------------------*/
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+enum
+{
+    HID_HOTPLUG_ADDED,
+    HID_HOTPLUG_REMOVED
+};
+
+/*-----------------------------------------------------*\
+| Called from the monitor thread with the event type    |
+| and the device node, such as /dev/hidraw3             |
+\*-----------------------------------------------------*/
+typedef std::function<void(int, const std::string&)>   hid_hotplug_callback;
+
+class hid_hotplug_monitor
+{
+public:
+    hid_hotplug_monitor();
+    ~hid_hotplug_monitor();
+
+    bool start(hid_hotplug_callback callback);
+    void stop();
+
+    bool is_running();
+
+private:
+    void monitor_thread_function();
+    void process_uevent(const char* buf, int len, bool from_udev);
+
+    hid_hotplug_callback    callback;
+    std::thread*            monitor_thread;
+    std::atomic<bool>       running;
+    int                     sock;
+    int                     stop_fd;
+    bool                    use_udev;
+};
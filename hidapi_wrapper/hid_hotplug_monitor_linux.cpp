@@ -0,0 +1,323 @@
+/*-----------------------------------------*\
+|  hid_hotplug_monitor_linux.cpp            |
+|                                           |
+|  Watches the kernel uevent netlink socket |
+|  for hidraw nodes being added or removed  |
+|  (Linux only)                             |
+\*-----------------------------------------*/
+
+#include "hid_hotplug_monitor.h"
+#include "LogManager.h"
+
+#include <cstring>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+
+/*-----------------------------------------------------*\
+| Netlink multicast groups.  The udev group carries     |
+| events after udev has applied its rules, so device    |
+| permissions are already set when the event arrives.   |
+\*-----------------------------------------------------*/
+#define UEVENT_GROUP_KERNEL     1
+#define UEVENT_GROUP_UDEV       2
+
+#define UEVENT_BUFFER_SIZE      8192
+
+/*-----------------------------------------------------*\
+| Header prepended to events sent by udev               |
+\*-----------------------------------------------------*/
+struct udev_monitor_netlink_header
+{
+    char            prefix[8];
+    unsigned int    magic;
+    unsigned int    header_size;
+    unsigned int    properties_off;
+    unsigned int    properties_len;
+    unsigned int    filter_subsystem_hash;
+    unsigned int    filter_devtype_hash;
+    unsigned int    filter_tag_bloom_hi;
+    unsigned int    filter_tag_bloom_lo;
+};
+
+hid_hotplug_monitor::hid_hotplug_monitor()
+{
+    monitor_thread  = nullptr;
+    running         = false;
+    sock            = -1;
+    stop_fd         = -1;
+    use_udev        = false;
+}
+
+hid_hotplug_monitor::~hid_hotplug_monitor()
+{
+    stop();
+}
+
+bool hid_hotplug_monitor::start(hid_hotplug_callback new_callback)
+{
+    if(running)
+    {
+        return(true);
+    }
+
+    /*-------------------------------------------------*\
+    | Prefer udev events if udev is running, otherwise  |
+    | listen to the kernel directly                     |
+    \*-------------------------------------------------*/
+    use_udev = (access("/run/udev/control", F_OK) == 0);
+
+    sock = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+
+    if(sock < 0)
+    {
+        LOG_ERROR("[HID Hotplug] Failed to open uevent socket: %s", strerror(errno));
+        return(false);
+    }
+
+    struct sockaddr_nl addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.nl_family  = AF_NETLINK;
+    addr.nl_groups  = use_udev ? UEVENT_GROUP_UDEV : UEVENT_GROUP_KERNEL;
+
+    int pass_cred = 1;
+    setsockopt(sock, SOL_SOCKET, SO_PASSCRED, &pass_cred, sizeof(pass_cred));
+
+    if(bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+    {
+        LOG_ERROR("[HID Hotplug] Failed to bind uevent socket: %s", strerror(errno));
+        close(sock);
+        sock = -1;
+        return(false);
+    }
+
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+
+    if(stop_fd < 0)
+    {
+        close(sock);
+        sock = -1;
+        return(false);
+    }
+
+    callback        = new_callback;
+    running         = true;
+    monitor_thread  = new std::thread(&hid_hotplug_monitor::monitor_thread_function, this);
+
+    LOG_INFO("[HID Hotplug] Monitoring %s events", use_udev ? "udev" : "kernel");
+
+    return(true);
+}
+
+void hid_hotplug_monitor::stop()
+{
+    if(monitor_thread)
+    {
+        running = false;
+
+        uint64_t one = 1;
+        if(write(stop_fd, &one, sizeof(one)) < 0)
+        {
+            LOG_ERROR("[HID Hotplug] Failed to signal monitor thread");
+        }
+
+        monitor_thread->join();
+        delete monitor_thread;
+        monitor_thread = nullptr;
+    }
+
+    if(sock >= 0)
+    {
+        close(sock);
+        sock = -1;
+    }
+
+    if(stop_fd >= 0)
+    {
+        close(stop_fd);
+        stop_fd = -1;
+    }
+}
+
+bool hid_hotplug_monitor::is_running()
+{
+    return(running);
+}
+
+void hid_hotplug_monitor::monitor_thread_function()
+{
+    char buf[UEVENT_BUFFER_SIZE];
+    char cred_buf[CMSG_SPACE(sizeof(struct ucred))];
+
+    while(running)
+    {
+        struct pollfd fds[2];
+
+        fds[0].fd       = sock;
+        fds[0].events   = POLLIN;
+        fds[1].fd       = stop_fd;
+        fds[1].events   = POLLIN;
+
+        if(poll(fds, 2, -1) < 0)
+        {
+            if(errno == EINTR)
+            {
+                continue;
+            }
+
+            break;
+        }
+
+        if(fds[1].revents & POLLIN)
+        {
+            break;
+        }
+
+        if(!(fds[0].revents & POLLIN))
+        {
+            continue;
+        }
+
+        /*-------------------------------------------------*\
+        | Receive the event along with the sender address   |
+        | and credentials                                   |
+        \*-------------------------------------------------*/
+        struct sockaddr_nl  sender;
+        struct iovec        iov;
+        struct msghdr       msg;
+
+        iov.iov_base        = buf;
+        iov.iov_len         = sizeof(buf) - 1;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name        = &sender;
+        msg.msg_namelen     = sizeof(sender);
+        msg.msg_iov         = &iov;
+        msg.msg_iovlen      = 1;
+        msg.msg_control     = cred_buf;
+        msg.msg_controllen  = sizeof(cred_buf);
+
+        int len = recvmsg(sock, &msg, 0);
+
+        if(len <= 0)
+        {
+            continue;
+        }
+
+        buf[len] = '\0';
+
+        /*-------------------------------------------------*\
+        | Only accept events sent by root, from the kernel  |
+        | or udev                                           |
+        \*-------------------------------------------------*/
+        struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+
+        if((cmsg == NULL) || (cmsg->cmsg_type != SCM_CREDENTIALS))
+        {
+            continue;
+        }
+
+        struct ucred* cred = (struct ucred*)CMSG_DATA(cmsg);
+
+        if(cred->uid != 0)
+        {
+            continue;
+        }
+
+        if(use_udev && (sender.nl_groups == UEVENT_GROUP_UDEV) && (strncmp(buf, "libudev", 8) == 0))
+        {
+            process_uevent(buf, len, true);
+        }
+        else if(!use_udev && (sender.nl_pid == 0))
+        {
+            process_uevent(buf, len, false);
+        }
+    }
+}
+
+void hid_hotplug_monitor::process_uevent(const char* buf, int len, bool from_udev)
+{
+    const char* properties;
+    int         properties_len;
+
+    /*-------------------------------------------------*\
+    | Find the KEY=VALUE property list.  udev events    |
+    | give its offset in the header, kernel events      |
+    | start with an action@devpath line.                |
+    \*-------------------------------------------------*/
+    if(from_udev)
+    {
+        const udev_monitor_netlink_header* header = (const udev_monitor_netlink_header*)buf;
+
+        if((len < (int)sizeof(udev_monitor_netlink_header))
+        || (header->properties_off + header->properties_len > (unsigned int)len))
+        {
+            return;
+        }
+
+        properties      = buf + header->properties_off;
+        properties_len  = header->properties_len;
+    }
+    else
+    {
+        int header_len  = strlen(buf) + 1;
+
+        if(header_len >= len)
+        {
+            return;
+        }
+
+        properties      = buf + header_len;
+        properties_len  = len - header_len;
+    }
+
+    std::string action;
+    std::string subsystem;
+    std::string devname;
+
+    for(int offset = 0; offset < properties_len;)
+    {
+        const char* property    = properties + offset;
+        int         length      = strnlen(property, properties_len - offset);
+
+        if(strncmp(property, "ACTION=", 7) == 0)
+        {
+            action.assign(property + 7, length - 7);
+        }
+        else if(strncmp(property, "SUBSYSTEM=", 10) == 0)
+        {
+            subsystem.assign(property + 10, length - 10);
+        }
+        else if(strncmp(property, "DEVNAME=", 8) == 0)
+        {
+            devname.assign(property + 8, length - 8);
+        }
+
+        offset += length + 1;
+    }
+
+    if((subsystem != "hidraw") || devname.empty())
+    {
+        return;
+    }
+
+    /*-------------------------------------------------*\
+    | The kernel gives the node name relative to /dev   |
+    \*-------------------------------------------------*/
+    if(devname[0] != '/')
+    {
+        devname = "/dev/" + devname;
+    }
+
+    if(action == "add")
+    {
+        callback(HID_HOTPLUG_ADDED, devname);
+    }
+    else if(action == "remove")
+    {
+        callback(HID_HOTPLUG_REMOVED, devname);
+    }
+}
@@ -7,6 +7,7 @@
 \******************************************************************************************/
 
 #include "i2c_smbus.h"
+#include "LogManager.h"
 #include <string.h>
 
 #ifdef WIN32
@@ -17,24 +18,40 @@
 
 i2c_smbus_interface::i2c_smbus_interface()
 {
-    i2c_smbus_start            = false;
-    i2c_smbus_done             = false;
     this->port_id              = -1;
     this->pci_device           = -1;
     this->pci_vendor           = -1;
     this->pci_subsystem_device = -1;
     this->pci_subsystem_vendor = -1;
+    i2c_smbus_queue_depth      = 0;
+    i2c_smbus_stats_start      = std::chrono::steady_clock::now();
+    i2c_smbus_busy_time        = std::chrono::steady_clock::duration::zero();
     i2c_smbus_thread_running   = true;
     i2c_smbus_thread           = new std::thread(&i2c_smbus_interface::i2c_smbus_thread_function, this);
 }
 
 i2c_smbus_interface::~i2c_smbus_interface()
 {
+    std::unique_lock<std::mutex> jobs_lock(i2c_smbus_jobs_mutex);
     i2c_smbus_thread_running = false;
-    i2c_smbus_start = true;
-    i2c_smbus_start_cv.notify_all();
+    i2c_smbus_jobs_cv.notify_all();
+    i2c_smbus_done_cv.notify_all();
+    jobs_lock.unlock();
+
     i2c_smbus_thread->join();
     delete i2c_smbus_thread;
+
+    /*---------------------------------------------------------*\
+    | Fail any jobs that were still queued                      |
+    \*---------------------------------------------------------*/
+    for(std::map<u8, i2c_smbus_addr_queue>::iterator it = i2c_smbus_queues.begin(); it != i2c_smbus_queues.end(); it++)
+    {
+        for(std::size_t job_idx = 0; job_idx < it->second.jobs.size(); job_idx++)
+        {
+            it->second.jobs[job_idx]->result.set_value(-1);
+            delete it->second.jobs[job_idx];
+        }
+    }
 }
 
 s32 i2c_smbus_interface::i2c_smbus_write_quick(u8 addr, u8 value)
@@ -159,53 +176,181 @@ s32 i2c_smbus_interface::i2c_smbus_write_i2c_block_data(u8 addr, u8 command, u8
 
 s32 i2c_smbus_interface::i2c_smbus_xfer_call(u8 addr, char read_write, u8 command, int size, i2c_smbus_data* data)
 {
-    i2c_smbus_xfer_mutex.lock();
+    i2c_smbus_wait_queue(addr);
 
-    i2c_addr        = addr;
-    i2c_read_write  = read_write;
-    i2c_command     = command;
-    i2c_size_smbus  = size;
-    i2c_data_smbus  = data;
-    smbus_xfer      = true;
+    std::lock_guard<std::mutex> bus_lock(i2c_smbus_bus_mutex);
 
-    std::unique_lock<std::mutex> start_lock(i2c_smbus_start_mutex);
-    i2c_smbus_start = true;
-    i2c_smbus_start_cv.notify_all();
-    start_lock.unlock();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-    std::unique_lock<std::mutex> done_lock(i2c_smbus_done_mutex);
+    s32 ret = i2c_smbus_xfer(addr, read_write, command, size, data);
 
-    i2c_smbus_done_cv.wait(done_lock, [this]{ return i2c_smbus_done.load(); });
-    i2c_smbus_done  = false;
+    i2c_smbus_add_busy_time(start, std::chrono::steady_clock::now());
 
-    i2c_smbus_xfer_mutex.unlock();
-
-    return(i2c_ret);
+    return(ret);
 }
 
 s32 i2c_smbus_interface::i2c_xfer_call(u8 addr, char read_write, int* size, u8 *data)
 {
-    i2c_smbus_xfer_mutex.lock();
+    i2c_smbus_wait_queue(addr);
+
+    std::lock_guard<std::mutex> bus_lock(i2c_smbus_bus_mutex);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    s32 ret = i2c_xfer(addr, read_write, size, data);
+
+    i2c_smbus_add_busy_time(start, std::chrono::steady_clock::now());
+
+    return(ret);
+}
+
+void i2c_smbus_interface::i2c_smbus_wait_queue(u8 addr)
+{
+    /*---------------------------------------------------------*\
+    | Transfers to an address stay in the order they were made, |
+    | so wait until the bus thread has sent any batches already |
+    | queued for it                                             |
+    \*---------------------------------------------------------*/
+    std::unique_lock<std::mutex> jobs_lock(i2c_smbus_jobs_mutex);
+
+    std::map<u8, i2c_smbus_addr_queue>::iterator it = i2c_smbus_queues.find(addr);
+
+    if(it == i2c_smbus_queues.end())
+    {
+        return;
+    }
+
+    i2c_smbus_addr_queue& queue = it->second;
+
+    i2c_smbus_done_cv.wait(jobs_lock, [this, &queue]{ return((queue.jobs.empty() && !queue.running) || !i2c_smbus_thread_running.load()); });
+}
+
+void i2c_smbus_interface::i2c_smbus_add_busy_time(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    std::lock_guard<std::mutex> jobs_lock(i2c_smbus_jobs_mutex);
+
+    i2c_smbus_busy_time += (end - start);
+    i2c_smbus_update_stats(end);
+}
+
+std::future<s32> i2c_smbus_interface::i2c_smbus_xfer_queue(i2c_smbus_batch& batch)
+{
+    if(batch.empty())
+    {
+        std::promise<s32> done;
+        done.set_value(0);
+        return(done.get_future());
+    }
+
+    i2c_smbus_job* job  = new i2c_smbus_job;
+
+    job->ops.swap(batch.ops);
+
+    std::future<s32> result = job->result.get_future();
+
+    //Batches are scheduled by the address of their first transfer
+    i2c_smbus_queue_job(job->ops[0].addr, job);
+
+    return(result);
+}
+
+void i2c_smbus_interface::i2c_smbus_set_target_rate(u8 addr, unsigned int fps)
+{
+    std::lock_guard<std::mutex> jobs_lock(i2c_smbus_jobs_mutex);
+
+    i2c_smbus_addr_queue& queue = i2c_smbus_queues[addr];
+
+    if(fps == 0)
+    {
+        queue.target_period = std::chrono::steady_clock::duration::zero();
+    }
+    else
+    {
+        queue.target_period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds(1)) / fps;
+    }
+}
+
+void i2c_smbus_interface::i2c_smbus_queue_job(u8 addr, i2c_smbus_job* job)
+{
+    std::unique_lock<std::mutex> jobs_lock(i2c_smbus_jobs_mutex);
+
+    i2c_smbus_addr_queue& queue = i2c_smbus_queues[addr];
+
+    /*---------------------------------------------------------*\
+    | An address joins the back of the round-robin order when   |
+    | its queue goes from empty to not empty                    |
+    \*---------------------------------------------------------*/
+    if(queue.jobs.empty())
+    {
+        i2c_smbus_ready.push_back(addr);
+    }
+
+    queue.jobs.push_back(job);
+    i2c_smbus_queue_depth++;
+
+    i2c_smbus_jobs_cv.notify_all();
+}
+
+i2c_smbus_job* i2c_smbus_interface::i2c_smbus_next_job()
+{
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    /*---------------------------------------------------------*\
+    | Serve the first address that is behind its target rate,  |
+    | otherwise the address at the front of the round-robin     |
+    \*---------------------------------------------------------*/
+    std::size_t ready_idx = 0;
+
+    for(std::size_t check_idx = 0; check_idx < i2c_smbus_ready.size(); check_idx++)
+    {
+        i2c_smbus_addr_queue& check = i2c_smbus_queues[i2c_smbus_ready[check_idx]];
+
+        if((check.target_period != std::chrono::steady_clock::duration::zero())
+        && ((now - check.last_service) >= check.target_period))
+        {
+            ready_idx = check_idx;
+            break;
+        }
+    }
+
+    u8                      addr    = i2c_smbus_ready[ready_idx];
+    i2c_smbus_addr_queue&   queue   = i2c_smbus_queues[addr];
+    i2c_smbus_job*          job     = queue.jobs.front();
 
-    i2c_addr        = addr;
-    i2c_read_write  = read_write;
-    i2c_size        = size;
-    i2c_data        = data;
-    smbus_xfer      = false;
+    i2c_smbus_ready.erase(i2c_smbus_ready.begin() + ready_idx);
+    queue.jobs.pop_front();
+    queue.running      = true;
+    queue.last_service = now;
+    i2c_smbus_queue_depth--;
+
+    if(!queue.jobs.empty())
+    {
+        i2c_smbus_ready.push_back(addr);
+    }
 
-    std::unique_lock<std::mutex> start_lock(i2c_smbus_start_mutex);
-    i2c_smbus_start = true;
-    i2c_smbus_start_cv.notify_all();
-    start_lock.unlock();
+    return(job);
+}
 
-    std::unique_lock<std::mutex> done_lock(i2c_smbus_done_mutex);
+void i2c_smbus_interface::i2c_smbus_update_stats(std::chrono::steady_clock::time_point now)
+{
+    std::chrono::steady_clock::duration elapsed = now - i2c_smbus_stats_start;
 
-    i2c_smbus_done_cv.wait(done_lock, [this]{ return i2c_smbus_done.load(); });
-    i2c_smbus_done  = false;
+    if(elapsed >= std::chrono::seconds(1))
+    {
+        float utilization       = (float)i2c_smbus_busy_time.count() / (float)elapsed.count();
 
-    i2c_smbus_xfer_mutex.unlock();
+        /*-----------------------------------------------------*\
+        | Stats are only updated when the bus is used, so skip  |
+        | windows that ran on through an idle period            |
+        \*-----------------------------------------------------*/
+        if(elapsed < std::chrono::seconds(2))
+        {
+            LOG_TRACE("[%s] Bus utilization %.0f%%, %u jobs queued", device_name, utilization * 100.0f, i2c_smbus_queue_depth);
+        }
 
-    return(i2c_ret);
+        i2c_smbus_busy_time     = std::chrono::steady_clock::duration::zero();
+        i2c_smbus_stats_start   = now;
+    }
 }
 
 s32 i2c_smbus_interface::i2c_read_block(u8 addr, int* size, u8* data)
@@ -218,32 +363,148 @@ s32 i2c_smbus_interface::i2c_write_block(u8 addr, int size, u8 *data)
     return i2c_xfer_call(addr, I2C_SMBUS_WRITE, &size, data);
 }
 
+s32 i2c_smbus_interface::i2c_smbus_run_job(i2c_smbus_job* job)
+{
+    /*---------------------------------------------------------*\
+    | Run the queued transfers in order, stopping at the first  |
+    | one that fails                                            |
+    \*---------------------------------------------------------*/
+    for(std::size_t op_idx = 0; op_idx < job->ops.size(); op_idx++)
+    {
+        i2c_smbus_xfer_op&  op  = job->ops[op_idx];
+        s32                 ret = i2c_smbus_xfer(op.addr, op.read_write, op.command, op.size, &op.data);
+
+        if(ret < 0)
+        {
+            return(ret);
+        }
+    }
+
+    return(0);
+}
+
 void i2c_smbus_interface::i2c_smbus_thread_function()
 {
     while(1)
     {
-        std::unique_lock<std::mutex> start_lock(i2c_smbus_start_mutex);
+        std::unique_lock<std::mutex> jobs_lock(i2c_smbus_jobs_mutex);
 
-        i2c_smbus_start_cv.wait(start_lock, [this]{ return i2c_smbus_start.load(); });
-        i2c_smbus_start = false;
+        i2c_smbus_jobs_cv.wait(jobs_lock, [this]{ return(!i2c_smbus_ready.empty() || !i2c_smbus_thread_running.load()); });
 
         if (!i2c_smbus_thread_running.load())
         {
             break;
         }
 
-        if(smbus_xfer)
-        {
-            i2c_ret = i2c_smbus_xfer(i2c_addr, i2c_read_write, i2c_command, i2c_size_smbus, i2c_data_smbus);
-        }
-        else
-        {
-            i2c_ret = i2c_xfer(i2c_addr, i2c_read_write, i2c_size, i2c_data);
-        }
+        i2c_smbus_job*  job     = i2c_smbus_next_job();
+        u8              addr    = job->ops[0].addr;
+        jobs_lock.unlock();
 
-        std::unique_lock<std::mutex> done_lock(i2c_smbus_done_mutex);
-        i2c_smbus_done  = true;
+        std::unique_lock<std::mutex> bus_lock(i2c_smbus_bus_mutex);
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+        s32 ret = i2c_smbus_run_job(job);
+
+        std::chrono::steady_clock::time_point end   = std::chrono::steady_clock::now();
+
+        bus_lock.unlock();
+
+        job->result.set_value(ret);
+
+        delete job;
+
+        jobs_lock.lock();
+        i2c_smbus_queues[addr].running = false;
+        i2c_smbus_busy_time += (end - start);
+        i2c_smbus_update_stats(end);
         i2c_smbus_done_cv.notify_all();
-        done_lock.unlock();
     }
-}
\ No newline at end of file
+}
+
+/*---------------------------------------------------------*\
+| i2c_smbus_batch                                           |
+\*---------------------------------------------------------*/
+void i2c_smbus_batch::write_quick(u8 addr, u8 value)
+{
+    i2c_smbus_xfer_op op;
+    op.addr         = addr;
+    op.read_write   = value;
+    op.command      = 0;
+    op.size         = I2C_SMBUS_QUICK;
+    ops.push_back(op);
+}
+
+void i2c_smbus_batch::write_byte(u8 addr, u8 value)
+{
+    i2c_smbus_xfer_op op;
+    op.addr         = addr;
+    op.read_write   = I2C_SMBUS_WRITE;
+    op.command      = value;
+    op.size         = I2C_SMBUS_BYTE;
+    ops.push_back(op);
+}
+
+void i2c_smbus_batch::write_byte_data(u8 addr, u8 command, u8 value)
+{
+    i2c_smbus_xfer_op op;
+    op.addr         = addr;
+    op.read_write   = I2C_SMBUS_WRITE;
+    op.command      = command;
+    op.size         = I2C_SMBUS_BYTE_DATA;
+    op.data.byte    = value;
+    ops.push_back(op);
+}
+
+void i2c_smbus_batch::write_word_data(u8 addr, u8 command, u16 value)
+{
+    i2c_smbus_xfer_op op;
+    op.addr         = addr;
+    op.read_write   = I2C_SMBUS_WRITE;
+    op.command      = command;
+    op.size         = I2C_SMBUS_WORD_DATA;
+    op.data.word    = value;
+    ops.push_back(op);
+}
+
+void i2c_smbus_batch::write_block_data(u8 addr, u8 command, u8 length, const u8 *values)
+{
+    i2c_smbus_xfer_op op;
+    if (length > I2C_SMBUS_BLOCK_MAX)
+    {
+        length = I2C_SMBUS_BLOCK_MAX;
+    }
+    op.addr             = addr;
+    op.read_write       = I2C_SMBUS_WRITE;
+    op.command          = command;
+    op.size             = I2C_SMBUS_BLOCK_DATA;
+    op.data.block[0]    = length;
+    memcpy(&op.data.block[1], values, length);
+    ops.push_back(op);
+}
+
+void i2c_smbus_batch::write_i2c_block_data(u8 addr, u8 command, u8 length, const u8 *values)
+{
+    i2c_smbus_xfer_op op;
+    if (length > I2C_SMBUS_BLOCK_MAX)
+    {
+        length = I2C_SMBUS_BLOCK_MAX;
+    }
+    op.addr             = addr;
+    op.read_write       = I2C_SMBUS_WRITE;
+    op.command          = command;
+    op.size             = I2C_SMBUS_I2C_BLOCK_DATA;
+    op.data.block[0]    = length;
+    memcpy(&op.data.block[1], values, length);
+    ops.push_back(op);
+}
+
+bool i2c_smbus_batch::empty()
+{
+    return(ops.empty());
+}
+
+void i2c_smbus_batch::clear()
+{
+    ops.clear();
+}
@@ -12,9 +12,14 @@
 #define I2C_SMBUS_H
 
 #include <atomic>
+#include <chrono>
 #include <thread>
 #include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
 #include <mutex>
+#include <vector>
 
 typedef unsigned char   u8;
 typedef unsigned short  u16;
@@ -70,6 +75,56 @@ union i2c_smbus_data
 #define I2C_SMBUS_BLOCK_PROC_CALL   7           /* SMBus 2.0 */
 #define I2C_SMBUS_I2C_BLOCK_DATA    8
 
+/*---------------------------------------------------------*\
+| Queued transfers                                          |
+|                                                           |
+| A batch holds a copy of each transfer so it can be run    |
+| after the caller has returned.  Batches are meant for     |
+| writes, data read back by a queued transfer is discarded. |
+\*---------------------------------------------------------*/
+struct i2c_smbus_xfer_op
+{
+    u8                  addr;
+    char                read_write;
+    u8                  command;
+    int                 size;
+    i2c_smbus_data      data;
+};
+
+class i2c_smbus_batch
+{
+public:
+    void write_quick(u8 addr, u8 value);
+    void write_byte(u8 addr, u8 value);
+    void write_byte_data(u8 addr, u8 command, u8 value);
+    void write_word_data(u8 addr, u8 command, u16 value);
+    void write_block_data(u8 addr, u8 command, u8 length, const u8 *values);
+    void write_i2c_block_data(u8 addr, u8 command, u8 length, const u8 *values);
+
+    bool empty();
+    void clear();
+
+    std::vector<i2c_smbus_xfer_op> ops;
+};
+
+struct i2c_smbus_job
+{
+    std::vector<i2c_smbus_xfer_op>  ops;
+    std::promise<s32>               result;
+};
+
+struct i2c_smbus_addr_queue
+{
+    /*-----------------------------------------------------*\
+    | Jobs queued for one device address, whether one of    |
+    | them is on the bus, and the optional frame rate the   |
+    | device asked for                                      |
+    \*-----------------------------------------------------*/
+    std::deque<i2c_smbus_job*>                  jobs;
+    bool                                        running = false;
+    std::chrono::steady_clock::duration         target_period;
+    std::chrono::steady_clock::time_point       last_service;
+};
 
 class i2c_smbus_interface
 {
@@ -104,36 +159,56 @@ public:
     s32 i2c_read_block(u8 addr, int* size, u8* data);
     s32 i2c_write_block(u8 addr, int size, u8* data);
 
-    //Handle SMBus and I2C transfer calls in a single thread
+    //Run SMBus and I2C transfer calls on the calling thread while holding
+    //the bus lock, after any transfers already queued for the address
     s32 i2c_smbus_xfer_call(u8 addr, char read_write, u8 command, int size, i2c_smbus_data* data);
     s32 i2c_xfer_call(u8 addr, char read_write, int* size, u8 *data);
 
+    //Queue a batch of transfers to run in order on the bus thread.  The
+    //batch is emptied, the future holds the first failing result or 0
+    std::future<s32> i2c_smbus_xfer_queue(i2c_smbus_batch& batch);
+
+    //Scheduler controls.  Jobs for different addresses are interleaved
+    //round-robin, addresses with a target rate that are behind it are
+    //served first.  A target rate of 0 clears it.  Bus utilization and
+    //queue depth are logged at trace level once per second while busy.
+    void            i2c_smbus_set_target_rate(u8 addr, unsigned int fps);
+
     virtual s32 i2c_smbus_xfer(u8 addr, char read_write, u8 command, int size, i2c_smbus_data* data) = 0;
     virtual s32 i2c_xfer(u8 addr, char read_write, int* size, u8* data) = 0;
 
 private:
-    std::thread *           i2c_smbus_thread;
-    std::atomic<bool>       i2c_smbus_thread_running;
-
-    std::atomic<bool>       i2c_smbus_start;
-    std::condition_variable i2c_smbus_start_cv;
-    std::mutex              i2c_smbus_start_mutex;
-
-    std::atomic<bool>       i2c_smbus_done;
-    std::condition_variable i2c_smbus_done_cv;
-    std::mutex              i2c_smbus_done_mutex;
-
-    std::mutex              i2c_smbus_xfer_mutex;
-
-    u8                  i2c_addr;
-    char                i2c_read_write;
-    u16                 i2c_command;
-    int                 i2c_size_smbus;
-    int*                i2c_size;
-    i2c_smbus_data*     i2c_data_smbus;
-    u8*                 i2c_data;
-    s32                 i2c_ret;
-    bool                smbus_xfer;
+    void            i2c_smbus_wait_queue(u8 addr);
+    void            i2c_smbus_add_busy_time(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end);
+    void            i2c_smbus_queue_job(u8 addr, i2c_smbus_job* job);
+    i2c_smbus_job*  i2c_smbus_next_job();
+    s32             i2c_smbus_run_job(i2c_smbus_job* job);
+    void            i2c_smbus_update_stats(std::chrono::steady_clock::time_point now);
+
+    std::thread *                           i2c_smbus_thread;
+    std::atomic<bool>                       i2c_smbus_thread_running;
+
+    /*-----------------------------------------------------*\
+    | Held by whichever thread is using the bus             |
+    \*-----------------------------------------------------*/
+    std::mutex                              i2c_smbus_bus_mutex;
+
+    /*-----------------------------------------------------*\
+    | Per-address job queues and the round-robin order of   |
+    | addresses that have jobs waiting                      |
+    \*-----------------------------------------------------*/
+    std::map<u8, i2c_smbus_addr_queue>      i2c_smbus_queues;
+    std::deque<u8>                          i2c_smbus_ready;
+    unsigned int                            i2c_smbus_queue_depth;
+    std::condition_variable                 i2c_smbus_jobs_cv;
+    std::condition_variable                 i2c_smbus_done_cv;
+    std::mutex                              i2c_smbus_jobs_mutex;
+
+    /*-----------------------------------------------------*\
+    | Bus utilization, measured over one second windows     |
+    \*-----------------------------------------------------*/
+    std::chrono::steady_clock::time_point   i2c_smbus_stats_start;
+    std::chrono::steady_clock::duration     i2c_smbus_busy_time;
 };
 
 #endif /* I2C_SMBUS_H */
@@ -19,7 +19,7 @@
 #include <stdlib.h>
 #include <iostream>
 
-const char yes = 1;
+const int yes = 1;
 
 net_port::net_port()
 {
@@ -165,7 +165,7 @@ bool net_port::tcp_client_connect()
         /*-------------------------------------------------*\
         | Set socket options - no delay                     |
         \*-------------------------------------------------*/
-        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+        setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char *)&yes, sizeof(yes));
 
         if(select(sock + 1, NULL, &fdset, NULL, &tv) == 1)
         {
@@ -241,7 +241,7 @@ bool net_port::tcp_server(const char * port)
     /*-------------------------------------------------*\
     | Set socket options - no delay                     |
     \*-------------------------------------------------*/
-    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char *)&yes, sizeof(yes));
 
     return(true);
 }
@@ -271,7 +271,7 @@ SOCKET * net_port::tcp_server_listen()
     \*-------------------------------------------------*/
     u_long arg = 0;
     ioctlsocket(*client, FIONBIO, &arg);
-    setsockopt(*client, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    setsockopt(*client, IPPROTO_TCP, TCP_NODELAY, (const char *)&yes, sizeof(yes));
     clients.push_back(client);
 
     return client;
@@ -0,0 +1,214 @@
+/*---------------------------------------------------------*\
+|  Request scheduler for REST controlled network devices    |
+|                                                           |
+|  Requests to an endpoint are sent one at a time from a    |
+|  worker thread, within a configurable request budget.     |
+|  A request submitted under the same key as a request that |
+|  is still pending replaces it, so only the latest value   |
+|  is sent.                                                 |
+\*---------------------------------------------------------*/
+
+#include "rest_scheduler.h"
+#include "LogManager.h"
+#include "httplib.h"
+
+#include <algorithm>
+
+/*---------------------------------------------------------*\
+| Connection, read and write timeout for the HTTP client    |
+\*---------------------------------------------------------*/
+#define REST_SCHEDULER_TIMEOUT_S    2
+
+rest_scheduler* rest_scheduler::get(const std::string& host, int port)
+{
+    static std::mutex                               schedulers_mutex;
+    static std::map<std::string, rest_scheduler*>   schedulers;
+
+    std::lock_guard<std::mutex> lock(schedulers_mutex);
+
+    std::string endpoint = host + ":" + std::to_string(port);
+
+    std::map<std::string, rest_scheduler*>::iterator it = schedulers.find(endpoint);
+
+    if(it != schedulers.end())
+    {
+        return(it->second);
+    }
+
+    rest_scheduler* scheduler = new rest_scheduler(host, port);
+
+    schedulers[endpoint] = scheduler;
+
+    return(scheduler);
+}
+
+rest_scheduler::rest_scheduler(const std::string& new_host, int new_port)
+{
+    host            = new_host;
+    port            = new_port;
+    http_client     = nullptr;
+    request_running = false;
+
+    rate            = 0.0f;
+    burst           = 1.0f;
+    tokens          = 1.0f;
+    last_refill     = std::chrono::steady_clock::now();
+
+    stats.submitted = 0;
+    stats.sent      = 0;
+    stats.coalesced = 0;
+    stats.dropped   = 0;
+
+    worker_thread   = new std::thread(&rest_scheduler::worker_thread_function, this);
+}
+
+void rest_scheduler::set_rate_limit(float requests_per_second, unsigned int new_burst)
+{
+    std::lock_guard<std::mutex> lock(queue_mutex);
+
+    rate        = std::max(requests_per_second, 0.0f);
+    burst       = (float)std::max(new_burst, 1u);
+    tokens      = std::min(tokens, burst);
+    last_refill = std::chrono::steady_clock::now();
+
+    queue_cv.notify_all();
+}
+
+void rest_scheduler::submit(const std::string& key, rest_request request)
+{
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+
+        stats.submitted++;
+
+        /*-------------------------------------------------*\
+        | Replace the pending request for this key if there |
+        | is one, keeping its place in the queue            |
+        \*-------------------------------------------------*/
+        std::map<std::string, rest_request>::iterator it = pending_requests.find(key);
+
+        if(it != pending_requests.end())
+        {
+            it->second = std::move(request);
+            stats.coalesced++;
+        }
+        else
+        {
+            pending_requests[key] = std::move(request);
+            pending_order.push_back(key);
+        }
+    }
+
+    queue_cv.notify_one();
+}
+
+void rest_scheduler::cancel(const std::string& key)
+{
+    std::unique_lock<std::mutex> lock(queue_mutex);
+
+    if(pending_requests.erase(key) > 0)
+    {
+        pending_order.erase(std::find(pending_order.begin(), pending_order.end(), key));
+        stats.dropped++;
+    }
+
+    done_cv.wait(lock, [this, &key]{ return(!request_running || (running_key != key)); });
+}
+
+httplib::Client* rest_scheduler::client()
+{
+    if(http_client == nullptr)
+    {
+        http_client = new httplib::Client(host, port);
+
+        http_client->set_keep_alive(true);
+        http_client->set_connection_timeout(REST_SCHEDULER_TIMEOUT_S);
+        http_client->set_read_timeout(REST_SCHEDULER_TIMEOUT_S);
+        http_client->set_write_timeout(REST_SCHEDULER_TIMEOUT_S);
+    }
+
+    return(http_client);
+}
+
+rest_scheduler_stats rest_scheduler::get_stats()
+{
+    std::lock_guard<std::mutex> lock(queue_mutex);
+
+    return(stats);
+}
+
+void rest_scheduler::worker_thread_function()
+{
+    std::unique_lock<std::mutex> lock(queue_mutex);
+
+    while(true)
+    {
+        if(pending_order.empty())
+        {
+            queue_cv.wait(lock);
+            continue;
+        }
+
+        /*-------------------------------------------------*\
+        | Refill the request budget and wait until there is |
+        | room for another request                          |
+        \*-------------------------------------------------*/
+        if(rate > 0.0f)
+        {
+            std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+            tokens      = std::min(burst, tokens + (std::chrono::duration<float>(now - last_refill).count() * rate));
+            last_refill = now;
+
+            if(tokens < 1.0f)
+            {
+                queue_cv.wait_for(lock, std::chrono::duration<float>((1.0f - tokens) / rate));
+                continue;
+            }
+
+            tokens -= 1.0f;
+        }
+
+        /*-------------------------------------------------*\
+        | Send the oldest pending request with the lock     |
+        | released so new requests can replace pending ones |
+        \*-------------------------------------------------*/
+        std::string  key     = pending_order.front();
+        rest_request request = std::move(pending_requests[key]);
+
+        pending_order.pop_front();
+        pending_requests.erase(key);
+
+        running_key     = key;
+        request_running = true;
+
+        lock.unlock();
+
+        bool success = false;
+
+        try
+        {
+            success = request();
+        }
+        catch(const std::exception& e)
+        {
+            LOG_ERROR("[REST Scheduler] Request to %s:%d failed: %s", host.c_str(), port, e.what());
+        }
+
+        lock.lock();
+
+        request_running = false;
+        running_key.clear();
+
+        if(success)
+        {
+            stats.sent++;
+        }
+        else
+        {
+            stats.dropped++;
+        }
+
+        done_cv.notify_all();
+    }
+}
@@ -0,0 +1,101 @@
+/*---------------------------------------------------------*\
+|  Request scheduler for REST controlled network devices    |
+|                                                           |
+|  Requests to an endpoint are sent one at a time from a    |
+|  worker thread, within a configurable request budget.     |
+|  A request submitted under the same key as a request that |
+|  is still pending replaces it, so only the latest value   |
+|  is sent.                                                 |
+\*---------------------------------------------------------*/
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace httplib
+{
+    class Client;
+}
+
+/*---------------------------------------------------------*\
+| A request returns true if it was delivered successfully   |
+\*---------------------------------------------------------*/
+typedef std::function<bool()>   rest_request;
+
+struct rest_scheduler_stats
+{
+    unsigned long long  submitted;      /* Requests passed to submit()                      */
+    unsigned long long  sent;           /* Requests that completed successfully             */
+    unsigned long long  coalesced;      /* Pending requests replaced by a newer one         */
+    unsigned long long  dropped;        /* Requests that failed or were cancelled unsent    */
+};
+
+class rest_scheduler
+{
+public:
+    /*-----------------------------------------------------*\
+    | Returns the shared scheduler for an endpoint, creating|
+    | it if needed.  Schedulers are never destroyed, so     |
+    | controllers can cancel their requests at any point    |
+    | during shutdown.                                      |
+    \*-----------------------------------------------------*/
+    static rest_scheduler* get(const std::string& host, int port);
+
+    /*-----------------------------------------------------*\
+    | Allow on average requests_per_second requests, with   |
+    | up to burst sent back to back.  A rate of 0 removes   |
+    | the limit.                                            |
+    \*-----------------------------------------------------*/
+    void set_rate_limit(float requests_per_second, unsigned int burst = 1);
+
+    void submit(const std::string& key, rest_request request);
+
+    /*-----------------------------------------------------*\
+    | Discards the pending request for key and waits for it |
+    | to finish if it is being sent.  Must not be called    |
+    | from inside a request.                                |
+    \*-----------------------------------------------------*/
+    void cancel(const std::string& key);
+
+    /*-----------------------------------------------------*\
+    | Keep-alive HTTP client for the endpoint.  Only use it |
+    | from inside a request run by this scheduler.          |
+    \*-----------------------------------------------------*/
+    httplib::Client* client();
+
+    rest_scheduler_stats get_stats();
+
+private:
+    rest_scheduler(const std::string& host, int port);
+
+    void worker_thread_function();
+
+    std::string                         host;
+    int                                 port;
+
+    httplib::Client*                    http_client;
+
+    std::mutex                          queue_mutex;
+    std::condition_variable             queue_cv;
+    std::condition_variable             done_cv;
+    std::deque<std::string>             pending_order;
+    std::map<std::string, rest_request> pending_requests;
+    std::string                         running_key;
+    bool                                request_running;
+
+    float                               rate;
+    float                               burst;
+    float                               tokens;
+    std::chrono::steady_clock::time_point last_refill;
+
+    rest_scheduler_stats                stats;
+
+    std::thread*                        worker_thread;
+};
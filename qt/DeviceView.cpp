@@ -9,6 +9,7 @@
 #include "DeviceView.h"
 #include "RGBControllerKeyNames.h"
 #include "RGBController.h"
+#include "DeviceViewRefreshTicker.h"
 #include <QPainter>
 #include <QResizeEvent>
 #include <QStyleOption>
@@ -31,14 +32,20 @@ DeviceView::DeviceView(QWidget *parent) :
     controller = NULL;
     numerical_labels = false;
     per_led = true;
+    view_cache_valid = false;
     setMouseTracking(1);
 
     size = width();
+
+    /*-----------------------------------------------------*\
+    | Create the refresh ticker from the GUI thread         |
+    \*-----------------------------------------------------*/
+    DeviceViewRefreshTicker::get();
 }
 
 DeviceView::~DeviceView()
 {
-
+    DeviceViewRefreshTicker::get()->Forget(this);
 }
 
 struct led_label
@@ -508,11 +515,14 @@ void DeviceView::InitDeviceView()
         size     = height() / matrix_h;
         offset_x = (width() - size) / 2;
     }
+
+    view_cache_valid = false;
 }
 
 void DeviceView::setNumericalLabels(bool enable)
 {
     numerical_labels = enable;
+    view_cache_valid = false;
 }
 
 void DeviceView::setPerLED(bool per_led_mode)
@@ -655,84 +665,216 @@ void DeviceView::resizeEvent(QResizeEvent* /*event*/)
         size     = height() / matrix_h;
         offset_x = (width() - size) / 2;
     }
+
+    view_cache_valid = false;
     update();
 }
 
-void DeviceView::paintEvent(QPaintEvent* /* event */)
+void DeviceView::changeEvent(QEvent* event)
 {
-    QPainter painter(this);
-    QFont font = painter.font();
+    /*-----------------------------------------------------*\
+    | Colors and fonts are baked into the view cache        |
+    \*-----------------------------------------------------*/
+    if((event->type() == QEvent::PaletteChange) || (event->type() == QEvent::FontChange))
+    {
+        view_cache_valid = false;
+    }
+
+    QWidget::changeEvent(event);
+}
+
+QRect DeviceView::ledRect(std::size_t led_idx)
+{
+    int posx = led_pos[led_idx].matrix_x * size + offset_x;
+    int posy = led_pos[led_idx].matrix_y * size;
+    int posw = led_pos[led_idx].matrix_w * size;
+    int posh = led_pos[led_idx].matrix_h * size;
+
+    return(QRect(posx, posy, posw, posh));
+}
+
+void DeviceView::paintLed(QPainter& painter, std::size_t led_idx)
+{
+    QRect rect = ledRect(led_idx);
+    QFont font = this->font();
 
     /*-----------------------------------------------------*\
-    | If Device View is hidden, don't paint                 |
+    | Clear the previous contents of this cell.  Only the   |
+    | cell's own rect is cleared, the border line along its |
+    | right and bottom edge is shared with the neighbouring |
+    | cells and is drawn over rather than erased.           |
     \*-----------------------------------------------------*/
-    if(isHidden() || !per_led)
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.fillRect(rect, Qt::transparent);
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+
+    /*-----------------------------------------------------*\
+    | Fill color                                            |
+    \*-----------------------------------------------------*/
+    QColor currentColor = QColor::fromRgb(
+                RGBGetRValue(painted_colors[led_idx]),
+                RGBGetGValue(painted_colors[led_idx]),
+                RGBGetBValue(painted_colors[led_idx]));
+    painter.setBrush(currentColor);
+
+    /*-----------------------------------------------------*\
+    | Border color                                          |
+    \*-----------------------------------------------------*/
+    if(selectionFlags[led_idx])
     {
-        return;
+        painter.setPen(palette().highlight().color());
     }
+    else
+    {
+        painter.setPen(palette().dark().color());
+    }
+    painter.drawRect(rect);
 
     /*-----------------------------------------------------*\
-    | If controller has resized, reinitialize local data    |
+    | Label                                                 |
+    | Set the font color so that the text is visible        |
     \*-----------------------------------------------------*/
-    if(controller->leds.size() != led_pos.size())
+    font.setPixelSize(rect.height() / 2);
+    painter.setFont(font);
+
+    unsigned int luma = (unsigned int)(0.2126f * currentColor.red() + 0.7152f * currentColor.green() + 0.0722f * currentColor.blue());
+
+    if(luma > 127)
     {
-        InitDeviceView();
+        painter.setPen(Qt::black);
     }
+    else
+    {
+        painter.setPen(Qt::white);
+    }
+    painter.drawText(rect, Qt::AlignVCenter | Qt::AlignHCenter, QString(led_labels[led_idx]));
+}
+
+void DeviceView::renderViewCache()
+{
+    qreal dpr = devicePixelRatioF();
+
+    view_cache = QPixmap(this->size() * dpr);
+    view_cache.setDevicePixelRatio(dpr);
+    view_cache.fill(Qt::transparent);
 
     /*-----------------------------------------------------*\
-    | LED rectangles                                        |
+    | Snapshot the colors that the cache is drawn with      |
     \*-----------------------------------------------------*/
+    painted_colors = controller->colors;
+    painted_colors.resize(controller->leds.size());
+
+    QPainter painter(&view_cache);
+
     for(std::size_t led_idx = 0; led_idx < controller->leds.size(); led_idx++)
     {
-        int posx = led_pos[led_idx].matrix_x * size + offset_x;
-        int posy = led_pos[led_idx].matrix_y * size;
-        int posw = led_pos[led_idx].matrix_w * size;
-        int posh = led_pos[led_idx].matrix_h * size;
+        paintLed(painter, led_idx);
+    }
 
-        QRect rect = {posx, posy, posw, posh};
+    dirty_leds.clear();
+    view_cache_valid = true;
+}
 
-        /*-----------------------------------------------------*\
-        | Fill color                                            |
-        \*-----------------------------------------------------*/
-        QColor currentColor = QColor::fromRgb(
-                    RGBGetRValue(controller->colors[led_idx]),
-                    RGBGetGValue(controller->colors[led_idx]),
-                    RGBGetBValue(controller->colors[led_idx]));
-        painter.setBrush(currentColor);
+void DeviceView::updateChangedLeds()
+{
+    if((controller == NULL) || !per_led)
+    {
+        return;
+    }
 
-        /*-----------------------------------------------------*\
-        | Border color                                          |
-        \*-----------------------------------------------------*/
-        if(selectionFlags[led_idx])
-        {
-            painter.setPen(palette().highlight().color());
-        }
-        else
+    /*-----------------------------------------------------*\
+    | If the cache needs rebuilding, repaint everything     |
+    \*-----------------------------------------------------*/
+    if(!view_cache_valid
+    || (controller->leds.size()   != led_pos.size())
+    || (controller->colors.size() != painted_colors.size()))
+    {
+        update();
+        return;
+    }
+
+    /*-----------------------------------------------------*\
+    | Only schedule repaints for LEDs whose color changed   |
+    | since the cache was last drawn                        |
+    \*-----------------------------------------------------*/
+    for(std::size_t led_idx = 0; led_idx < painted_colors.size(); led_idx++)
+    {
+        if(controller->colors[led_idx] != painted_colors[led_idx])
         {
-            painter.setPen(palette().dark().color());
+            painted_colors[led_idx] = controller->colors[led_idx];
+            dirty_leds.push_back(led_idx);
+
+            update(ledRect(led_idx).adjusted(0, 0, 1, 1));
         }
-        painter.drawRect(rect);
+    }
+}
 
-        /*-----------------------------------------------------*\
-        | Label                                                 |
-        | Set the font color so that the text is visible        |
-        \*-----------------------------------------------------*/
-        font.setPixelSize(posh / 2);
-        painter.setFont(font);
+void DeviceView::paintEvent(QPaintEvent* event)
+{
+    /*-----------------------------------------------------*\
+    | If Device View is hidden, don't paint                 |
+    \*-----------------------------------------------------*/
+    if(isHidden() || !per_led)
+    {
+        return;
+    }
 
-        unsigned int luma = (unsigned int)(0.2126f * currentColor.red() + 0.7152f * currentColor.green() + 0.0722f * currentColor.blue());
+    /*-----------------------------------------------------*\
+    | If controller has resized, reinitialize local data    |
+    \*-----------------------------------------------------*/
+    if(controller->leds.size() != led_pos.size())
+    {
+        InitDeviceView();
+    }
 
-        if(luma > 127)
+    /*-----------------------------------------------------*\
+    | LED rectangles and labels are drawn into a cached     |
+    | pixmap.  Only cells whose color changed are redrawn,  |
+    | unless the layout or selection has changed.           |
+    \*-----------------------------------------------------*/
+    if(!view_cache_valid
+    || (view_cache.size() != this->size() * devicePixelRatioF())
+    || (controller->colors.size() != painted_colors.size()))
+    {
+        renderViewCache();
+    }
+    else
+    {
+        /*-------------------------------------------------*\
+        | A full repaint, such as when the view is shown    |
+        | again, also picks up colors that changed while no |
+        | partial updates were scheduled                    |
+        \*-------------------------------------------------*/
+        if(event->rect().contains(rect()))
         {
-            painter.setPen(Qt::black);
+            for(std::size_t led_idx = 0; led_idx < painted_colors.size(); led_idx++)
+            {
+                if(controller->colors[led_idx] != painted_colors[led_idx])
+                {
+                    painted_colors[led_idx] = controller->colors[led_idx];
+                    dirty_leds.push_back(led_idx);
+                }
+            }
         }
-        else
+
+        if(!dirty_leds.empty())
         {
-            painter.setPen(Qt::white);
+            QPainter cache_painter(&view_cache);
+
+            for(std::size_t dirty_idx = 0; dirty_idx < dirty_leds.size(); dirty_idx++)
+            {
+                paintLed(cache_painter, dirty_leds[dirty_idx]);
+            }
+
+            dirty_leds.clear();
         }
-        painter.drawText(rect, Qt::AlignVCenter | Qt::AlignHCenter, QString(led_labels[led_idx]));
     }
 
+    QPainter painter(this);
+    QFont font = painter.font();
+
+    painter.drawPixmap(0, 0, view_cache);
+
     font.setPixelSize(12);
     painter.setFont(font);
 
@@ -836,6 +978,7 @@ void DeviceView::updateSelection()
         }
     }
 
+    view_cache_valid = false;
     update();
 
     /*-----------------------------------------------------*\
@@ -857,6 +1000,7 @@ bool DeviceView::selectLed(int target)
     selectionFlags.resize(controller->leds.size());
     selectionFlags[target] = 1;
 
+    view_cache_valid = false;
     update();
 
     /*-----------------------------------------------------*\
@@ -900,6 +1044,7 @@ bool DeviceView::selectLeds(QVector<int> target)
         }
     }
 
+    view_cache_valid = false;
     update();
 
     /*-----------------------------------------------------*\
@@ -941,6 +1086,7 @@ bool DeviceView::selectSegment(int zone, int segment, bool add)
         }
     }
 
+    view_cache_valid = false;
     update();
 
     /*-----------------------------------------------------*\
@@ -976,6 +1122,7 @@ bool DeviceView::selectZone(int zone, bool add)
         }
     }
 
+    view_cache_valid = false;
     update();
 
     /*-----------------------------------------------------*\
@@ -994,6 +1141,7 @@ void DeviceView::clearSelection()
     selectedLeds.clear();
     selectionFlags.clear();
     selectionFlags.resize(controller->leds.size());
+    view_cache_valid = false;
 }
 
 void DeviceView::setSelectionColor(RGBColor color)
@@ -2,6 +2,8 @@
 #define DEVICEVIEW_H
 
 #include <QWidget>
+#include <QPainter>
+#include <QPixmap>
 #include "RGBController.h"
 
 typedef struct
@@ -26,12 +28,19 @@ public:
     void setNumericalLabels(bool enable);
     void setPerLED(bool per_led_mode);
 
+    /*-----------------------------------------------------*\
+    | Compare the controller colors against the last drawn  |
+    | colors and schedule repaints for changed LEDs only    |
+    \*-----------------------------------------------------*/
+    void updateChangedLeds();
+
 protected:
     void mousePressEvent(QMouseEvent *event);
     void mouseMoveEvent(QMouseEvent *event);
     void mouseReleaseEvent(QMouseEvent *);
     void resizeEvent(QResizeEvent *event);
-    void paintEvent(QPaintEvent *);
+    void changeEvent(QEvent *event);
+    void paintEvent(QPaintEvent *event);
 
 private:
     QSize initSize;
@@ -57,11 +66,22 @@ private:
 
     bool                                numerical_labels;
 
+    /*-----------------------------------------------------*\
+    | Cached LED cells and the colors they were drawn with  |
+    \*-----------------------------------------------------*/
+    QPixmap                             view_cache;
+    bool                                view_cache_valid;
+    std::vector<RGBColor>               painted_colors;
+    std::vector<std::size_t>            dirty_leds;
+
     RGBController* controller;
 
     QColor posColor(const QPoint &point);
     void InitDeviceView();
     void updateSelection();
+    QRect ledRect(std::size_t led_idx);
+    void paintLed(QPainter& painter, std::size_t led_idx);
+    void renderViewCache();
 
 signals:
     void selectionChanged(QVector<int>);
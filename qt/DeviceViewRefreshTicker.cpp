@@ -0,0 +1,97 @@
+#include "DeviceViewRefreshTicker.h"
+
+#include <QGuiApplication>
+#include <QScreen>
+
+DeviceViewRefreshTicker* DeviceViewRefreshTicker::get()
+{
+    /*-----------------------------------------------------*\
+    | Intentionally never deleted, as device threads may    |
+    | still signal updates while the application exits      |
+    \*-----------------------------------------------------*/
+    static DeviceViewRefreshTicker* instance = new DeviceViewRefreshTicker();
+
+    return(instance);
+}
+
+DeviceViewRefreshTicker::DeviceViewRefreshTicker()
+{
+    TickScheduled = false;
+
+    /*-----------------------------------------------------*\
+    | Refresh at the primary screen's refresh rate          |
+    \*-----------------------------------------------------*/
+    qreal refresh_rate = 60.0;
+
+    if((QGuiApplication::primaryScreen() != nullptr) && (QGuiApplication::primaryScreen()->refreshRate() > 0.0))
+    {
+        refresh_rate = QGuiApplication::primaryScreen()->refreshRate();
+    }
+
+    TickInterval = (int)(1000.0 / refresh_rate);
+
+    TickTimer.setSingleShot(true);
+    TickTimer.setTimerType(Qt::PreciseTimer);
+    connect(&TickTimer, &QTimer::timeout, this, &DeviceViewRefreshTicker::Tick);
+
+    LastTick.start();
+}
+
+void DeviceViewRefreshTicker::MarkDirty(DeviceView* view)
+{
+    DirtyMutex.lock();
+    DirtyViews.insert(view);
+    DirtyMutex.unlock();
+
+    /*-----------------------------------------------------*\
+    | Only the first update since the last tick posts an    |
+    | event to the GUI thread, later ones are coalesced     |
+    \*-----------------------------------------------------*/
+    if(!TickScheduled.exchange(true))
+    {
+        QMetaObject::invokeMethod(this, "ScheduleTick", Qt::QueuedConnection);
+    }
+}
+
+void DeviceViewRefreshTicker::Forget(DeviceView* view)
+{
+    DirtyMutex.lock();
+    DirtyViews.erase(view);
+    DirtyMutex.unlock();
+}
+
+void DeviceViewRefreshTicker::ScheduleTick()
+{
+    int delay = TickInterval - (int)LastTick.elapsed();
+
+    TickTimer.start(delay > 0 ? delay : 0);
+}
+
+void DeviceViewRefreshTicker::Tick()
+{
+    std::set<DeviceView*> dirty_views;
+
+    /*-----------------------------------------------------*\
+    | Clear the scheduled flag before taking the dirty set  |
+    | so updates arriving during the repaint schedule the   |
+    | next tick                                             |
+    \*-----------------------------------------------------*/
+    TickScheduled = false;
+
+    DirtyMutex.lock();
+    dirty_views.swap(DirtyViews);
+    DirtyMutex.unlock();
+
+    LastTick.restart();
+
+    /*-----------------------------------------------------*\
+    | Hidden views are repainted by Qt when they are shown  |
+    \*-----------------------------------------------------*/
+    for(std::set<DeviceView*>::iterator it = dirty_views.begin(); it != dirty_views.end(); it++)
+    {
+        if((*it)->isVisible())
+        {
+            (*it)->updateChangedLeds();
+        }
+    }
+}
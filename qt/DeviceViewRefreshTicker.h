@@ -0,0 +1,46 @@
+#ifndef DEVICEVIEWREFRESHTICKER_H
+#define DEVICEVIEWREFRESHTICKER_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+
+#include "DeviceView.h"
+
+#include <atomic>
+#include <mutex>
+#include <set>
+
+/*---------------------------------------------------------*\
+| Collects repaint requests for device views from any       |
+| thread and updates the changed LEDs of the visible ones   |
+| from the GUI thread at most once per display frame.  Must |
+| first be created from the GUI thread.                     |
+\*---------------------------------------------------------*/
+class DeviceViewRefreshTicker : public QObject
+{
+    Q_OBJECT
+
+public:
+    static DeviceViewRefreshTicker* get();
+
+    void MarkDirty(DeviceView* view);
+    void Forget(DeviceView* view);
+
+private:
+    DeviceViewRefreshTicker();
+
+    std::mutex              DirtyMutex;
+    std::set<DeviceView*>   DirtyViews;
+    std::atomic<bool>       TickScheduled;
+
+    QTimer                  TickTimer;
+    QElapsedTimer           LastTick;
+    int                     TickInterval;
+
+private slots:
+    void ScheduleTick();
+    void Tick();
+};
+
+#endif // DEVICEVIEWREFRESHTICKER_H
@@ -1,6 +1,7 @@
 #include "OpenRGBDialog2.h"
 #include "OpenRGBDevicePage.h"
 #include "OpenRGBZoneResizeDialog.h"
+#include "DeviceViewRefreshTicker.h"
 #include "ResourceManager.h"
 #include "hsv.h"
 
@@ -8,9 +9,12 @@ using namespace Ui;
 
 static void UpdateCallback(void * this_ptr)
 {
-    OpenRGBDevicePage * this_obj = (OpenRGBDevicePage *)this_ptr;
-
-    QMetaObject::invokeMethod(this_obj, "UpdateInterface", Qt::QueuedConnection);
+    /*-----------------------------------------------------*\
+    | Called for every frame sent to the device, so only    |
+    | mark the device view dirty and let the refresh ticker |
+    | repaint it at display rate                            |
+    \*-----------------------------------------------------*/
+    DeviceViewRefreshTicker::get()->MarkDirty((DeviceView *)this_ptr);
 }
 
 QString OpenRGBDevicePage::ModeDescription(const mode& m)
@@ -59,7 +63,7 @@ OpenRGBDevicePage::OpenRGBDevicePage(RGBController *dev, QWidget *parent) :
     /*-----------------------------------------------------*\
     | Register update callback with the device              |
     \*-----------------------------------------------------*/
-    device->RegisterUpdateCallback(UpdateCallback, this);
+    device->RegisterUpdateCallback(UpdateCallback, ui->DeviceViewBox);
 
     /*-----------------------------------------------------*\
     | Set up the device view                                |
@@ -125,7 +129,7 @@ OpenRGBDevicePage::~OpenRGBDevicePage()
     {
         if(ResourceManager::get()->GetRGBControllers()[controller_idx] == device)
         {
-            device->UnregisterUpdateCallback(this);
+            device->UnregisterUpdateCallback(ui->DeviceViewBox);
             break;
         }
     }
@@ -752,12 +756,6 @@ void Ui::OpenRGBDevicePage::on_DirectionBox_currentIndexChanged(int /*index*/)
     UpdateMode();
 }
 
-void Ui::OpenRGBDevicePage::UpdateInterface()
-{
-    //UpdateModeUi();
-    ui->DeviceViewBox->repaint();
-}
-
 void Ui::OpenRGBDevicePage::UpdateModeUi()
 {
     /*-----------------------------------------------------*\
@@ -30,7 +30,6 @@ public:
 
 private slots:
     void changeEvent(QEvent *event);
-    void UpdateInterface();
 
     void on_ColorWheelBox_colorChanged(const QColor color);
     void on_SwatchBox_swatchChanged(const QColor color);
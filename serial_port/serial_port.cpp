@@ -322,6 +322,71 @@ int serial_port::serial_write(char * buffer, int length)
     return 0;
 }
 
+/*---------------------------------------------------------*\
+|  serial_write_nowait                                      |
+|    Writes <length> bytes to the serial port from <buffer> |
+|    without waiting for them to be transmitted.  Returns   |
+|    the number of bytes accepted by the driver             |
+\*---------------------------------------------------------*/
+int serial_port::serial_write_nowait(char * buffer, int length)
+{
+    /*-----------------------------------------------------*\
+    | Windows-specific code path for serial write           |
+    \*-----------------------------------------------------*/
+#ifdef _WIN32
+    DWORD byteswritten;
+    WriteFile(file_descriptor, buffer, length, &byteswritten, NULL);
+    return byteswritten;
+#endif
+
+    /*-----------------------------------------------------*\
+    | Linux and MacOS code path for serial write            |
+    \*-----------------------------------------------------*/
+#if defined(__linux__) || defined(__APPLE__)
+    int byteswritten;
+    byteswritten = write(file_descriptor, buffer, length);
+    return byteswritten;
+#endif
+
+    /*-----------------------------------------------------*\
+    | Return 0 on unsupported platforms                     |
+    \*-----------------------------------------------------*/
+    return 0;
+}
+
+/*---------------------------------------------------------*\
+|  serial_output_queue                                      |
+|    Returns the number of bytes written but not yet sent,  |
+|    or -1 if it cannot be determined                       |
+\*---------------------------------------------------------*/
+int serial_port::serial_output_queue()
+{
+#ifdef _WIN32
+    DWORD   errors;
+    COMSTAT status;
+
+    if(!ClearCommError(file_descriptor, &errors, &status))
+    {
+        return -1;
+    }
+
+    return status.cbOutQue;
+#endif
+
+#if defined(__linux__) || defined(__APPLE__)
+    int queued;
+
+    if(ioctl(file_descriptor, TIOCOUTQ, &queued) < 0)
+    {
+        return -1;
+    }
+
+    return queued;
+#endif
+
+    return -1;
+}
+
 /*---------------------------------------------------------*\
 |  serial_flush                                             |
 \*---------------------------------------------------------*/
@@ -87,11 +87,13 @@ public:
     int serial_read(char * buffer, int length);
 
     int serial_write(char * buffer, int length);
+    int serial_write_nowait(char * buffer, int length);
 
     void serial_flush_rx();
     void serial_flush_tx();
 
     int serial_available();
+    int serial_output_queue();
 
 private:
     char port_name[1024];